@@ -25,6 +25,9 @@
 
 #include <cstring>
 #include <cstdlib>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "NstCpu.hpp"
 #include "NstState.hpp"
@@ -123,6 +126,22 @@ namespace Nes
 			0x10, 0x1C, 0x20, 0x1E
 		};
 
+		const byte Apu::Square::forms[4][8] =
+		{
+			{0x1F,0x00,0x1F,0x1F,0x1F,0x1F,0x1F,0x1F},
+			{0x1F,0x00,0x00,0x1F,0x1F,0x1F,0x1F,0x1F},
+			{0x1F,0x00,0x00,0x00,0x00,0x1F,0x1F,0x1F},
+			{0x00,0x1F,0x1F,0x00,0x00,0x00,0x00,0x00}
+		};
+
+		const byte Apu::Triangle::pyramid[32] =
+		{
+			0x0,0x1,0x2,0x3,0x4,0x5,0x6,0x7,
+			0x8,0x9,0xA,0xB,0xC,0xD,0xE,0xF,
+			0xF,0xE,0xD,0xC,0xB,0xA,0x9,0x8,
+			0x7,0x6,0x5,0x4,0x3,0x2,0x1,0x0
+		};
+
 		const word Apu::Noise::lut[3][16] =
 		{
 			{
@@ -203,14 +222,121 @@ namespace Nes
 			}
 		};
 
+		// Renders the sound on a second thread. The CPU thread keeps running the
+		// frame sequencer and the registers, since the game can read them back, and
+		// logs every change affecting the output. The worker replays the log of a
+		// frame on its own copy of the channels while the next one is emulated.
+
+		class Apu::Worker
+		{
+		public:
+
+			explicit Worker(Apu&);
+			~Worker();
+
+			void Attach();
+			void Detach();
+			void Drain();
+			void Wait();
+			void Start(Cycle,Cycle,uint);
+
+			enum
+			{
+				EVENT_FRAME,
+				EVENT_OSCILLATORS,
+				EVENT_EXT
+			};
+
+			void Log(Cycle clock,uint type,uint data,Cycle param,Channel* channel=NULL,Channel::Writer writer=NULL)
+			{
+				const Event event = { clock, param, type, data, channel, writer };
+				events[0].push_back( event );
+			}
+
+			template<typename T,uint STEREO>
+			void Pad(Sound::Buffer::Renderer<T,STEREO>& output)
+			{
+				// nothing rendered ahead yet on the first frame, keep the
+				// phase of the channels intact and output silence instead
+
+				if (pipelined)
+				{
+					do
+					{
+						output << GetSample();
+					}
+					while (output);
+				}
+				else
+				{
+					do
+					{
+						output << 0;
+					}
+					while (output);
+				}
+			}
+
+		private:
+
+			struct Event
+			{
+				Cycle clock;
+				Cycle param;
+				uint type;
+				uint data;
+				Channel* channel;
+				Channel::Writer writer;
+			};
+
+			typedef std::vector<Event> Events;
+
+			void Run();
+			void Render(Events&);
+			void Sync(Cycle);
+			void ClockFrame(Cycle,Cycle,bool);
+			void Write(uint,uint,Cycle);
+			void ClockOscillators(bool);
+			Channel::Sample GetSample();
+
+			Apu& apu;
+			Square square[2];
+			Triangle triangle;
+			Noise noise;
+			Dmc dmc;
+			Channel::DcBlocker dcBlocker;
+			Cycle rate;
+			Cycle rateCounter;
+			Cycle frameEnd;
+			Cycle frameLength;
+			uint frameSamples;
+			CpuModel model;
+			bool pipelined;
+			bool busy;
+			bool quit;
+			Events events[2];
+			std::mutex mutex;
+			std::condition_variable signal;
+			std::thread thread;
+		};
+
+		inline void Apu::Log(const uint type,const uint data,const Cycle param)
+		{
+			if (updater == &Apu::SyncLog)
+				worker->Log( cycles.rateCounter, type, data, param );
+		}
+
 		#ifdef NST_MSVC_OPTIMIZE
 		#pragma optimize("s", on)
 		#endif
 
 		Apu::Apu(Cpu& c)
 		:
+		updater    (&Apu::SyncOff),
 		cpu        (c),
 		extChannel (NULL),
+		worker     (NULL),
+		workerSuspended (false),
 		buffer     (16),
 		frameSnapshotEnabled(false),//LHQ
 		postprocessCallback(nullptr)//LHQ
@@ -220,6 +346,11 @@ namespace Nes
 			PowerOff();
 		}
 
+		Apu::~Apu()
+		{
+			delete worker;
+		}
+
 		void Apu::PowerOff()
 		{
 			Reset( false, true );
@@ -232,6 +363,8 @@ namespace Nes
 
 		void Apu::Reset(const bool on,const bool hard)
 		{
+			Detach();
+
 			if (on)
 				UpdateSettings();
 
@@ -248,6 +381,7 @@ namespace Nes
 			dmc.Reset( cpu.GetModel() );
 
 			dcBlocker.Reset();
+			ResetBlip();
 
 			stream = NULL;
 
@@ -431,8 +565,76 @@ namespace Nes
 			}
 		}
 
+		void Apu::SetBandLimited(const bool enable)
+		{
+			if (settings.bandLimited != enable)
+			{
+				settings.bandLimited = enable;
+				UpdateSettings();
+			}
+		}
+
+		Result Apu::EnableParallel(const bool enable)
+		{
+			if (enable == (worker != NULL))
+				return RESULT_NOP;
+
+			Detach();
+
+			if (enable)
+			{
+				worker = new Worker( *this );
+			}
+			else
+			{
+				delete worker;
+				worker = NULL;
+			}
+
+			return RESULT_OK;
+		}
+
+		void Apu::SuspendParallel(const bool suspend)
+		{
+			// keeps the worker but renders on the calling thread meanwhile, for
+			// run-ahead which saves and reloads the state around every frame
+
+			if (suspend)
+				Detach();
+
+			workerSuspended = suspend;
+		}
+
+		void Apu::Detach()
+		{
+			if (updater == &Apu::SyncLog)
+			{
+				worker->Detach();
+				updater = GetRenderer();
+			}
+		}
+
+		Apu::Updater Apu::GetRenderer() const
+		{
+			if (cycles.extCounter != Cpu::CYCLE_MAX)
+				return &Apu::SyncOnExt;
+			else if (settings.bandLimited && !extChannel)
+				return &Apu::SyncBlip;
+			else
+				return &Apu::SyncOn;
+		}
+
+		void Apu::ResetBlip()
+		{
+			blip.Reset();
+			blipLevels[0] = 0;
+			blipLevels[1] = 0;
+		}
+
 		void Apu::UpdateSettings()
 		{
+			Detach();
+
 			cycles.Update( settings.rate, settings.speed, cpu );
 			synchronizer.Reset( settings.speed, settings.rate, cpu );
 			dcBlocker.Reset();
@@ -441,6 +643,9 @@ namespace Nes
 			Cycle rate; uint fixed;
 			CalculateOscillatorClock( rate, fixed );
 
+			blip.SetRate( rate );
+			ResetBlip();
+
 			square[0].UpdateSettings ( settings.muted ? 0 : settings.volumes[ Channel::APU_SQUARE1  ], rate, fixed );
 			square[1].UpdateSettings ( settings.muted ? 0 : settings.volumes[ Channel::APU_SQUARE2  ], rate, fixed );
 			triangle.UpdateSettings  ( settings.muted ? 0 : settings.volumes[ Channel::APU_TRIANGLE ], rate, fixed, cpu.GetModel() );
@@ -491,6 +696,10 @@ namespace Nes
 
 		void Apu::SaveState(State::Saver& state,const dword baseChunk) const
 		{
+			// the expansion sound is saved next and may still be written by the worker
+			if (updater == &Apu::SyncLog)
+				worker->Drain();
+
 			state.Begin( baseChunk );
 
 			{
@@ -569,6 +778,8 @@ namespace Nes
 
 		void Apu::LoadState(State::Loader& state)
 		{
+			Detach();
+
 			cycles.frameIrqClock = Cpu::CYCLE_MAX;
 			cycles.frameIrqRepeat = 0;
 
@@ -756,10 +967,76 @@ namespace Nes
 			}
 		}
 
+		void NST_FASTCALL Apu::SyncLog(const Cycle target)
+		{
+			NST_ASSERT( (stream && settings.audible) && (cycles.rate && cycles.fixed) && worker );
+
+			cycles.rateCounter = target;
+
+			while (cycles.frameCounter < target)
+			{
+				Log( Worker::EVENT_FRAME, cycles.frameDivider & 0x1U, cycles.frameCounter );
+				ClockFrameCounter();
+			}
+
+			if (cycles.extCounter <= target)
+			{
+				cycles.extCounter = extChannel->Clock( cycles.extCounter, cycles.fixed, target );
+				NST_ASSERT( cycles.extCounter > target );
+			}
+		}
+
+		void NST_FASTCALL Apu::SyncBlip(const Cycle target)
+		{
+			NST_ASSERT( (stream && settings.audible) && (cycles.rate && cycles.fixed) && !extChannel );
+
+			while (cycles.rateCounter < target)
+			{
+				// same samples and frame counter clock order as SyncOn, the
+				// oscillators just skip ahead between their transitions
+
+				const Cycle rate = cycles.rate;
+				const Cycle rateCounter = cycles.rateCounter;
+
+				uint count = (target - rateCounter + rate - 1) / rate;
+				const uint frame = (cycles.frameCounter > rateCounter ? (cycles.frameCounter - rateCounter + rate - 1) / rate : 0) + 1;
+
+				const bool clock = (frame <= count);
+
+				if (clock)
+					count = frame;
+
+				RunBlip( count );
+				cycles.rateCounter = rateCounter + count * rate;
+
+				if (clock)
+					ClockFrameCounter();
+			}
+
+			if (cycles.frameCounter < target)
+			{
+				ClockFrameCounter();
+				NST_ASSERT( cycles.frameCounter >= target );
+			}
+		}
+
 		void Apu::BeginFrame(Sound::Output* output)
 		{
 			stream = output;
-			updater = (output && settings.audible ? (cycles.extCounter == Cpu::CYCLE_MAX ? &Apu::SyncOn : &Apu::SyncOnExt) : &Apu::SyncOff);
+
+			if (output && settings.audible && worker && !workerSuspended && (!extChannel || extChannel->CanRenderAsync()))
+			{
+				if (updater != &Apu::SyncLog)
+				{
+					worker->Attach();
+					updater = &Apu::SyncLog;
+				}
+			}
+			else
+			{
+				Detach();
+				updater = (output && settings.audible ? GetRenderer() : &Apu::SyncOff);
+			}
 		}
 
 		inline void Apu::Update(const Cycle target)
@@ -798,10 +1075,33 @@ namespace Nes
 					Sound::Buffer::Block block( stream->length[i] );
 					buffer >> block;
 
+					const uint missing = stream->length[i] - block.length;
+
 					Sound::Buffer::Renderer<T,STEREO> output( stream->samples[i], stream->length[i], buffer.history );
 
 					if (output << block)
 					{
+						if (updater == &Apu::SyncLog)
+						{
+							worker->Pad( output );
+							continue;
+						}
+
+						if (updater == &Apu::SyncBlip)
+						{
+							// already synced up to the end of the frame, render
+							// the rest ahead of time like below
+
+							RunBlip( missing );
+							blip.Flush( buffer );
+
+							Sound::Buffer::Block ahead( missing );
+							buffer >> ahead;
+							output << ahead;
+
+							continue;
+						}
+
 						const Cycle target = cpu.GetCycles() * cycles.fixed;
 
 						if (cycles.rateCounter < target)
@@ -850,6 +1150,17 @@ namespace Nes
 
 			if (updater != &Apu::SyncOff)
 			{
+				if (updater == &Apu::SyncLog)
+				{
+					Update( cpu.GetCycles() );
+					worker->Wait();
+				}
+				else if (updater == &Apu::SyncBlip)
+				{
+					Update( cpu.GetCycles() );
+					blip.Flush( buffer );
+				}
+
 				dword streamed = 0;
 
 				if (Sound::Output::lockCallback( *stream ))
@@ -898,6 +1209,9 @@ namespace Nes
 					Sound::Output::unlockCallback( *stream );
 				}//if (Sound::Output::lockCallback( *stream ))
 
+				if (updater == &Apu::SyncLog)
+					worker->Start( cpu.GetCycles() * cycles.fixed, cpu.GetFrameCycles() * cycles.fixed, streamed );
+
 				if (const dword rate = synchronizer.Clock( streamed, settings.rate, cpu ))
 					Resync( rate );
 			}
@@ -938,7 +1252,7 @@ namespace Nes
 		#endif
 
 		Apu::Settings::Settings()
-		: rate(44100), bits(16), speed(0), muted(false), transpose(false), stereo(false), audible(true)
+		: rate(44100), bits(16), speed(0), muted(false), transpose(false), stereo(false), audible(true), bandLimited(false)
 		{
 			for (uint i=0; i < MAX_CHANNELS; ++i)
 				volumes[i] = Channel::DEFAULT_VOLUME;
@@ -1204,6 +1518,8 @@ namespace Nes
 
 		Apu::Channel::~Channel()
 		{
+			apu.Detach();
+
 			if (apu.extChannel == this)
 			{
 				apu.extChannel = NULL;
@@ -1215,6 +1531,8 @@ namespace Nes
 		{
 			NST_ASSERT( apu.extChannel == NULL );
 
+			apu.Detach();
+
 			if (audible)
 				apu.settings.audible = true;
 			else
@@ -1273,6 +1591,21 @@ namespace Nes
 			return Cpu::CYCLE_MAX;
 		}
 
+		bool Apu::Channel::CanRenderAsync() const
+		{
+			return false;
+		}
+
+		void Apu::Channel::Write(const Writer writer,const uint address,const uint data)
+		{
+			apu.Update();
+
+			if (apu.updater == &Apu::SyncLog)
+				apu.worker->Log( apu.cycles.rateCounter, Worker::EVENT_EXT, data, address, this, writer );
+			else
+				(this->*writer)( address, data );
+		}
+
 		#ifdef NST_MSVC_OPTIMIZE
 		#pragma optimize("s", on)
 		#endif
@@ -1546,14 +1879,6 @@ namespace Nes
 
 			if (active)
 			{
-				static const byte forms[4][8] =
-				{
-					{0x1F,0x00,0x1F,0x1F,0x1F,0x1F,0x1F,0x1F},
-					{0x1F,0x00,0x00,0x1F,0x1F,0x1F,0x1F,0x1F},
-					{0x1F,0x00,0x00,0x00,0x00,0x1F,0x1F,0x1F},
-					{0x00,0x1F,0x1F,0x00,0x00,0x00,0x00,0x00}
-				};
-
 				const byte* const NST_RESTRICT form = forms[duty];
 
 				if (timer >= 0)
@@ -1597,6 +1922,33 @@ namespace Nes
 			return amp;
 		}
 
+		inline dword Apu::Square::GetLevel() const
+		{
+			return active ? envelope.Volume() >> forms[duty][step] : 0;
+		}
+
+		inline dword Apu::Square::Step()
+		{
+			NST_ASSERT( active && timer >= 0 );
+
+			step = (step + 1) & 0x7;
+			timer += idword(frequency);
+
+			return envelope.Volume() >> forms[duty][step];
+		}
+
+		NST_SINGLE_CALL void Apu::Square::Idle(const dword units)
+		{
+			timer -= idword(units);
+
+			if (timer < 0)
+			{
+				const uint count = (-timer + frequency - 1) / frequency;
+				step = (step + count) & 0x7;
+				timer += idword(count * frequency);
+			}
+		}
+
 		#ifdef NST_MSVC_OPTIMIZE
 		#pragma optimize("s", on)
 		#endif
@@ -1757,14 +2109,6 @@ namespace Nes
 
 			if (active)
 			{
-				static const byte pyramid[32] =
-				{
-					0x0,0x1,0x2,0x3,0x4,0x5,0x6,0x7,
-					0x8,0x9,0xA,0xB,0xC,0xD,0xE,0xF,
-					0xF,0xE,0xD,0xC,0xB,0xA,0x9,0x8,
-					0x7,0x6,0x5,0x4,0x3,0x2,0x1,0x0
-				};
-
 				dword sum = timer;
 				timer -= idword(rate);
 
@@ -1800,6 +2144,37 @@ namespace Nes
 			return amp;
 		}
 
+		inline dword Apu::Triangle::GetLevel()
+		{
+			if (!active)
+				return 0;
+
+			amp = pyramid[step] * outputVolume * 3;
+			return amp;
+		}
+
+		inline dword Apu::Triangle::Step()
+		{
+			NST_ASSERT( active && timer >= 0 );
+
+			step = (step + 1) & 0x1F;
+			timer += idword(frequency);
+
+			amp = pyramid[step] * outputVolume * 3;
+			return amp;
+		}
+
+		NST_SINGLE_CALL void Apu::Triangle::Idle()
+		{
+			// restart the wave once it's been heard, like GetSample does after its fade-out
+
+			if (amp)
+			{
+				amp = 0;
+				step &= STEP_CHECK;
+			}
+		}
+
 		inline uint Apu::Triangle::GetLengthCounter() const
 		{
 			return lengthCounter.GetCount();
@@ -1982,6 +2357,27 @@ namespace Nes
 			return 0;
 		}
 
+		inline dword Apu::Noise::GetLevel() const
+		{
+			return active && !(bits & 0x4000) ? envelope.Volume() * 2 : 0;
+		}
+
+		inline dword Apu::Noise::Step()
+		{
+			NST_ASSERT( active && timer >= 0 );
+
+			bits = (bits << 1) | ((bits >> 14 ^ bits >> shifter) & 0x1);
+			timer += idword(frequency);
+
+			return (bits & 0x4000) ? 0 : envelope.Volume() * 2;
+		}
+
+		NST_SINGLE_CALL void Apu::Noise::Idle(const dword units)
+		{
+			for (timer -= idword(units); timer < 0; timer += idword(frequency))
+				bits = (bits << 1) | ((bits >> 14 ^ bits >> shifter) & 0x1);
+		}
+
 		inline uint Apu::Noise::GetLengthCounter() const
 		{
 			return lengthCounter.GetCount();
@@ -2286,6 +2682,21 @@ namespace Nes
 			}
 		}
 
+		inline uint Apu::Dmc::GetDac() const
+		{
+			return out.dac;
+		}
+
+		inline dword Apu::Dmc::GetLevel() const
+		{
+			return curSample;
+		}
+
+		inline void Apu::Dmc::SetOutput(const Dmc& dmc)
+		{
+			linSample = dmc.linSample;
+		}
+
 		inline uint Apu::Dmc::GetLengthCounter() const
 		{
 			return dma.lengthCounter;
@@ -2302,6 +2713,8 @@ namespace Nes
 
 		NST_NO_INLINE void Apu::ClearBuffers(bool resync)
 		{
+			Detach();
+
 			if (resync)
 				synchronizer.Resync( settings.speed, cpu );
 
@@ -2312,6 +2725,7 @@ namespace Nes
 			dmc.ClearAmp();
 
 			dcBlocker.Reset();
+			ResetBlip();
 
 			buffer.Reset( settings.bits, false );
 		}
@@ -2365,6 +2779,7 @@ namespace Nes
 				{
 					Update( cycles.dmcClock );
 					dmc.Update();
+					Log( 0x4011, dmc.GetDac() );
 				}
 
 				dmc.ClockDMA( cpu, cycles.dmcClock, readAddress );
@@ -2416,61 +2831,475 @@ namespace Nes
 			);
 		}
 
+		inline idword Apu::MixSquare(const dword dac)
+		{
+			return dac ? NLN_SQ_0 / (NLN_SQ_1 / dac + NLN_SQ_2) : 0;
+		}
+
+		inline idword Apu::MixTnd(const dword dac)
+		{
+			return dac ? NLN_TND_0 / (NLN_TND_1 / dac + NLN_TND_2) : 0;
+		}
+
+		NST_NO_INLINE void Apu::RunBlip(uint count)
+		{
+			while (count)
+			{
+				if (blip.Length() == Sound::Blip::SIZE)
+					blip.Flush( buffer );
+
+				const uint samples = NST_MIN( count, Sound::Blip::SIZE - blip.Length() );
+				count -= samples;
+
+				dword clock = blip.Clock();
+				const idword length = idword(samples * blip.Rate());
+				idword remaining = length;
+
+				blip.Advance( samples );
+
+				const bool active[4] =
+				{
+					square[0].IsActive(),
+					square[1].IsActive(),
+					triangle.IsActive(),
+					noise.IsActive()
+				};
+
+				dword levels[4] =
+				{
+					square[0].GetLevel(),
+					square[1].GetLevel(),
+					triangle.GetLevel(),
+					noise.GetLevel()
+				};
+
+				const dword dac = dmc.GetLevel();
+
+				// register writes and frame counter clocks since the last run
+
+				idword mix[2] =
+				{
+					MixSquare( levels[0] + levels[1] ),
+					MixTnd( levels[2] + levels[3] + dac )
+				};
+
+				for (uint i=0; i < 2; ++i)
+				{
+					if (mix[i] != blipLevels[i])
+						blip.AddDelta( clock, mix[i] - blipLevels[i] );
+				}
+
+				for (;;)
+				{
+					idword next = remaining;
+
+					if (active[0] && next > square[0].GetTimer()) next = square[0].GetTimer();
+					if (active[1] && next > square[1].GetTimer()) next = square[1].GetTimer();
+					if (active[2] && next > triangle.GetTimer())  next = triangle.GetTimer();
+					if (active[3] && next > noise.GetTimer())     next = noise.GetTimer();
+
+					NST_ASSERT( next >= 0 );
+
+					if (next == remaining)
+						break;
+
+					clock += next;
+					remaining -= next;
+
+					uint changed = 0;
+
+					if (active[0])
+					{
+						square[0].Run( next );
+
+						if (!square[0].GetTimer())
+						{
+							const dword level = square[0].Step();
+							changed |= uint(level != levels[0]) << 0;
+							levels[0] = level;
+						}
+					}
+
+					if (active[1])
+					{
+						square[1].Run( next );
+
+						if (!square[1].GetTimer())
+						{
+							const dword level = square[1].Step();
+							changed |= uint(level != levels[1]) << 0;
+							levels[1] = level;
+						}
+					}
+
+					if (active[2])
+					{
+						triangle.Run( next );
+
+						if (!triangle.GetTimer())
+						{
+							const dword level = triangle.Step();
+							changed |= uint(level != levels[2]) << 1;
+							levels[2] = level;
+						}
+					}
+
+					if (active[3])
+					{
+						noise.Run( next );
+
+						if (!noise.GetTimer())
+						{
+							const dword level = noise.Step();
+							changed |= uint(level != levels[3]) << 1;
+							levels[3] = level;
+						}
+					}
+
+					if (changed & 0x1)
+					{
+						const idword sample = MixSquare( levels[0] + levels[1] );
+						blip.AddDelta( clock, sample - mix[0] );
+						mix[0] = sample;
+					}
+
+					if (changed & 0x2)
+					{
+						const idword sample = MixTnd( levels[2] + levels[3] + dac );
+						blip.AddDelta( clock, sample - mix[1] );
+						mix[1] = sample;
+					}
+				}
+
+				if (active[0]) square[0].Run( remaining ); else square[0].Idle( length );
+				if (active[1]) square[1].Run( remaining ); else square[1].Idle( length );
+				if (active[2]) triangle.Run( remaining );  else triangle.Idle();
+				if (active[3]) noise.Run( remaining );     else noise.Idle( length );
+
+				blipLevels[0] = mix[0];
+				blipLevels[1] = mix[1];
+			}
+		}
+
+		#ifdef NST_MSVC_OPTIMIZE
+		#pragma optimize("s", on)
+		#endif
+
+		Apu::Worker::Worker(Apu& a)
+		:
+		apu       (a),
+		pipelined (false),
+		busy      (false),
+		quit      (false),
+		thread    (&Worker::Run,this)
+		{
+		}
+
+		Apu::Worker::~Worker()
+		{
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+				quit = true;
+			}
+
+			signal.notify_all();
+			thread.join();
+		}
+
+		void Apu::Worker::Attach()
+		{
+			NST_ASSERT( !busy );
+
+			square[0] = apu.square[0];
+			square[1] = apu.square[1];
+			triangle = apu.triangle;
+			noise = apu.noise;
+			dmc = apu.dmc;
+			dcBlocker = apu.dcBlocker;
+			rate = apu.cycles.rate;
+			rateCounter = apu.cycles.rateCounter;
+			model = apu.cpu.GetModel();
+			pipelined = false;
+
+			events[0].clear();
+		}
+
+		void Apu::Worker::Detach()
+		{
+			Drain();
+
+			apu.square[0] = square[0];
+			apu.square[1] = square[1];
+			apu.triangle = triangle;
+			apu.noise = noise;
+			apu.dmc.SetOutput( dmc );
+			apu.dcBlocker = dcBlocker;
+			apu.cycles.rateCounter = rateCounter;
+		}
+
+		#ifdef NST_MSVC_OPTIMIZE
+		#pragma optimize("", on)
+		#endif
+
+		void Apu::Worker::Drain()
+		{
+			Wait();
+			Render( events[0] );
+		}
+
+		void Apu::Worker::Wait()
+		{
+			std::unique_lock<std::mutex> lock( mutex );
+
+			while (busy)
+				signal.wait( lock );
+		}
+
+		void Apu::Worker::Start(const Cycle end,const Cycle length,const uint samples)
+		{
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+
+				NST_ASSERT( !busy && events[1].empty() );
+
+				events[0].swap( events[1] );
+				frameEnd = end;
+				frameLength = length;
+				frameSamples = samples;
+				pipelined = true;
+				busy = true;
+			}
+
+			signal.notify_all();
+		}
+
+		void Apu::Worker::Run()
+		{
+			std::unique_lock<std::mutex> lock( mutex );
+
+			for (;;)
+			{
+				while (!busy && !quit)
+					signal.wait( lock );
+
+				if (!busy)
+					break;
+
+				lock.unlock();
+
+				Render( events[1] );
+				Sync( frameEnd );
+
+				NST_ASSERT( rateCounter >= frameLength );
+				rateCounter -= frameLength;
+
+				// fill up the next output block the way FlushSound does at the end
+				// of a frame, assuming it'll be as large as the last one
+
+				for (uint n=apu.buffer.Length(); n < frameSamples; ++n)
+					apu.buffer << GetSample();
+
+				lock.lock();
+
+				busy = false;
+				signal.notify_all();
+			}
+		}
+
+		void Apu::Worker::Render(Events& log)
+		{
+			for (Events::const_iterator it(log.begin()), end(log.end()); it != end; ++it)
+			{
+				switch (it->type)
+				{
+					case EVENT_FRAME:
+
+						ClockFrame( it->param, it->clock, it->data );
+						break;
+
+					case EVENT_OSCILLATORS:
+
+						Sync( it->clock );
+						ClockOscillators( it->data );
+						break;
+
+					case EVENT_EXT:
+
+						Sync( it->clock );
+						(it->channel->*it->writer)( it->param, it->data );
+						break;
+
+					default:
+
+						Sync( it->clock );
+						Write( it->type, it->data, it->param );
+						break;
+				}
+			}
+
+			log.clear();
+		}
+
+		void Apu::Worker::Sync(const Cycle target)
+		{
+			while (rateCounter < target)
+			{
+				apu.buffer << GetSample();
+				rateCounter += rate;
+			}
+		}
+
+		void Apu::Worker::ClockFrame(const Cycle frame,const Cycle target,const bool twoClocks)
+		{
+			// same sample as SyncOn would have clocked the frame counter at
+
+			while (rateCounter < target)
+			{
+				apu.buffer << GetSample();
+
+				const Cycle sample = rateCounter;
+				rateCounter += rate;
+
+				if (frame <= sample)
+					break;
+			}
+
+			ClockOscillators( twoClocks );
+		}
+
+		void Apu::Worker::Write(const uint address,uint data,const Cycle delta)
+		{
+			switch (address)
+			{
+				case 0x4000:
+				case 0x4004: square[address >> 2 & 0x1].WriteReg0( data ); break;
+				case 0x4001:
+				case 0x4005: square[address >> 2 & 0x1].WriteReg1( data ); break;
+				case 0x4002:
+				case 0x4006: square[address >> 2 & 0x1].WriteReg2( data ); break;
+				case 0x4003:
+				case 0x4007: square[address >> 2 & 0x1].WriteReg3( data, delta ); break;
+				case 0x4008: triangle.WriteReg0( data ); break;
+				case 0x400A: triangle.WriteReg2( data ); break;
+				case 0x400B: triangle.WriteReg3( data, delta ); break;
+				case 0x400C: noise.WriteReg0( data ); break;
+				case 0x400E: noise.WriteReg2( data, model ); break;
+				case 0x400F: noise.WriteReg3( data, delta ); break;
+				case 0x4011: dmc.WriteReg1( data ); break;
+				case 0x4015:
+
+					data = ~data;
+
+					square[0].Disable ( data >> 0 & 0x1 );
+					square[1].Disable ( data >> 1 & 0x1 );
+					triangle.Disable  ( data >> 2 & 0x1 );
+					noise.Disable     ( data >> 3 & 0x1 );
+					break;
+
+				default: NST_UNREACHABLE();
+			}
+		}
+
+		void Apu::Worker::ClockOscillators(const bool twoClocks)
+		{
+			for (uint i=0; i < 2; ++i)
+				square[i].ClockEnvelope();
+
+			triangle.ClockLinearCounter();
+			noise.ClockEnvelope();
+
+			if (twoClocks)
+			{
+				for (uint i=0; i < 2; ++i)
+					square[i].ClockSweep( i-1 );
+
+				triangle.ClockLengthCounter();
+				noise.ClockLengthCounter();
+			}
+		}
+
+		Apu::Channel::Sample Apu::Worker::GetSample()
+		{
+			dword dac[2];
+
+			return Clamp<Channel::OUTPUT_MIN,Channel::OUTPUT_MAX>
+			(
+				dcBlocker.Apply
+				(
+					(0 != (dac[0] = square[0].GetSample() + square[1].GetSample()) ? NLN_SQ_0 / (NLN_SQ_1 / dac[0] + NLN_SQ_2) : 0) +
+					(0 != (dac[1] = triangle.GetSample() + noise.GetSample() + dmc.GetSample()) ? NLN_TND_0 / (NLN_TND_1 / dac[1] + NLN_TND_2) : 0)
+				) + (apu.extChannel ? apu.extChannel->GetSample() : 0)
+			);
+		}
+
 		NES_POKE_AD(Apu,4000)
 		{
 			UpdateLatency();
 			square[address >> 2 & 0x1].WriteReg0( data );
+			Log( address, data );
 		}
 
 		NES_POKE_AD(Apu,4001)
 		{
 			Update();
 			square[address >> 2 & 0x1].WriteReg1( data );
+			Log( address, data );
 		}
 
 		NES_POKE_AD(Apu,4002)
 		{
 			Update();
 			square[address >> 2 & 0x1].WriteReg2( data );
+			Log( address, data );
 		}
 
 		NES_POKE_AD(Apu,4003)
 		{
-			square[address >> 2 & 0x1].WriteReg3( data, UpdateDelta() );
+			const bool delta = UpdateDelta();
+			square[address >> 2 & 0x1].WriteReg3( data, delta );
+			Log( address, data, delta );
 		}
 
 		NES_POKE_D(Apu,4008)
 		{
 			Update();
 			triangle.WriteReg0( data );
+			Log( 0x4008, data );
 		}
 
 		NES_POKE_D(Apu,400A)
 		{
 			Update();
 			triangle.WriteReg2( data );
+			Log( 0x400A, data );
 		}
 
 		NES_POKE_D(Apu,400B)
 		{
-			triangle.WriteReg3( data, UpdateDelta() );
+			const bool delta = UpdateDelta();
+			triangle.WriteReg3( data, delta );
+			Log( 0x400B, data, delta );
 		}
 
 		NES_POKE_D(Apu,400C)
 		{
 			UpdateLatency();
 			noise.WriteReg0( data );
+			Log( 0x400C, data );
 		}
 
 		NES_POKE_D(Apu,400E)
 		{
 			Update();
 			noise.WriteReg2( data, cpu.GetModel() );
+			Log( 0x400E, data );
 		}
 
 		NES_POKE_D(Apu,400F)
 		{
-			noise.WriteReg3( data, UpdateDelta() );
+			const bool delta = UpdateDelta();
+			noise.WriteReg3( data, delta );
+			Log( 0x400F, data, delta );
 		}
 
 		NES_POKE_D(Apu,4010)
@@ -2483,6 +3312,7 @@ namespace Nes
 		{
 			Update();
 			dmc.WriteReg1( data );
+			Log( 0x4011, data );
 		}
 
 		NES_POKE_D(Apu,4012)
@@ -2498,6 +3328,7 @@ namespace Nes
 		NES_POKE_D(Apu,4015)
 		{
 			Update();
+			Log( 0x4015, data );
 
 			data = ~data;
 
@@ -2563,7 +3394,10 @@ namespace Nes
 					cpu.ClearIRQ( Cpu::IRQ_FRAME );
 
 				if (data & STATUS_SEQUENCE_5_STEP)
+				{
 					ClockOscillators( true );
+					Log( Worker::EVENT_OSCILLATORS, true );
+				}
 			}
 			else
 			{
@@ -61,6 +61,7 @@ namespace Nes
 			//end LHQ
 
 			explicit Apu(Cpu&);
+			~Apu();
 
 			void  Reset(bool);
 			void  PowerOff();
@@ -80,6 +81,9 @@ namespace Nes
 			void   SetAutoTranspose(bool);
 			void   SetGenie(bool);
 			void   EnableStereo(bool);
+			void   SetBandLimited(bool);
+			Result EnableParallel(bool);
+			void   SuspendParallel(bool);
 
 			void SaveState(State::Saver&,dword) const;
 			void LoadState(State::Loader&);
@@ -88,6 +92,10 @@ namespace Nes
 			{
 				Apu& apu;
 
+			public:
+
+				typedef void (Channel::*Writer)(uint,uint);
+
 			protected:
 
 				explicit Channel(Apu&);
@@ -103,6 +111,13 @@ namespace Nes
 				Cycle GetCpuClock(uint=1) const;
 				bool  IsMuted() const;
 				bool  IsGenie() const;
+				void  Write(Writer,uint,uint);
+
+				template<typename T>
+				void Write(void (T::*writer)(uint,uint),uint address,uint data)
+				{
+					Write( static_cast<Writer>(writer), address, data );
+				}
 
 			public:
 
@@ -136,6 +151,7 @@ namespace Nes
 				virtual Sample GetSample() = 0;
 				virtual Cycle Clock(Cycle,Cycle,Cycle);
 				virtual bool UpdateSettings() = 0;
+				virtual bool CanRenderAsync() const;
 
 				class LengthCounter
 				{
@@ -261,7 +277,12 @@ namespace Nes
 			void UpdateLatency();
 			bool UpdateDelta();
 
+			class Worker;
+
 			void Reset(bool,bool);
+			void Detach();
+			Updater GetRenderer() const;
+			inline void Log(uint,uint,Cycle=0);
 			void CalculateOscillatorClock(Cycle&,uint&) const;
 			void Resync(dword);
 			NST_NO_INLINE void ClearBuffers(bool);
@@ -311,6 +332,14 @@ namespace Nes
 			void NST_FASTCALL SyncOn    (Cycle);
 			void NST_FASTCALL SyncOnExt (Cycle);
 			void NST_FASTCALL SyncOff   (Cycle);
+			void NST_FASTCALL SyncLog   (Cycle);
+			void NST_FASTCALL SyncBlip  (Cycle);
+
+			NST_NO_INLINE void RunBlip(uint);
+			void ResetBlip();
+
+			static inline idword MixSquare(dword);
+			static inline idword MixTnd(dword);
 
 			NST_NO_INLINE void ClockFrameIRQ(Cycle);
 			NST_NO_INLINE void ClockFrameCounter();
@@ -384,6 +413,21 @@ namespace Nes
 			public:
 
 				inline void ClearAmp();
+
+				bool IsActive() const
+				{
+					return active;
+				}
+
+				idword GetTimer() const
+				{
+					return timer;
+				}
+
+				void Run(idword units)
+				{
+					timer -= units;
+				}
 			};
 
 			class Square : public Oscillator
@@ -403,6 +447,10 @@ namespace Nes
 
 				dword GetSample();
 
+				inline dword GetLevel() const;
+				inline dword Step();
+				NST_SINGLE_CALL void Idle(dword);
+
 				NST_SINGLE_CALL void ClockEnvelope();
 				NST_SINGLE_CALL void ClockSweep(uint);
 
@@ -438,6 +486,8 @@ namespace Nes
 				uint sweepIncrease;
 				word sweepShift;
 				word waveLength;
+
+				static const byte forms[4][8];
 			};
 
 			class Triangle : public Oscillator
@@ -458,6 +508,10 @@ namespace Nes
 
 				NST_SINGLE_CALL dword GetSample();
 
+				inline dword GetLevel();
+				inline dword Step();
+				NST_SINGLE_CALL void Idle();
+
 				NST_SINGLE_CALL void ClockLinearCounter();
 				NST_SINGLE_CALL void ClockLengthCounter();
 
@@ -490,6 +544,8 @@ namespace Nes
 				byte linearCtrl;
 				byte linearCounter;
 				Channel::LengthCounter lengthCounter;
+
+				static const byte pyramid[32];
 			};
 
 			class Noise : public Oscillator
@@ -508,6 +564,10 @@ namespace Nes
 
 				NST_SINGLE_CALL dword GetSample();
 
+				inline dword GetLevel() const;
+				inline dword Step();
+				NST_SINGLE_CALL void Idle(dword);
+
 				NST_SINGLE_CALL void ClockEnvelope();
 				NST_SINGLE_CALL void ClockLengthCounter();
 
@@ -557,6 +617,9 @@ namespace Nes
 
 				inline void ClearAmp();
 				inline uint GetLengthCounter() const;
+				inline uint GetDac() const;
+				inline dword GetLevel() const;
+				inline void SetOutput(const Dmc&);
 
 				static Cycle GetResetFrequency(CpuModel);
 
@@ -615,6 +678,7 @@ namespace Nes
 				bool genie;
 				bool stereo;
 				bool audible;
+				bool bandLimited;
 				byte volumes[MAX_CHANNELS];
 			};
 
@@ -628,12 +692,16 @@ namespace Nes
 			Noise noise;
 			Dmc dmc;
 			Channel* extChannel;
+			Worker* worker;
+			bool workerSuspended;
 			Channel::DcBlocker dcBlocker;
 			Sound::Output* stream;
 			FrameOutput frameSnapshot;//LHQ
 			bool frameSnapshotEnabled;//LHQ
 			PostprocessCallback postprocessCallback;//LHQ
 			Sound::Buffer buffer;
+			Sound::Blip blip;
+			idword blipLevels[2];
 			Settings settings;
 
 		public:
@@ -678,6 +746,16 @@ namespace Nes
 				return settings.audible && !settings.muted;
 			}
 
+			bool IsBandLimited() const
+			{
+				return settings.bandLimited;
+			}
+
+			bool IsParallel() const
+			{
+				return worker != NULL;
+			}
+
 			//LHQ
 			void EnableFrameSnapshot(bool e) {
 				frameSnapshotEnabled = e;
@@ -159,6 +159,10 @@ namespace Nes
 	*/
 	enum Result: intptr_t
 	{
+		/**
+		* Buffer is too small
+		*/
+		RESULT_ERR_BUFFER_TOO_SMALL = -16,
 		/**
 		* Buffer is too big
 		*/
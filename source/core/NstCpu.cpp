@@ -41,6 +41,8 @@ namespace Nes
 	{
 		dword Cpu::logged = 0;
 
+		#if NST_CPU_DISPATCH == NST_CPU_DISPATCH_TABLE
+
 		void (Cpu::*const Cpu::opcodes[0x100])() =
 		{
 			&Cpu::op0x00, &Cpu::op0x01, &Cpu::op0x02, &Cpu::op0x03,
@@ -109,6 +111,8 @@ namespace Nes
 			&Cpu::op0xFC, &Cpu::op0xFD, &Cpu::op0xFE, &Cpu::op0xFF
 		};
 
+		#endif
+
 		const byte Cpu::writeClocks[0x100] =
 		{
 			0x1C, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x18, 0x18,
@@ -157,9 +161,11 @@ namespace Nes
 		Cpu::Cpu()
 		:
 		model ( CPU_RP2A03 ),
+		ramBank ( ram.mem ),
 		apu   ( *this ),
 		map   ( this, &Cpu::Peek_Overflow, &Cpu::Poke_Overflow ),
-		remoteControllerIdx (NO_REMOTE_CONTROL)
+		remoteControllerIdx (NO_REMOTE_CONTROL),
+		lockstepPadsEnabled (false)
 		{
 			cycles.UpdateTable( GetModel() );
 			Reset( false, false );
@@ -215,7 +221,9 @@ namespace Nes
 
 			interrupt.Reset();
 			hooks.Clear();
+			events.Clear();
 			linker.Clear();
+			map.ClearDirect();
 
 			if (on)
 			{
@@ -227,6 +235,9 @@ namespace Nes
 				map( 0xFFFC         ).Set( this, &Cpu::Peek_Jam_1,      &Cpu::Poke_Nop        );
 				map( 0xFFFD         ).Set( this, &Cpu::Peek_Jam_2,      &Cpu::Poke_Nop        );
 
+				for (uint i=0x0000; i < 0x2000; i += RAM_SIZE)
+					map.SetDirect( i, i + (RAM_SIZE-1), &ramBank, RAM_SIZE-1 );
+
 				apu.Reset( hard );
 			}
 			else
@@ -272,6 +283,20 @@ namespace Nes
 			hooks.Remove( hook );
 		}
 
+		// Calls the hook once the CPU reaches 'cycle', after the instruction crossing it.
+		// Rescheduling the same hook replaces its pending cycle, CYCLE_MAX parks it.
+
+		void Cpu::Schedule(const Hook& hook,const Cycle cycle)
+		{
+			events.Set( hook, cycle );
+			cycles.NextRound( cycle );
+		}
+
+		void Cpu::Unschedule(const Hook& hook)
+		{
+			events.Remove( hook );
+		}
+
 		#ifdef NST_MSVC_OPTIMIZE
 		#pragma optimize("", on)
 		#endif
@@ -552,6 +577,21 @@ namespace Nes
 			this->lastReceivedRemoteInputId = 0;
 		}
 
+		void Cpu::SetLockstepPads(const uint* pads) {
+			this->lockstepPadsEnabled = pads != NULL;
+			if (pads)
+				memcpy(this->lockstepPads, pads, sizeof this->lockstepPads);
+		}
+
+		bool Cpu::GetLockstepPadState(uint& padButtons, uint idx) const {
+			if (!this->lockstepPadsEnabled)
+				return false;
+
+			padButtons = idx < 4 ? this->lockstepPads[idx] : 0;
+
+			return true;
+		}
+
 		void Cpu::NotifyOp(const char (&code)[4],const dword which)
 		{
 			if (!(logged & which))
@@ -612,10 +652,118 @@ namespace Nes
 			}
 		}
 
+		struct Cpu::Events::Event
+		{
+			Hook hook;
+			Cycle cycle;
+		};
+
+		Cpu::Events::Events()
+		: events(new Event [2]), size(0), capacity(2), next(CYCLE_MAX) {}
+
+		Cpu::Events::~Events()
+		{
+			delete [] events;
+		}
+
+		void Cpu::Events::Clear()
+		{
+			size = 0;
+			next = CYCLE_MAX;
+		}
+
+		void Cpu::Events::Set(const Hook& hook,const Cycle cycle)
+		{
+			for (uint i=0, n=size; i < n; ++i)
+			{
+				if (events[i].hook == hook)
+				{
+					events[i].cycle = cycle;
+					Update();
+					return;
+				}
+			}
+
+			if (size == capacity)
+			{
+				Event* const NST_RESTRICT tmp = new Event [capacity+1];
+				++capacity;
+
+				for (uint i=0, n=size; i < n; ++i)
+					tmp[i] = events[i];
+
+				delete [] events;
+				events = tmp;
+			}
+
+			events[size].hook = hook;
+			events[size].cycle = cycle;
+			++size;
+
+			Update();
+		}
+
+		void Cpu::Events::Remove(const Hook& hook)
+		{
+			for (uint i=0, n=size; i < n; ++i)
+			{
+				if (events[i].hook == hook)
+				{
+					while (++i < n)
+						events[i-1] = events[i];
+
+					--size;
+					Update();
+					return;
+				}
+			}
+		}
+
+		void Cpu::Events::EndFrame(const Cycle frame)
+		{
+			for (uint i=0, n=size; i < n; ++i)
+			{
+				if (events[i].cycle != CYCLE_MAX)
+					events[i].cycle = (events[i].cycle > frame ? events[i].cycle - frame : 0);
+			}
+
+			Update();
+		}
+
 		#ifdef NST_MSVC_OPTIMIZE
 		#pragma optimize("", on)
 		#endif
 
+		void Cpu::Events::Update()
+		{
+			next = CYCLE_MAX;
+
+			for (uint i=0, n=size; i < n; ++i)
+			{
+				if (next > events[i].cycle)
+					next = events[i].cycle;
+			}
+		}
+
+		void Cpu::Events::Execute(const Cycle count)
+		{
+			// one pass only, an event a handler reschedules at or before <count>, or moves
+			// behind the current one by removing another, fires after the next instruction
+
+			for (uint i=0; i < size; ++i)
+			{
+				if (events[i].cycle <= count)
+				{
+					const Hook hook( events[i].hook );
+
+					events[i].cycle = CYCLE_MAX;
+					hook.Execute();
+				}
+			}
+
+			Update();
+		}
+
 		inline uint Cpu::Hooks::Size() const
 		{
 			return size;
@@ -734,7 +882,7 @@ namespace Nes
 					*it = *next;
 					delete next;
 
-					if (map(address) == port)
+					if (map[address] == port)
 						map(address) = *it;
 
 					if (it->level == 0)
@@ -805,28 +953,115 @@ namespace Nes
 
 		template<typename T,typename U>
 		Cpu::IoMap::IoMap(Cpu* cpu,T peek,U poke)
-		: Io::Map<SIZE_64K>( cpu, peek, poke ) {}
+		: Io::Map<SIZE_64K>( cpu, peek, poke )
+		{
+			ClearDirect();
+		}
+
+		void Cpu::IoMap::ClearDirect()
+		{
+			for (uint i=0; i < sizeof(array(readPages)); ++i)
+			{
+				readPages[i].bank = NULL;
+				readPages[i].mask = 0;
+			}
+
+			for (uint i=0; i < sizeof(array(direct)); ++i)
+			{
+				direct[i].bank = NULL;
+				direct[i].mask = 0;
+				direct[i].dirty = false;
+			}
+
+			dirty = false;
+		}
+
+		void Cpu::IoMap::SetDirect(const Address first,const Address last,const byte* const* const bank,const uint mask)
+		{
+			NST_ASSERT( first <= last && last < SIZE && !(first & PAGE_MASK) && (last & PAGE_MASK) == PAGE_MASK && bank );
+
+			for (uint i=first >> PAGE_SHIFT, n=last >> PAGE_SHIFT; i <= n; ++i)
+			{
+				readPages[i].bank = NULL;
+				direct[i].port = (*this)[first];
+				direct[i].bank = bank;
+				direct[i].mask = mask;
+				direct[i].dirty = true;
+			}
+
+			dirty = true;
+		}
 
 		#ifdef NST_MSVC_OPTIMIZE
 		#pragma optimize("", on)
 		#endif
 
+		void Cpu::IoMap::Invalidate(const Address first,const Address last)
+		{
+			NST_ASSERT( first <= last && last < SIZE );
+
+			for (uint i=first >> PAGE_SHIFT, n=last >> PAGE_SHIFT; i <= n; ++i)
+			{
+				readPages[i].bank = NULL;
+				direct[i].dirty = true;
+			}
+
+			dirty = true;
+		}
+
+		void Cpu::IoMap::Validate()
+		{
+			if (!dirty)
+				return;
+
+			dirty = false;
+
+			for (uint i=0; i < sizeof(array(direct)); ++i)
+			{
+				if (!direct[i].dirty)
+					continue;
+
+				direct[i].dirty = false;
+
+				if (!direct[i].bank)
+					continue;
+
+				Address address = i << PAGE_SHIFT;
+				const Address end = address + PAGE_SIZE;
+
+				while (address != end && (*this)[address].SameReader( direct[i].port ))
+					++address;
+
+				if (address == end)
+				{
+					readPages[i].bank = direct[i].bank;
+					readPages[i].mask = direct[i].mask;
+				}
+			}
+		}
+
 		inline uint Cpu::IoMap::Peek8(const uint address) const
 		{
 			NST_ASSERT( address < FULL_SIZE );
-			return ports[address].Peek( address );
+
+			const Page& page = readPages[address >> PAGE_SHIFT];
+
+			if (page.bank)
+				return (*page.bank)[address & page.mask];
+			else
+				return (*this)[address].Peek( address );
 		}
 
 		inline uint Cpu::IoMap::Peek16(const uint address) const
 		{
 			NST_ASSERT( address < FULL_SIZE-1 );
-			return ports[address].Peek( address ) | ports[address + 1].Peek( address + 1 ) << 8;
+			return Peek8( address ) | Peek8( address + 1 ) << 8;
 		}
 
 		inline void Cpu::IoMap::Poke8(const uint address,const uint data) const
 		{
 			NST_ASSERT( address < FULL_SIZE );
-			ports[address].Poke( address, data );
+			(*this)[address].Poke( address, data );
 		}
 
 		#ifdef NST_MSVC_OPTIMIZE
@@ -1940,15 +2175,16 @@ namespace Nes
 		{
 			NST_VERIFY( cycles.count < cycles.frame );
 
+			map.Validate();
 			apu.BeginFrame( sound );
 
 			Clock();
 
 			switch (hooks.Size())
 			{
-				case 0:  Run0(); break;
-				case 1:  Run1(); break;
-				default: Run2(); break;
+				case 0:  Run<0>(); break;
+				case 1:  Run<1>(); break;
+				default: Run<2>(); break;
 			}
 		}
 
@@ -1961,6 +2197,8 @@ namespace Nes
 
 			NST_ASSERT( cycles.count >= cycles.frame && interrupt.nmiClock >= cycles.frame );
 
+			events.EndFrame( cycles.frame );
+
 			cycles.count -= cycles.frame;
 			ticks += cycles.frame;
 
@@ -1978,6 +2216,9 @@ namespace Nes
 			if (clock > cycles.frame)
 				clock = cycles.frame;
 
+			if (clock > events.Next())
+				clock = events.Next();
+
 			if (cycles.count < interrupt.nmiClock)
 			{
 				if (clock > interrupt.nmiClock)
@@ -2008,73 +2249,6 @@ namespace Nes
 			cycles.round = clock;
 		}
 
-		inline void Cpu::ExecuteOp()
-		{
-			cycles.offset = cycles.count;
-			(*this.*opcodes[opcode=FetchPc8()])();
-		}
-
-		void Cpu::Run0()
-		{
-			do
-			{
-				do
-				{
-					ExecuteOp();
-				}
-				while (cycles.count < cycles.round);
-
-				Clock();
-			}
-			while (cycles.count < cycles.frame);
-		}
-
-		void Cpu::Run1()
-		{
-			const Hook hook( *hooks.Ptr() );
-
-			do
-			{
-				do
-				{
-					ExecuteOp();
-					hook.Execute();
-				}
-				while (cycles.count < cycles.round);
-
-				Clock();
-			}
-			while (cycles.count < cycles.frame);
-		}
-
-		void Cpu::Run2()
-		{
-			const Hook* const first = hooks.Ptr();
-			const Hook* const last = first + (hooks.Size() - 1);
-
-			do
-			{
-				do
-				{
-					ExecuteOp();
-
-					const Hook* NST_RESTRICT hook = first;
-
-					hook->Execute();
-
-					do
-					{
-						(++hook)->Execute();
-					}
-					while (hook != last);
-				}
-				while (cycles.count < cycles.round);
-
-				Clock();
-			}
-			while (cycles.count < cycles.frame);
-		}
-
 		uint Cpu::Peek(const uint address) const
 		{
 			return map.Peek8( address );
@@ -2089,6 +2263,14 @@ namespace Nes
 		// opcodes
 		////////////////////////////////////////////////////////////////////////////////////////
 
+		#if NST_CPU_DISPATCH == NST_CPU_DISPATCH_TABLE
+		#define NES_OP_DECL void
+		#elif NST_GCC
+		#define NES_OP_DECL inline __attribute__((always_inline)) void
+		#else
+		#define NES_OP_DECL NST_FORCE_INLINE void
+		#endif
+
 		#define StoreZpgX(a_,d_) StoreZpg(a_,d_)
 		#define StoreZpgY(a_,d_) StoreZpg(a_,d_)
 		#define StoreAbs(a_,d_)  StoreMem(a_,d_)
@@ -2099,28 +2281,28 @@ namespace Nes
 
 		#define NES_I____(instr_,hex_)                \
                                                       \
-		void Cpu::op##hex_()                          \
+		NES_OP_DECL Cpu::op##hex_()                   \
 		{                                             \
 			instr_();                                 \
 		}
 
 		#define NES____C_(nop_,ticks_,hex_)           \
                                                       \
-		void Cpu::op##hex_()                          \
+		NES_OP_DECL Cpu::op##hex_()                   \
 		{                                             \
 			cycles.count += cycles.clock[ticks_ - 1]; \
 		}
 
 		#define NES_IR___(instr_,addr_,hex_)          \
                                                       \
-		void Cpu::op##hex_()                          \
+		NES_OP_DECL Cpu::op##hex_()                   \
 		{                                             \
 			instr_( addr_##_R() );                    \
 		}
 
 		#define NES_I_W__(instr_,addr_,hex_)          \
                                                       \
-		void Cpu::op##hex_()                          \
+		NES_OP_DECL Cpu::op##hex_()                   \
 		{                                             \
 			const uint dst = addr_##_W();             \
 			Store##addr_( dst, instr_() );            \
@@ -2128,7 +2310,7 @@ namespace Nes
 
 		#define NES_IRW__(instr_,addr_,hex_)          \
                                                       \
-		void Cpu::op##hex_()                          \
+		NES_OP_DECL Cpu::op##hex_()                   \
 		{                                             \
 			uint data;                                \
 			const uint dst = addr_##_RW( data );      \
@@ -2137,7 +2319,7 @@ namespace Nes
 
 		#define NES_IRA__(instr_,hex_)                \
                                                       \
-		void Cpu::op##hex_()                          \
+		NES_OP_DECL Cpu::op##hex_()                   \
 		{                                             \
 			cycles.count += cycles.clock[1];          \
 			a = instr_( a );                          \
@@ -2145,7 +2327,7 @@ namespace Nes
 
 		#define NES_I_W_A(instr_,addr_,hex_)          \
                                                       \
-		void Cpu::op##hex_()                          \
+		NES_OP_DECL Cpu::op##hex_()                   \
 		{                                             \
 			const uint dst = addr_##_W();             \
 			Store##addr_( dst, instr_(dst) );         \
@@ -2153,7 +2335,7 @@ namespace Nes
 
 		#define NES_IP_C_(instr_,ops_,ticks_,hex_)    \
                                                       \
-		void Cpu::op##hex_()                          \
+		NES_OP_DECL Cpu::op##hex_()                   \
 		{                                             \
 			pc += ops_;                               \
 			cycles.count += cycles.clock[ticks_ - 1]; \
@@ -2452,5 +2634,139 @@ namespace Nes
 		#undef NES_IRA__
 		#undef NES_I_W_A
 		#undef NES_IP_C_
+		#undef NES_OP_DECL
+
+		////////////////////////////////////////////////////////////////////////////////////////
+		// dispatch
+		////////////////////////////////////////////////////////////////////////////////////////
+
+		#define NES_OPS_ROW(r_)                                         \
+                                                                        \
+			NES_OP(r_##0) NES_OP(r_##1) NES_OP(r_##2) NES_OP(r_##3) \
+			NES_OP(r_##4) NES_OP(r_##5) NES_OP(r_##6) NES_OP(r_##7) \
+			NES_OP(r_##8) NES_OP(r_##9) NES_OP(r_##A) NES_OP(r_##B) \
+			NES_OP(r_##C) NES_OP(r_##D) NES_OP(r_##E) NES_OP(r_##F)
+
+		#define NES_OPS                                                 \
+                                                                        \
+			NES_OPS_ROW(0x0) NES_OPS_ROW(0x1) NES_OPS_ROW(0x2) NES_OPS_ROW(0x3) \
+			NES_OPS_ROW(0x4) NES_OPS_ROW(0x5) NES_OPS_ROW(0x6) NES_OPS_ROW(0x7) \
+			NES_OPS_ROW(0x8) NES_OPS_ROW(0x9) NES_OPS_ROW(0xA) NES_OPS_ROW(0xB) \
+			NES_OPS_ROW(0xC) NES_OPS_ROW(0xD) NES_OPS_ROW(0xE) NES_OPS_ROW(0xF)
+
+		template<uint NUM_HOOKS>
+		inline void Cpu::ExecuteHooks(const Hook* const first,const Hook* const last) const
+		{
+			if (NUM_HOOKS == 1)
+			{
+				first->Execute();
+			}
+			else if (NUM_HOOKS > 1)
+			{
+				const Hook* NST_RESTRICT hook = first;
+
+				hook->Execute();
+
+				do
+				{
+					(++hook)->Execute();
+				}
+				while (hook != last);
+			}
+		}
+
+		// runs instructions until the end of the current round,
+		// cycle accounting is the same with every backend
+
+		#if NST_CPU_DISPATCH == NST_CPU_DISPATCH_GOTO
+
+		template<uint NUM_HOOKS>
+		inline void Cpu::ExecuteOps(const Hook* const first,const Hook* const last)
+		{
+			static const void* const labels[0x100] =
+			{
+				#define NES_OP(hex_) &&op_##hex_,
+				NES_OPS
+				#undef NES_OP
+			};
+
+			cycles.offset = cycles.count;
+			goto *labels[opcode = FetchPc8()];
+
+			#define NES_OP(hex_)                         \
+                                                         \
+			op_##hex_:                                   \
+                                                         \
+				op##hex_();                              \
+				ExecuteHooks<NUM_HOOKS>( first, last );  \
+                                                         \
+				if (cycles.count >= cycles.round)        \
+					return;                              \
+                                                         \
+				cycles.offset = cycles.count;            \
+				goto *labels[opcode = FetchPc8()];
+
+			NES_OPS
+			#undef NES_OP
+		}
+
+		#elif NST_CPU_DISPATCH == NST_CPU_DISPATCH_SWITCH
+
+		template<uint NUM_HOOKS>
+		inline void Cpu::ExecuteOps(const Hook* const first,const Hook* const last)
+		{
+			do
+			{
+				cycles.offset = cycles.count;
+
+				switch (opcode = FetchPc8())
+				{
+					#define NES_OP(hex_) case hex_: op##hex_(); break;
+					NES_OPS
+					#undef NES_OP
+				}
+
+				ExecuteHooks<NUM_HOOKS>( first, last );
+			}
+			while (cycles.count < cycles.round);
+		}
+
+		#else
+
+		template<uint NUM_HOOKS>
+		inline void Cpu::ExecuteOps(const Hook* const first,const Hook* const last)
+		{
+			do
+			{
+				cycles.offset = cycles.count;
+				(*this.*opcodes[opcode=FetchPc8()])();
+
+				ExecuteHooks<NUM_HOOKS>( first, last );
+			}
+			while (cycles.count < cycles.round);
+		}
+
+		#endif
+
+		template<uint NUM_HOOKS>
+		void Cpu::Run()
+		{
+			const Hook* const first = hooks.Ptr();
+			const Hook* const last = (NUM_HOOKS ? first + (hooks.Size() - 1) : first);
+
+			do
+			{
+				ExecuteOps<NUM_HOOKS>( first, last );
+
+				if (events.Next() <= cycles.count)
+					events.Execute( cycles.count );
+
+				Clock();
+			}
+			while (cycles.count < cycles.frame);
+		}
+
+		#undef NES_OPS_ROW
+		#undef NES_OPS
 	}
 }
@@ -36,6 +36,24 @@
 #pragma once
 #endif
 
+// Instruction dispatch, can be overridden by defining NST_CPU_DISPATCH:
+//
+// NST_CPU_DISPATCH_TABLE  - member function pointer table, one indirect call per instruction
+// NST_CPU_DISPATCH_SWITCH - all opcodes inlined into a single switch
+// NST_CPU_DISPATCH_GOTO   - threaded code through computed goto, GCC and Clang only
+
+#define NST_CPU_DISPATCH_TABLE  0
+#define NST_CPU_DISPATCH_SWITCH 1
+#define NST_CPU_DISPATCH_GOTO   2
+
+#ifndef NST_CPU_DISPATCH
+ #if NST_GCC
+  #define NST_CPU_DISPATCH NST_CPU_DISPATCH_GOTO
+ #else
+  #define NST_CPU_DISPATCH NST_CPU_DISPATCH_SWITCH
+ #endif
+#endif
+
 namespace HQRemote{
 	struct Event;
 }
@@ -95,6 +113,8 @@ namespace Nes
 			void SetModel(CpuModel);
 			void AddHook(const Hook&);
 			void RemoveHook(const Hook&);
+			void Schedule(const Hook&,Cycle);
+			void Unschedule(const Hook&);
 
 			void SaveState(State::Saver&,dword,dword) const;
 			void LoadState(State::Loader&,dword,dword,dword);
@@ -105,6 +125,10 @@ namespace Nes
 			bool ModifyPadState(uint& padButtons, uint idx) const;//use this to modify the controller pad's state using remote engine
 			uint64_t GetLastReceivedRemoteInput() const { return lastReceivedRemoteInputId; }
 			void ResetRemoteInput();
+			//lockstep netplay: pads' states come from the netplay input queues instead of local or remote devices.
+			//<pads> holds 4 pads' buttons, pass NULL to go back to normal input
+			void SetLockstepPads(const uint* pads);
+			bool GetLockstepPadState(uint& padButtons, uint idx) const;
 		private:
 
 			static void NotifyOp(const char (&)[4],dword);
@@ -141,11 +165,9 @@ namespace Nes
 			uint FetchIRQISRVector();
 			void Clock();
 
-			void Run0();
-			void Run1();
-			void Run2();
-
-			inline void ExecuteOp();
+			template<uint NUM_HOOKS> void Run();
+			template<uint NUM_HOOKS> inline void ExecuteOps(const Hook*,const Hook*);
+			template<uint NUM_HOOKS> inline void ExecuteHooks(const Hook*,const Hook*) const;
 			inline uint FetchPc8();
 			inline uint FetchPc16();
 			inline uint FetchZpg16(uint) const;
@@ -429,6 +451,36 @@ namespace Nes
 				word capacity;
 			};
 
+			class Events
+			{
+			public:
+
+				Events();
+				~Events();
+
+				void Set(const Hook&,Cycle);
+				void Remove(const Hook&);
+				void Execute(Cycle);
+				void EndFrame(Cycle);
+				void Clear();
+
+				Cycle Next() const
+				{
+					return next;
+				}
+
+			private:
+
+				void Update();
+
+				struct Event;
+
+				Event* events;
+				word size;
+				word capacity;
+				Cycle next;
+			};
+
 			struct Ram
 			{
 				typedef byte (&Ref)[RAM_SIZE];
@@ -456,6 +508,32 @@ namespace Nes
 				inline uint Peek8(uint) const;
 				inline uint Peek16(uint) const;
 				inline void Poke8(uint,uint) const;
+
+				void SetDirect(Address,Address,const byte* const*,uint);
+				void Invalidate(Address,Address);
+				void ClearDirect();
+				void Validate();
+
+				// 256 byte pages read straight from memory,
+				// NULL bank means the page goes through its ports
+
+				struct Page
+				{
+					const byte* const* bank;
+					uint mask;
+				};
+
+				struct Direct
+				{
+					Io::Port port;
+					const byte* const* bank;
+					uint mask;
+					bool dirty;
+				};
+
+				Page readPages[NUM_PAGES];
+				Direct direct[SIZE >> PAGE_SHIFT];
+				bool dirty;
 			};
 
 			class Linker
@@ -490,21 +568,27 @@ namespace Nes
 			Flags flags;
 			Interrupt interrupt;
 			Hooks hooks;
+			Events events;
 			uint opcode;
 			word jammed;
 			word model;
 			Linker linker;
 			qaword ticks;
 			Ram ram;
+			const byte* const ramBank;
 			Apu apu;
 			IoMap map;
 
 			uint remoteControllerIdx;
 			uint remoteInput;
 			uint64_t lastReceivedRemoteInputId;
+			uint lockstepPads[4];
+			bool lockstepPadsEnabled;
 
 			static dword logged;
+		#if NST_CPU_DISPATCH == NST_CPU_DISPATCH_TABLE
 			static void (Cpu::*const opcodes[0x100])();
+		#endif
 			static const byte writeClocks[0x100];
 
 		public:
@@ -592,25 +676,44 @@ namespace Nes
 				return ram.mem;
 			}
 
-			Io::Port& Map(Address address)
+			IoMap::Section Map(Address address)
 			{
+				map.Invalidate( address, address );
 				return map( address );
 			}
 
+			const Io::Port& GetPort(Address address) const
+			{
+				return map[address];
+			}
+
 			IoMap::Section Map(Address first,Address last)
 			{
+				map.Invalidate( first, last );
 				return map( first, last );
 			}
 
+			// Lets reads of [first,last] bypass the port currently mapped at 'first'
+			// and fetch from (*bank)[address & mask] for as long as that reader stays
+			// in place. The bank slot is followed on every read, so bank switching
+			// needs no further bookkeeping.
+
+			void MapDirect(Address first,Address last,const byte* const* bank,uint mask)
+			{
+				map.SetDirect( first, last, bank, mask );
+			}
+
 			template<typename T,typename U,typename V>
 			const Io::Port* Link(Address address,Level level,T t,U u,V v)
 			{
+				map.Invalidate( address, address );
 				return linker.Add( address, level, Io::Port(t,u,v), map );
 			}
 
 			template<typename T,typename U,typename V>
 			void Unlink(Address address,T t,U u,V v)
 			{
+				map.Invalidate( address, address );
 				linker.Remove( address, Io::Port(t,u,v), map );
 			}
 		};
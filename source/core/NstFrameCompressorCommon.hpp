@@ -41,6 +41,14 @@
 #define REMOTE_USE_H264 0
 #define REMOTE_USE_VPX 0
 
+// alternative entropy coding backends of indexed color frames, need lz4 & zstd libraries
+#ifndef REMOTE_USE_LZ4
+#	define REMOTE_USE_LZ4 0
+#endif
+#ifndef REMOTE_USE_ZSTD
+#	define REMOTE_USE_ZSTD 0
+#endif
+
 #define NES_WIDTH Core::Video::Screen::WIDTH
 #define NES_HEIGHT Core::Video::Screen::HEIGHT
 
@@ -54,6 +62,8 @@ namespace Nes
 		enum FrameCompressorType {
 			FRAME_COMPRESSOR_TYPE_ZLIB,
 			FRAME_COMPRESSOR_TYPE_H264,
+			FRAME_COMPRESSOR_TYPE_LZ4,
+			FRAME_COMPRESSOR_TYPE_ZSTD,
 		};
 
 		class FrameCompressorOrDecompressorBase {
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#include "NstMachine.hpp"
+#include "NstFrameCompressorLz4.hpp"
+
+#if REMOTE_USE_LZ4
+
+#include <lz4.h>
+
+#include <vector>
+
+#define REMOTE_LZ4_ACCELERATION 1//higher is faster but compresses less
+
+namespace Nes {
+	namespace Core {
+		/* ------------- Lz4FrameCompressor ------------------*/
+		Lz4FrameCompressor::Lz4FrameCompressor(const HQRemote::Engine& server)
+			: ZlibFrameCompressor(FRAME_COMPRESSOR_TYPE_LZ4, server)
+		{
+		}
+
+		HQRemote::DataRef Lz4FrameCompressor::CompressPacked(const void* packed, size_t size) {
+			//compressed data structure = uncompressed size | LZ4 block
+			uint32_t packedSize = (uint32_t)size;
+			std::vector<char> buffer(sizeof(packedSize) + LZ4_compressBound((int)size));
+
+			int compressedSize = LZ4_compress_fast((const char*)packed, buffer.data() + sizeof(packedSize), (int)size, (int)(buffer.size() - sizeof(packedSize)), REMOTE_LZ4_ACCELERATION);
+			if (compressedSize <= 0)
+				return nullptr;
+
+			memcpy(buffer.data(), &packedSize, sizeof(packedSize));
+
+			auto compressed = std::make_shared<HQRemote::CData>(sizeof(packedSize) + compressedSize);
+			memcpy(compressed->data(), buffer.data(), compressed->size());
+
+			return compressed;
+		}
+
+		/*--------------- Lz4FrameDecompressor --------------------*/
+		Lz4FrameDecompressor::Lz4FrameDecompressor(Machine& machine, HQRemote::Client& client)
+			: ZlibFrameDecompressor(FRAME_COMPRESSOR_TYPE_LZ4, machine, client)
+		{}
+
+		HQRemote::DataRef Lz4FrameDecompressor::DecompressPacked(const void* compressed, size_t size) {
+			uint32_t packedSize;
+			if (size < sizeof(packedSize))
+				return nullptr;
+
+			memcpy(&packedSize, compressed, sizeof(packedSize));
+			if (packedSize == 0 || packedSize > MAX_PACKED_FRAME_SIZE)//corruption
+				return nullptr;
+
+			auto packed = std::make_shared<HQRemote::CData>(packedSize);
+			int decompressedSize = LZ4_decompress_safe((const char*)compressed + sizeof(packedSize), (char*)packed->data(), (int)(size - sizeof(packedSize)), (int)packedSize);
+			if (decompressedSize != (int)packedSize)//corruption
+				return nullptr;
+
+			return packed;
+		}
+	}
+}
+
+#endif//if REMOTE_USE_LZ4
@@ -0,0 +1,50 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "NstFrameCompressorZlib.hpp"
+
+#if REMOTE_USE_LZ4
+
+namespace Nes {
+	namespace Core {
+		// same indexed color packing as zlib frame compressor, but entropy coded by LZ4 which is much cheaper than deflate
+		class Lz4FrameCompressor : public ZlibFrameCompressor {
+		public:
+			Lz4FrameCompressor(const HQRemote::Engine& server);
+		protected:
+			virtual HQRemote::DataRef CompressPacked(const void* packed, size_t size) override;
+		};
+
+		class Lz4FrameDecompressor : public ZlibFrameDecompressor {
+		public:
+			Lz4FrameDecompressor(Machine& machine, HQRemote::Client& client);
+		protected:
+			virtual HQRemote::DataRef DecompressPacked(const void* compressed, size_t size) override;
+		};
+	}
+}
+
+#endif//if REMOTE_USE_LZ4
@@ -0,0 +1,551 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#include "NstFrameCompressorPacker.hpp"
+
+#include <string.h>
+
+namespace Nes {
+	namespace Core {
+		namespace FramePacker {
+			/*
+			Bulk packer: if every value v in the block satisfies 0 <= v + bias < 8, it can be encoded by a single
+			ULEB128Ex/SLEB128Ex half byte which is (v & 0x7) without the continuation bit. Two half bytes are stored
+			per byte, lower half first. Returns false without touching <out> if any value needs more than one half byte.
+			bias = 0 for ULEB128Ex (range [0, 7]), bias = 4 for SLEB128Ex (range [-4, 3]).
+			*/
+#if REMOTE_FRAME_PACKER_AVX2
+			static inline __m256i packPairs(__m256i v) {
+				v = _mm256_and_si256(v, _mm256_set1_epi16(0x7));
+				//lower byte of each 32 bit lane = v[2k] | (v[2k + 1] << 4)
+				return _mm256_and_si256(_mm256_or_si256(v, _mm256_srli_epi32(v, 12)), _mm256_set1_epi32(0xff));
+			}
+
+			static inline bool packBlock(const int16_t* values, int16_t bias, unsigned char* out) {
+				const __m256i vBias = _mm256_set1_epi16(bias);
+				const __m256i vMask = _mm256_set1_epi16(~0x7);
+
+				__m256i v0 = _mm256_loadu_si256((const __m256i*)values);
+				__m256i v1 = _mm256_loadu_si256((const __m256i*)(values + 16));
+
+				__m256i outOfRange = _mm256_or_si256(
+					_mm256_and_si256(_mm256_add_epi16(v0, vBias), vMask),
+					_mm256_and_si256(_mm256_add_epi16(v1, vBias), vMask));
+				if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(outOfRange, _mm256_setzero_si256())) != -1)
+					return false;
+
+				//packs_epi32 interleaves the 128 bit lanes, restore the order before narrowing to bytes
+				__m256i words = _mm256_packs_epi32(packPairs(v0), packPairs(v1));
+				words = _mm256_permute4x64_epi64(words, _MM_SHUFFLE(3, 1, 2, 0));
+
+				__m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+				_mm_storeu_si128((__m128i*)out, bytes);
+
+				return true;
+			}
+#elif REMOTE_FRAME_PACKER_SSE2
+			static inline __m128i packPairs(__m128i v) {
+				v = _mm_and_si128(v, _mm_set1_epi16(0x7));
+				//lower byte of each 32 bit lane = v[2k] | (v[2k + 1] << 4)
+				return _mm_and_si128(_mm_or_si128(v, _mm_srli_epi32(v, 12)), _mm_set1_epi32(0xff));
+			}
+
+			static inline bool packBlock(const int16_t* values, int16_t bias, unsigned char* out) {
+				const __m128i vBias = _mm_set1_epi16(bias);
+				const __m128i vMask = _mm_set1_epi16(~0x7);
+
+				__m128i v0 = _mm_loadu_si128((const __m128i*)values);
+				__m128i v1 = _mm_loadu_si128((const __m128i*)(values + 8));
+				__m128i v2 = _mm_loadu_si128((const __m128i*)(values + 16));
+				__m128i v3 = _mm_loadu_si128((const __m128i*)(values + 24));
+
+				__m128i outOfRange = _mm_or_si128(
+					_mm_or_si128(_mm_and_si128(_mm_add_epi16(v0, vBias), vMask), _mm_and_si128(_mm_add_epi16(v1, vBias), vMask)),
+					_mm_or_si128(_mm_and_si128(_mm_add_epi16(v2, vBias), vMask), _mm_and_si128(_mm_add_epi16(v3, vBias), vMask)));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(outOfRange, _mm_setzero_si128())) != 0xffff)
+					return false;
+
+				__m128i words0 = _mm_packs_epi32(packPairs(v0), packPairs(v1));
+				__m128i words1 = _mm_packs_epi32(packPairs(v2), packPairs(v3));
+				_mm_storeu_si128((__m128i*)out, _mm_packus_epi16(words0, words1));
+
+				return true;
+			}
+#elif REMOTE_FRAME_PACKER_NEON
+			static inline uint8x8_t packPairs(uint16x8_t evens, uint16x8_t odds) {
+				const uint16x8_t v7 = vdupq_n_u16(0x7);
+				return vmovn_u16(vorrq_u16(vandq_u16(evens, v7), vshlq_n_u16(vandq_u16(odds, v7), 4)));
+			}
+
+			static inline bool packBlock(const int16_t* values, int16_t bias, unsigned char* out) {
+				const uint16x8_t vBias = vdupq_n_u16((uint16_t)bias);
+				const uint16x8_t vMask = vdupq_n_u16((uint16_t)~0x7);
+
+				uint16x8_t v0 = vreinterpretq_u16_s16(vld1q_s16(values));
+				uint16x8_t v1 = vreinterpretq_u16_s16(vld1q_s16(values + 8));
+				uint16x8_t v2 = vreinterpretq_u16_s16(vld1q_s16(values + 16));
+				uint16x8_t v3 = vreinterpretq_u16_s16(vld1q_s16(values + 24));
+
+				uint16x8_t outOfRange = vorrq_u16(
+					vorrq_u16(vandq_u16(vaddq_u16(v0, vBias), vMask), vandq_u16(vaddq_u16(v1, vBias), vMask)),
+					vorrq_u16(vandq_u16(vaddq_u16(v2, vBias), vMask), vandq_u16(vaddq_u16(v3, vBias), vMask)));
+				uint64x2_t outOfRange64 = vreinterpretq_u64_u16(outOfRange);
+				if ((vgetq_lane_u64(outOfRange64, 0) | vgetq_lane_u64(outOfRange64, 1)) != 0)
+					return false;
+
+				uint16x8x2_t pairs0 = vuzpq_u16(v0, v1);
+				uint16x8x2_t pairs1 = vuzpq_u16(v2, v3);
+				vst1q_u8(out, vcombine_u8(packPairs(pairs0.val[0], pairs0.val[1]), packPairs(pairs1.val[0], pairs1.val[1])));
+
+				return true;
+			}
+#else
+			static inline bool packBlock(const int16_t* values, int16_t bias, unsigned char* out) {
+				uint outOfRange = 0;
+				for (uint i = 0; i < BLOCK_PIXELS; ++i)
+					outOfRange |= uint16_t(values[i] + bias) & ~0x7u;
+				if (outOfRange)
+					return false;
+
+				for (uint i = 0; i < BLOCK_PIXELS / 2; ++i)
+					out[i] = (unsigned char)((values[2 * i] & 0x7) | ((values[2 * i + 1] & 0x7) << 4));
+
+				return true;
+			}
+#endif
+
+			template<bool SIGNED>
+			static void packValues(const int16_t* values, uint count, unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset) {
+				const int16_t bias = SIGNED ? 4 : 0;
+
+				unsigned char* p = packedPixels;
+				unsigned int bitOffset = packedPixelsBitOffset;
+
+				uint i = 0;
+				while (i < count) {
+					uint end = i + BLOCK_PIXELS;
+					if (bitOffset == 0 && end <= count && packBlock(values + i, bias, p))
+					{
+						p += BLOCK_PIXELS / 2;
+						i = end;
+						continue;
+					}
+
+					//fallback to per pixel encoding. If we are in the middle of a byte, encode a single pixel to
+					//give the next block a chance to be byte aligned.
+					if (bitOffset != 0)
+						end = i + 1;
+					else if (end > count)
+						end = count;
+
+					for (; i < end; ++i) {
+						if (SIGNED)
+							encodeSLEB128Ex(values[i], p, bitOffset, &p, &bitOffset);
+						else
+							encodeULEB128Ex((uint16_t)values[i], p, bitOffset, &p, &bitOffset);
+					}
+				}//while (i < count)
+
+#if defined DEBUG || defined _DEBUG
+				//verify the packed values
+				const unsigned char* decodePtr = packedPixels;
+				unsigned int decodeBitOffset = packedPixelsBitOffset;
+				for (i = 0; i < count; ++i) {
+					int32_t decoded = SIGNED ?
+						decodeSLEB128Ex(decodePtr, decodeBitOffset, &decodePtr, &decodeBitOffset) :
+						(int32_t)decodeULEB128Ex(decodePtr, decodeBitOffset, &decodePtr, &decodeBitOffset);
+					assert(decoded == values[i]);
+				}
+#endif
+
+				packedPixels = p;
+				packedPixelsBitOffset = bitOffset;
+			}
+
+			void PackColorRow(
+				const Video::Screen::Pixel* pixels, const uint16_t* remapTbl, Video::Screen::Pixel* keyframePixels, uint count,
+				unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset)
+			{
+				int16_t values[Video::Screen::WIDTH];
+
+				while (count) {
+					const uint chunk = count < Video::Screen::WIDTH ? count : uint(Video::Screen::WIDTH);
+
+					for (uint x = 0; x < chunk; ++x)
+						values[x] = (int16_t)(remapTbl ? remapTbl[pixels[x]] : pixels[x]);
+
+					if (keyframePixels)
+					{
+						for (uint x = 0; x < chunk; ++x)
+							keyframePixels[x] = (Video::Screen::Pixel)values[x];
+						keyframePixels += chunk;
+					}
+
+					packValues<false>(values, chunk, packedPixels, packedPixelsBitOffset);
+
+					pixels += chunk;
+					count -= chunk;
+				}
+			}
+
+			void PackDeltaRow(
+				const Video::Screen::Pixel* pixels, const uint16_t* remapTbl, const Video::Screen::Pixel* keyframePixels, uint count,
+				unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset)
+			{
+				int16_t values[Video::Screen::WIDTH];
+
+				while (count) {
+					const uint chunk = count < Video::Screen::WIDTH ? count : uint(Video::Screen::WIDTH);
+
+					for (uint x = 0; x < chunk; ++x)
+						values[x] = (int16_t)((remapTbl ? remapTbl[pixels[x]] : pixels[x]) - keyframePixels[x]);
+
+					packValues<true>(values, chunk, packedPixels, packedPixelsBitOffset);
+
+					pixels += chunk;
+					keyframePixels += chunk;
+					count -= chunk;
+				}
+			}
+
+			/*
+			Bulk unpacker: expands 16 bytes into 32 pixels if none of the half bytes has the continuation bit set.
+			Returns false without touching <pixels> otherwise. If <keyframePixels> is not NULL, the unpacked values
+			are treated as SLEB128Ex deltas and added to keyframe's color indices.
+			*/
+#if REMOTE_FRAME_PACKER_SSE2
+			static inline __m128i unpackWords(__m128i nibbles, bool isSigned, bool high) {
+				if (isSigned)
+				{
+					//sign extend the 3 bit values, then the bytes
+					const __m128i v4 = _mm_set1_epi8(0x4);
+					nibbles = _mm_sub_epi8(_mm_xor_si128(nibbles, v4), v4);
+					__m128i bytes = high ? _mm_unpackhi_epi8(nibbles, nibbles) : _mm_unpacklo_epi8(nibbles, nibbles);
+					return _mm_srai_epi16(bytes, 8);
+				}
+
+				return high ? _mm_unpackhi_epi8(nibbles, _mm_setzero_si128()) : _mm_unpacklo_epi8(nibbles, _mm_setzero_si128());
+			}
+
+			static inline bool unpackBlock(const unsigned char* packed, const Video::Screen::Pixel* keyframePixels, uint numColors, Video::Screen::Pixel* pixels) {
+				__m128i bytes = _mm_loadu_si128((const __m128i*)packed);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(bytes, _mm_set1_epi8((char)0x88)), _mm_setzero_si128())) != 0xffff)
+					return false;
+
+				const __m128i v7 = _mm_set1_epi8(0x7);
+				__m128i lo = _mm_and_si128(bytes, v7);
+				__m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), v7);
+
+				//half bytes in stream order
+				__m128i nibbles[2] = { _mm_unpacklo_epi8(lo, hi), _mm_unpackhi_epi8(lo, hi) };
+
+				//unsigned comparison through signed one
+				const __m128i vSign = _mm_set1_epi16((short)0x8000);
+				const __m128i vNumColors = _mm_xor_si128(_mm_set1_epi16((short)numColors), vSign);
+
+				const bool isSigned = keyframePixels != NULL;
+				for (uint i = 0; i < 4; ++i) {
+					__m128i words = unpackWords(nibbles[i >> 1], isSigned, (i & 1) != 0);
+					if (isSigned)
+						words = _mm_add_epi16(words, _mm_loadu_si128((const __m128i*)(keyframePixels + 8 * i)));
+
+					__m128i valid = _mm_cmplt_epi16(_mm_xor_si128(words, vSign), vNumColors);
+					_mm_storeu_si128((__m128i*)(pixels + 8 * i), _mm_and_si128(words, valid));
+				}
+
+				return true;
+			}
+#elif REMOTE_FRAME_PACKER_NEON
+			static inline bool unpackBlock(const unsigned char* packed, const Video::Screen::Pixel* keyframePixels, uint numColors, Video::Screen::Pixel* pixels) {
+				uint8x16_t bytes = vld1q_u8(packed);
+				uint64x2_t continuation = vreinterpretq_u64_u8(vandq_u8(bytes, vdupq_n_u8(0x88)));
+				if ((vgetq_lane_u64(continuation, 0) | vgetq_lane_u64(continuation, 1)) != 0)
+					return false;
+
+				const uint8x16_t v7 = vdupq_n_u8(0x7);
+				const uint16x8_t vNumColors = vdupq_n_u16((uint16_t)numColors);
+
+				//half bytes in stream order
+				uint8x16x2_t nibbles = vzipq_u8(vandq_u8(bytes, v7), vandq_u8(vshrq_n_u8(bytes, 4), v7));
+
+				const bool isSigned = keyframePixels != NULL;
+				for (uint i = 0; i < 4; ++i) {
+					uint8x16_t half = nibbles.val[i >> 1];
+					uint16x8_t words;
+					if (isSigned)
+					{
+						//sign extend the 3 bit values
+						const uint8x16_t v4 = vdupq_n_u8(0x4);
+						int8x16_t signedHalf = vreinterpretq_s8_u8(vsubq_u8(veorq_u8(half, v4), v4));
+						words = vreinterpretq_u16_s16(vmovl_s8((i & 1) ? vget_high_s8(signedHalf) : vget_low_s8(signedHalf)));
+						words = vaddq_u16(words, vld1q_u16(keyframePixels + 8 * i));
+					}
+					else
+					{
+						words = vmovl_u8((i & 1) ? vget_high_u8(half) : vget_low_u8(half));
+					}
+
+					vst1q_u16(pixels + 8 * i, vandq_u16(words, vcltq_u16(words, vNumColors)));
+				}
+
+				return true;
+			}
+#else
+			static inline bool unpackBlock(const unsigned char* packed, const Video::Screen::Pixel* keyframePixels, uint numColors, Video::Screen::Pixel* pixels) {
+				uint continuation = 0;
+				for (uint i = 0; i < BLOCK_PIXELS / 2; ++i)
+					continuation |= packed[i] & 0x88;
+				if (continuation)
+					return false;
+
+				for (uint i = 0; i < BLOCK_PIXELS; ++i) {
+					uint value = (packed[i >> 1] >> ((i & 1) * 4)) & 0x7;
+					if (keyframePixels)
+						value = Video::Screen::Pixel(((value ^ 0x4) - 0x4) + keyframePixels[i]);
+
+					pixels[i] = value < numColors ? value : 0;
+				}
+
+				return true;
+			}
+#endif
+
+			//same as decodeULEB128Ex()/decodeSLEB128Ex() but never reads at or beyond <pEnd>
+			template<bool SIGNED>
+			static inline bool decodeValueChecked(const unsigned char*& p, unsigned int& bitOffset, const unsigned char* pEnd, int32_t& value) {
+				int32_t result = 0;
+				unsigned int shift = 0;
+				unsigned char halfByte;
+				int steps = 0;//in case the data is corrupted
+				do {
+					if (p >= pEnd)
+						return false;
+
+					halfByte = ((*p) >> bitOffset) & 0xf;
+					result |= (halfByte & 0x7) << shift;
+					shift += 3;
+
+					bitOffset += 4;
+					if (bitOffset == 8)
+					{
+						p++;
+						bitOffset = 0;
+					}
+				} while (halfByte >= 0x8 && (++steps) < 4);
+
+				//sign extend negative numbers.
+				if (SIGNED && (halfByte & 0x4))
+					result |= int32_t(~uint32_t(0) << shift);
+
+				value = result;
+
+				return true;
+			}
+
+			template<bool SIGNED>
+			static bool unpackValues(
+				const unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset, const unsigned char* pEnd, uint numColors,
+				Video::Screen::Pixel* pixels, const Video::Screen::Pixel* keyframePixels, uint count)
+			{
+				const unsigned char* p = packedPixels;
+				unsigned int bitOffset = packedPixelsBitOffset;
+
+				uint i = 0;
+				while (i < count) {
+					uint end = i + BLOCK_PIXELS;
+					if (bitOffset == 0 && end <= count && pEnd - p >= BLOCK_PIXELS / 2 &&
+						unpackBlock(p, SIGNED ? keyframePixels + i : NULL, numColors, pixels + i))
+					{
+						p += BLOCK_PIXELS / 2;
+						i = end;
+						continue;
+					}
+
+					//fallback to per pixel decoding. If we are in the middle of a byte, decode a single pixel to
+					//give the next block a chance to be byte aligned.
+					if (bitOffset != 0)
+						end = i + 1;
+					else if (end > count)
+						end = count;
+
+					for (; i < end; ++i) {
+						int32_t value;
+						if (!decodeValueChecked<SIGNED>(p, bitOffset, pEnd, value))
+							return false;
+
+						Video::Screen::Pixel colorIdx = SIGNED ? value + keyframePixels[i] : value;
+						pixels[i] = colorIdx < numColors ? colorIdx : 0;
+					}
+				}//while (i < count)
+
+				packedPixels = p;
+				packedPixelsBitOffset = bitOffset;
+
+				return true;
+			}
+
+			bool UnpackColorRow(
+				const unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset, const unsigned char* pEnd, uint numColors,
+				Video::Screen::Pixel* pixels, Video::Screen::Pixel* keyframePixels, uint count)
+			{
+				if (!unpackValues<false>(packedPixels, packedPixelsBitOffset, pEnd, numColors, pixels, NULL, count))
+					return false;
+
+				if (keyframePixels)
+					memcpy(keyframePixels, pixels, count * sizeof(pixels[0]));
+
+				return true;
+			}
+
+			bool UnpackDeltaRow(
+				const unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset, const unsigned char* pEnd, uint numColors,
+				Video::Screen::Pixel* pixels, const Video::Screen::Pixel* keyframePixels, uint count)
+			{
+				return unpackValues<true>(packedPixels, packedPixelsBitOffset, pEnd, numColors, pixels, keyframePixels, count);
+			}
+
+			void PackDeltaTiles(
+				const Video::Screen::Pixel* pixels, const uint16_t* remapTbl, const Video::Screen::Pixel* keyframePixels,
+				uint tileRowBegin, uint tileRowEnd,
+				unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset)
+			{
+				assert(packedPixelsBitOffset == 0);
+				assert(tileRowBegin <= tileRowEnd && tileRowEnd <= TILES_Y);
+
+				const uint bitmapSize = DirtyTilesBitmapSize(tileRowEnd - tileRowBegin);
+				unsigned char* dirtyTiles = packedPixels;
+				memset(dirtyTiles, 0, bitmapSize);
+				packedPixels += bitmapSize;
+
+				int16_t values[TILE_SIZE][Video::Screen::WIDTH];
+				bool dirty[TILES_X];
+
+				for (uint ty = tileRowBegin; ty < tileRowEnd; ++ty) {
+					const uint offset = ty * TILE_SIZE * Video::Screen::WIDTH;
+
+					//compute the differences of the whole tile row first
+					for (uint r = 0; r < TILE_SIZE; ++r) {
+						const Video::Screen::Pixel* row = pixels + offset + r * Video::Screen::WIDTH;
+						const Video::Screen::Pixel* keyframeRow = keyframePixels + offset + r * Video::Screen::WIDTH;
+
+						for (uint x = 0; x < Video::Screen::WIDTH; ++x)
+							values[r][x] = (int16_t)((remapTbl ? remapTbl[row[x]] : row[x]) - keyframeRow[x]);
+					}
+
+					for (uint tx = 0; tx < TILES_X; ++tx) {
+						int16_t changes = 0;
+						for (uint r = 0; r < TILE_SIZE; ++r)
+							for (uint x = tx * TILE_SIZE; x < (tx + 1) * TILE_SIZE; ++x)
+								changes |= values[r][x];
+
+						dirty[tx] = changes != 0;
+						if (dirty[tx])
+						{
+							const uint tile = (ty - tileRowBegin) * TILES_X + tx;
+							dirtyTiles[tile >> 3] |= 1 << (tile & 7);
+						}
+					}
+
+					//pack consecutive dirty tiles as one span so that the bulk packer can process them
+					for (uint r = 0; r < TILE_SIZE; ++r) {
+						for (uint tx = 0; tx < TILES_X;) {
+							if (!dirty[tx])
+							{
+								++tx;
+								continue;
+							}
+
+							uint txEnd = tx + 1;
+							while (txEnd < TILES_X && dirty[txEnd])
+								++txEnd;
+
+							packValues<true>(values[r] + tx * TILE_SIZE, (txEnd - tx) * TILE_SIZE, packedPixels, packedPixelsBitOffset);
+
+							tx = txEnd;
+						}
+					}//for (uint r = 0; r < TILE_SIZE; ++r)
+				}//for (uint ty = tileRowBegin; ty < tileRowEnd; ++ty)
+			}
+
+			bool UnpackDeltaTiles(
+				const unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset, const unsigned char* pEnd, uint numColors,
+				Video::Screen::Pixel* pixels, const Video::Screen::Pixel* keyframePixels,
+				uint tileRowBegin, uint tileRowEnd)
+			{
+				if (tileRowBegin > tileRowEnd || tileRowEnd > TILES_Y)
+					return false;
+
+				const uint bitmapSize = DirtyTilesBitmapSize(tileRowEnd - tileRowBegin);
+				if (packedPixelsBitOffset != 0 || (size_t)(pEnd - packedPixels) < bitmapSize)
+					return false;
+
+				const unsigned char* dirtyTiles = packedPixels;
+				const unsigned char* p = packedPixels + bitmapSize;
+				unsigned int bitOffset = 0;
+
+				bool dirty[TILES_X];
+
+				for (uint ty = tileRowBegin; ty < tileRowEnd; ++ty) {
+					for (uint tx = 0; tx < TILES_X; ++tx) {
+						const uint tile = (ty - tileRowBegin) * TILES_X + tx;
+						dirty[tx] = (dirtyTiles[tile >> 3] & (1 << (tile & 7))) != 0;
+					}
+
+					for (uint r = 0; r < TILE_SIZE; ++r) {
+						const uint offset = (ty * TILE_SIZE + r) * Video::Screen::WIDTH;
+						Video::Screen::Pixel* row = pixels + offset;
+						const Video::Screen::Pixel* keyframeRow = keyframePixels + offset;
+
+						for (uint tx = 0; tx < TILES_X;) {
+							uint txEnd = tx + 1;
+							while (txEnd < TILES_X && dirty[txEnd] == dirty[tx])
+								++txEnd;
+
+							const uint x = tx * TILE_SIZE;
+							const uint count = (txEnd - tx) * TILE_SIZE;
+							if (dirty[tx])
+							{
+								if (!unpackValues<true>(p, bitOffset, pEnd, numColors, row + x, keyframeRow + x, count))
+									return false;
+							}
+							else
+							{
+								//unchanged pixels
+								for (uint i = x; i < x + count; ++i)
+									row[i] = keyframeRow[i] < numColors ? keyframeRow[i] : 0;
+							}
+
+							tx = txEnd;
+						}
+					}//for (uint r = 0; r < TILE_SIZE; ++r)
+				}//for (uint ty = tileRowBegin; ty < tileRowEnd; ++ty)
+
+				packedPixels = p;
+				packedPixelsBitOffset = bitOffset;
+
+				return true;
+			}
+		}
+	}
+}
@@ -0,0 +1,222 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "NstBase.hpp"
+#include "NstVideoScreen.hpp"
+
+#include <assert.h>
+
+#if defined __AVX2__
+#	define REMOTE_FRAME_PACKER_AVX2 1
+#	define REMOTE_FRAME_PACKER_SSE2 1
+#	include <immintrin.h>
+#elif defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#	define REMOTE_FRAME_PACKER_SSE2 1
+#	include <emmintrin.h>
+#elif defined __ARM_NEON || defined __ARM_NEON__
+#	define REMOTE_FRAME_PACKER_NEON 1
+#	include <arm_neon.h>
+#endif
+
+namespace Nes {
+	namespace Core {
+		namespace FramePacker {
+			//number of pixels packed at once by the bulk packer
+			enum {
+				BLOCK_PIXELS = 32
+			};
+
+			//granularity of the dirty tiles bitmap used by REMOTE_FRAME_FORMAT_DIRTY_TILES
+			enum {
+				TILE_SIZE = 8,
+				TILES_X = Video::Screen::WIDTH / TILE_SIZE,
+				TILES_Y = Video::Screen::HEIGHT / TILE_SIZE,
+				DIRTY_TILES_BITMAP_SIZE = (TILES_X * TILES_Y + 7) / 8
+			};
+
+			//size of the dirty tiles bitmap covering <numTileRows> rows of tiles
+			static inline uint DirtyTilesBitmapSize(uint numTileRows) {
+				return (numTileRows * TILES_X + 7) / 8;
+			}
+
+			//encode a ULEB128Ex value.
+			static inline void encodeULEB128Ex(uint32_t Value, unsigned char *p, unsigned int bitOffset, unsigned char** nextAddr, unsigned int *nextBitOffset) {
+				assert(bitOffset < 8 && (bitOffset % 4) == 0);
+
+				do {
+					unsigned char HalfByte = Value & 0x7;
+					Value >>= 3;
+					if (Value != 0)
+						HalfByte |= 0x8; // Mark this half byte to show that more half bytes will follow.
+					*p &= ~(0xf << bitOffset);
+					*p |= HalfByte << bitOffset;
+					bitOffset += 4;
+
+					if (bitOffset == 8)
+					{
+						p++;
+						bitOffset = 0;
+					}
+				} while (Value != 0);
+
+				*nextAddr = p;
+				*nextBitOffset = bitOffset;
+			}
+
+			//decode a ULEB128 value.
+			static inline uint32_t decodeULEB128Ex(const unsigned char* address, unsigned int bitOffset, const unsigned char **nextAddr, unsigned int* nextBitOffset) {
+				assert(bitOffset < 8 && (bitOffset % 4) == 0);
+
+				const unsigned char* p = address;
+				uint32_t value = 0;
+				unsigned int shift = 0;
+				unsigned char halfByte;
+				int steps = 0;//in case the data is corrupted
+				do {
+					halfByte = ((*p) >> bitOffset) & 0xf;
+					value += uint32_t(halfByte & 0x7) << shift;
+					shift += 3;
+
+					bitOffset += 4;
+					if (bitOffset == 8)
+					{
+						p++;
+						bitOffset = 0;
+					}
+				} while (halfByte >= 0x8 && (++steps) < 4);
+
+				*nextAddr = p;
+				*nextBitOffset = bitOffset;
+
+				return value;
+			}
+
+			//encode a SLEB128 value
+			static inline void encodeSLEB128Ex(int32_t Value, unsigned char *p, unsigned int bitOffset, unsigned char** nextAddr, unsigned int *nextBitOffset) {
+				assert(bitOffset < 8 && (bitOffset % 4) == 0);
+
+				bool more;
+				do {
+					unsigned char HalfByte = Value & 0x7;
+					Value >>= 3;
+
+					more = !((((Value == 0) && ((HalfByte & 0x4) == 0)) ||
+						((Value == -1) && ((HalfByte & 0x4) != 0))));
+					if (more)
+						HalfByte |= 0x8; // Mark this half byte to show that more half bytes will follow.
+
+					*p &= ~(0xf << bitOffset);
+					*p |= HalfByte << bitOffset;
+					bitOffset += 4;
+
+					if (bitOffset == 8)
+					{
+						p++;
+						bitOffset = 0;
+					}
+				} while (more);
+
+				*nextAddr = p;
+				*nextBitOffset = bitOffset;
+			}
+
+			//decode a SLEB128 value.
+			static inline int32_t decodeSLEB128Ex(const unsigned char* address, unsigned int bitOffset, const unsigned char **nextAddr, unsigned int* nextBitOffset) {
+				assert(bitOffset < 8 && (bitOffset % 4) == 0);
+
+				const unsigned char* p = address;
+				int32_t value = 0;
+				unsigned int shift = 0;
+				unsigned char halfByte;
+				int steps = 0;//in case the data is corrupted
+				do {
+					halfByte = ((*p) >> bitOffset) & 0xf;
+					value |= (halfByte & 0x7) << shift;
+					shift += 3;
+
+					bitOffset += 4;
+					if (bitOffset == 8)
+					{
+						p++;
+						bitOffset = 0;
+					}
+				} while (halfByte >= 0x8 && (++steps) < 4);
+
+				//sign extend negative numbers.
+				if (halfByte & 0x4)
+					value |= int32_t(~uint32_t(0) << shift);
+
+				*nextAddr = p;
+				*nextBitOffset = bitOffset;
+
+				return value;
+			}
+
+			//Pack one row of pixels' remapped color indices as ULEB128Ex half bytes.
+			//<remapTbl> can be NULL if no remapping is needed. If <keyframePixels> is not NULL, the remapped indices
+			//will be cached there. The output is byte-identical to calling encodeULEB128Ex() on every pixel.
+			void PackColorRow(
+				const Video::Screen::Pixel* pixels, const uint16_t* remapTbl, Video::Screen::Pixel* keyframePixels, uint count,
+				unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset);
+
+			//Pack one row of pixels' remapped color indices as SLEB128Ex half bytes of the differences from
+			//keyframe's color indices. The output is byte-identical to calling encodeSLEB128Ex() on every pixel.
+			void PackDeltaRow(
+				const Video::Screen::Pixel* pixels, const uint16_t* remapTbl, const Video::Screen::Pixel* keyframePixels, uint count,
+				unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset);
+
+			//Unpack one row of ULEB128Ex encoded color indices. Indices not less than <numColors> are replaced by zero.
+			//If <keyframePixels> is not NULL, the unpacked indices will be cached there.
+			//Returns false if the packed row would run past <pEnd>.
+			bool UnpackColorRow(
+				const unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset, const unsigned char* pEnd, uint numColors,
+				Video::Screen::Pixel* pixels, Video::Screen::Pixel* keyframePixels, uint count);
+
+			//Unpack one row of SLEB128Ex encoded differences and add them to keyframe's color indices.
+			//Indices not less than <numColors> are replaced by zero.
+			//Returns false if the packed row would run past <pEnd>.
+			bool UnpackDeltaRow(
+				const unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset, const unsigned char* pEnd, uint numColors,
+				Video::Screen::Pixel* pixels, const Video::Screen::Pixel* keyframePixels, uint count);
+
+			//Pack the differences from keyframe of the tile rows [tileRowBegin, tileRowEnd), skipping the 8x8 tiles that are unchanged.
+			//<pixels> & <keyframePixels> point to the whole frames.
+			//Layout = dirty tiles bitmap (one bit per tile, row major, lowest bit first) | SLEB128Ex half bytes of the
+			//dirty tiles' pixels, scanline by scanline. <packedPixelsBitOffset> must be zero.
+			void PackDeltaTiles(
+				const Video::Screen::Pixel* pixels, const uint16_t* remapTbl, const Video::Screen::Pixel* keyframePixels,
+				uint tileRowBegin, uint tileRowEnd,
+				unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset);
+
+			//Unpack the tile rows [tileRowBegin, tileRowEnd) packed by PackDeltaTiles(). Pixels of clean tiles are copied from keyframe.
+			//Returns false if the packed data would run past <pEnd>.
+			bool UnpackDeltaTiles(
+				const unsigned char*& packedPixels, unsigned int& packedPixelsBitOffset, const unsigned char* pEnd, uint numColors,
+				Video::Screen::Pixel* pixels, const Video::Screen::Pixel* keyframePixels,
+				uint tileRowBegin, uint tileRowEnd);
+		}
+	}
+}
@@ -1,32 +1,33 @@
-////////////////////////////////////////////////////////////////////////////////////////
-//
-// Nestopia - NES/Famicom emulator written in C++
-//
-// Copyright (C) 2016-2018 Le Hoang Quyen
-//
-// This file is part of Nestopia.
-//
-// Nestopia is free software; you can redistribute it and/or modify
-// it under the terms of the GNU General Public License as published by
-// the Free Software Foundation; either version 2 of the License, or
-// (at your option) any later version.
-//
-// Nestopia is distributed in the hope that it will be useful,
-// but WITHOUT ANY WARRANTY; without even the implied warranty of
-// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-// GNU General Public License for more details.
-//
-// You should have received a copy of the GNU General Public License
-// along with Nestopia; if not, write to the Free Software
-// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
-//
-////////////////////////////////////////////////////////////////////////////////////////
-
-#include "NstMachine.hpp"
-#include "NstFrameCompressorZlib.hpp"
-#include "NstRemoteEvent.hpp"
-#include "api/NstApiMachine.hpp"
-
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#include "NstMachine.hpp"
+#include "NstFrameCompressorZlib.hpp"
+#include "NstFrameCompressorPacker.hpp"
+#include "NstRemoteEvent.hpp"
+#include "api/NstApiMachine.hpp"
+
 #include <assert.h>
 
 #ifdef WIN32
@@ -37,11 +38,12 @@
 #	include <pthread.h>
 #endif
 
-#define INVALID_FRAME_ID (uint64_t)((int64_t)-1)
-
+#define INVALID_FRAME_ID (uint64_t)((int64_t)-1)
+
 #define ENABLE_REMAP_REMOTE_COLOR 1
 #define ENABLE_REMOTE_KEYFRAME 1
 #define ENABLE_REMOTE_FRAME_COMPRESS 1
+#define REMOTE_ZLIB_LEVEL (ENABLE_REMOTE_FRAME_COMPRESS ? 0 : -1)
 
 #if ENABLE_REMOTE_FRAME_COMPRESS
 #	define ENABLE_REMOTE_FRAME_SIZE_LIMIT 1
@@ -50,10 +52,36 @@
 
 #define REMOTE_KEYFRAME_INTERVAL 4//interval that one frame becomes keyframe
 
-#define ADAPTIVE_DOWNSAMPLE_FLAG 0x80000000
-
+//keyframe interval when client acknowledges keyframes, it is longer if keyframes don't fit the frame size budget
+#define REMOTE_MIN_KEYFRAME_INTERVAL REMOTE_KEYFRAME_INTERVAL
+#define REMOTE_MAX_KEYFRAME_INTERVAL 120
+#define REMOTE_KEYFRAME_BUDGET_RATIO 0.25//portion of a frame's size budget that a keyframe can take, spread over the interval
+
+//rebuild keyframe from several inter frames' bands of scanlines instead of sending it at once
+#define ENABLE_REMOTE_INTRA_REFRESH 1
+#define REMOTE_INTRA_REFRESH_BANDS 10
+#define REMOTE_INTRA_REFRESH_BAND_HEIGHT (Video::Screen::HEIGHT / REMOTE_INTRA_REFRESH_BANDS)
+#define REMOTE_INTRA_REFRESH_ALL_BANDS ((1 << REMOTE_INTRA_REFRESH_BANDS) - 1)
+#define REMOTE_INTRA_REFRESH_BAND_PIXELS (REMOTE_INTRA_REFRESH_BAND_HEIGHT * Video::Screen::WIDTH)
+#define REMOTE_INTRA_REFRESH_ACK_TIMEOUT 10//frames to wait for a band's acknowledgement before sending it again
+
+//frame is split into slices of tile rows that are packed & compressed in parallel
+#define REMOTE_FRAME_SLICES 4
+#define REMOTE_MAX_FRAME_SLICES 16
+#define REMOTE_SLICED_FRAME_MAGIC 0x43494c53//"SLIC"
+#define REMOTE_MIN_SLICED_PACKED_SIZE (16 * 1024)//small inter frames aren't worth the overhead of several zlib streams
+
+#define ADAPTIVE_DOWNSAMPLE_FLAG 0x80000000
+
+//frame format version is stored in the downsample flag's unused bits, legacy format always has zero there
+#define REMOTE_FRAME_FORMAT_SHIFT 24
+#define REMOTE_FRAME_FORMAT_MASK 0x7f000000
+//so is the intra refresh band (plus 1) carried by the frame
+#define REMOTE_REFRESH_BAND_SHIFT 16
+#define REMOTE_REFRESH_BAND_MASK 0x00ff0000
+
 namespace Nes {
-	namespace Core {
+	namespace Core {
 #if USE_PTHREAD_KEY_FOR_REMOTE_FRAME_COMPRESS
 		static pthread_once_t g_threadKeyCreateOnce = PTHREAD_ONCE_INIT;
 		static pthread_key_t g_threadKey;
@@ -85,139 +113,244 @@ namespace Nes {
 
 			return threadBuffer;
 		}
-#endif//#if USE_PTHREAD_KEY_FOR_REMOTE_FRAME_COMPRESS
-
-		//encode a ULEB128Ex value.
-		static inline void encodeULEB128Ex(uint32_t Value, unsigned char *p, unsigned int bitOffset, unsigned char** nextAddr, unsigned int *nextBitOffset) {
-			assert(bitOffset < 8 && (bitOffset % 4) == 0);
-
-			do {
-				unsigned char HalfByte = Value & 0x7;
-				Value >>= 3;
-				if (Value != 0)
-					HalfByte |= 0x8; // Mark this half byte to show that more half bytes will follow.
-				*p &= ~(0xf << bitOffset);
-				*p |= HalfByte << bitOffset;
-				bitOffset += 4;
-
-				if (bitOffset == 8)
-				{
-					p++;
-					bitOffset = 0;
-				}
-			} while (Value != 0);
+#endif//#if USE_PTHREAD_KEY_FOR_REMOTE_FRAME_COMPRESS
 
-			*nextAddr = p;
-			*nextBitOffset = bitOffset;
+		//first tile row of a slice, slices are aligned to the tile rows so that dirty tiles never straddle two slices
+		static inline uint sliceTileRowBegin(uint slice, uint numSlices)
+		{
+			return slice * FramePacker::TILES_Y / numSlices;
 		}
 
-		//decode a ULEB128 value.
-		static inline uint32_t decodeULEB128Ex(const unsigned char* address, unsigned int bitOffset, const unsigned char **nextAddr, unsigned int* nextBitOffset) {
-			assert(bitOffset < 8 && (bitOffset % 4) == 0);
+		//pack the pixels of tile rows [tileRowBegin, tileRowEnd), returns the address after the packed pixels
+		static unsigned char* packPixels(
+			const Video::Screen* screen, const uint16_t* remapTbl,
+			const Video::Screen::Pixel* referencePixels, Video::Screen::Pixel* keyframePixels,
+			uint32_t frameFormat, size_t stepsY, uint tileRowBegin, uint tileRowEnd,
+			unsigned char* packedPixels)
+		{
+			unsigned int packedPixelsBitOffset = 0;
+			const size_t startY = tileRowBegin * FramePacker::TILE_SIZE;
+			const size_t endY = tileRowEnd * FramePacker::TILE_SIZE;
 
-			const unsigned char* p = address;
-			uint32_t value = 0;
-			unsigned int shift = 0;
-			unsigned char halfByte;
-			int steps = 0;//in case the data is corrupted
-			do {
-				halfByte = ((*p) >> bitOffset) & 0xf;
-				value += uint32_t(halfByte & 0x7) << shift;
-				shift += 3;
+			if (referencePixels == NULL)
+			{
+				//update the pixels & cache the keyframe's pixels at the same time
+				for (size_t y = startY; y < endY; y += stepsY) {
+					size_t i = y * Video::Screen::WIDTH;
+					Video::Screen::Pixel* keyframeRow = keyframePixels ? keyframePixels + i : NULL;
 
-				bitOffset += 4;
-				if (bitOffset == 8)
-				{
-					p++;
-					bitOffset = 0;
-				}
-			} while (halfByte >= 0x8 && (++steps) < 4);
+					FramePacker::PackColorRow(screen->pixels + i, remapTbl, keyframeRow, Video::Screen::WIDTH, packedPixels, packedPixelsBitOffset);
+				}//for (size_t y = startY; y < endY; y += stepsY)
+			}
+			else if (frameFormat >= Remote::REMOTE_FRAME_FORMAT_DIRTY_TILES)
+			{
+				//only store the tiles changed since keyframe
+				FramePacker::PackDeltaTiles(screen->pixels, remapTbl, referencePixels, tileRowBegin, tileRowEnd, packedPixels, packedPixelsBitOffset);
+			}
+			else {
+				//only store the difference between this frame and keyframe
+				for (size_t y = startY; y < endY; y += stepsY) {
+					size_t i = y * Video::Screen::WIDTH;
+
+					FramePacker::PackDeltaRow(screen->pixels + i, remapTbl, referencePixels + i, Video::Screen::WIDTH, packedPixels, packedPixelsBitOffset);
+				}//for (size_t y = startY; y < endY; y += stepsY)
+			}
 
-			*nextAddr = p;
-			*nextBitOffset = bitOffset;
+			if (packedPixelsBitOffset > 0)
+				packedPixels++;
 
-			return value;
+			return packedPixels;
 		}
 
-		//encode a SLEB128 value
-		static inline void encodeSLEB128Ex(int32_t Value, unsigned char *p, unsigned int bitOffset, unsigned char** nextAddr, unsigned int *nextBitOffset) {
-			assert(bitOffset < 8 && (bitOffset % 4) == 0);
+		//unpack the pixels of tile rows [tileRowBegin, tileRowEnd) packed by packPixels()
+		static bool unpackPixels(
+			const unsigned char* packedPixels, const unsigned char* pEnd, uint32_t numColors,
+			const Video::Screen::Pixel* referencePixels, Video::Screen::Pixel* keyframePixels,
+			uint32_t frameFormat, size_t stepsY, uint tileRowBegin, uint tileRowEnd,
+			Video::Screen::Pixel* pixels, const unsigned char** packedPixelsEnd)
+		{
+			unsigned int packedPixelsBitOffset = 0;
+			const size_t startY = tileRowBegin * FramePacker::TILE_SIZE;
+			const size_t endY = tileRowEnd * FramePacker::TILE_SIZE;
 
-			bool more;
-			do {
-				unsigned char HalfByte = Value & 0x7;
-				Value >>= 3;
+			if (referencePixels == NULL)
+			{
+				//decode pixels' color directly
+				for (size_t y = startY; y < endY; y += stepsY) {
+					size_t i = y * Video::Screen::WIDTH;
+					Video::Screen::Pixel* keyframeRow = keyframePixels ? keyframePixels + i : NULL;
+
+					if (!FramePacker::UnpackColorRow(packedPixels, packedPixelsBitOffset, pEnd, numColors, pixels + i, keyframeRow, Video::Screen::WIDTH))
+						return false;//corruption
+				}//for (size_t y = startY; y < endY; y += stepsY)
+			}
+			else if (frameFormat >= Remote::REMOTE_FRAME_FORMAT_DIRTY_TILES)
+			{
+				//only the tiles changed since keyframe are stored
+				if (!FramePacker::UnpackDeltaTiles(packedPixels, packedPixelsBitOffset, pEnd, numColors, pixels, referencePixels, tileRowBegin, tileRowEnd))
+					return false;//corruption
+			}
+			else {
+				//decode pixels' color base on difference from key frame's pixels
+				for (size_t y = startY; y < endY; y += stepsY) {
+					size_t i = y * Video::Screen::WIDTH;
 
-				more = !((((Value == 0) && ((HalfByte & 0x4) == 0)) ||
-					((Value == -1) && ((HalfByte & 0x4) != 0))));
-				if (more)
-					HalfByte |= 0x8; // Mark this half byte to show that more half bytes will follow.
+					if (!FramePacker::UnpackDeltaRow(packedPixels, packedPixelsBitOffset, pEnd, numColors, pixels + i, referencePixels + i, Video::Screen::WIDTH))
+						return false;//corruption
+				}//for (size_t y = startY; y < endY; y += stepsY)
+			}
 
-				*p &= ~(0xf << bitOffset);
-				*p |= HalfByte << bitOffset;
-				bitOffset += 4;
+			if (packedPixelsBitOffset > 0)
+				packedPixels++;
 
-				if (bitOffset == 8)
-				{
-					p++;
-					bitOffset = 0;
-				}
-			} while (more);
+			if (packedPixelsEnd)
+				*packedPixelsEnd = packedPixels;
 
-			*nextAddr = p;
-			*nextBitOffset = bitOffset;
+			return true;
 		}
 
-		//decode a SLEB128 value.
-		static inline int32_t decodeSLEB128Ex(const unsigned char* address, unsigned int bitOffset, const unsigned char **nextAddr, unsigned int* nextBitOffset) {
-			assert(bitOffset < 8 && (bitOffset % 4) == 0);
+		//sliced frame = magic | num slices | compressed sizes of header & slices | compressed header | compressed slices
+		static HQRemote::DataRef assembleSlices(HQRemote::DataRef header, const HQRemote::DataRef* slices, uint32_t numSlices)
+		{
+			if (!header)
+				return nullptr;
 
-			const unsigned char* p = address;
-			int32_t value = 0;
-			unsigned int shift = 0;
-			unsigned char halfByte;
-			int steps = 0;//in case the data is corrupted
-			do {
-				halfByte = ((*p) >> bitOffset) & 0xf;
-				value |= (halfByte & 0x7) << shift;
-				shift += 3;
+			size_t totalSize = sizeof(uint32_t) * (numSlices + 3) + header->size();
+			for (uint32_t i = 0; i < numSlices; ++i) {
+				if (!slices[i])
+					return nullptr;
+				totalSize += slices[i]->size();
+			}
+
+			auto container = std::make_shared<HQRemote::CData>(totalSize);
+			unsigned char* p = container->data();
+			uint32_t value = REMOTE_SLICED_FRAME_MAGIC;
+			memcpy(p, &value, sizeof(value));
+			p += sizeof(value);
+			memcpy(p, &numSlices, sizeof(numSlices));
+			p += sizeof(numSlices);
+
+			for (uint32_t i = 0; i <= numSlices; ++i) {
+				value = (uint32_t)(i == 0 ? header : slices[i - 1])->size();
+				memcpy(p, &value, sizeof(value));
+				p += sizeof(value);
+			}
+
+			memcpy(p, header->data(), header->size());
+			p += header->size();
+			for (uint32_t i = 0; i < numSlices; ++i) {
+				memcpy(p, slices[i]->data(), slices[i]->size());
+				p += slices[i]->size();
+			}
+
+			return container;
+		}
+
+		//split a sliced frame into compressed header & slices, returns number of slices or zero if it is not a sliced frame
+		static uint32_t parseSlices(const void* compressed, size_t compressedSize, const unsigned char** blobs, uint32_t* blobSizes)
+		{
+			auto p = (const unsigned char*)compressed;
+			uint32_t magic, numSlices;
+			if (compressedSize < sizeof(magic) + sizeof(numSlices))
+				return 0;
+
+			memcpy(&magic, p, sizeof(magic));
+			memcpy(&numSlices, p + sizeof(magic), sizeof(numSlices));
+			if (magic != REMOTE_SLICED_FRAME_MAGIC || numSlices < 2 || numSlices > REMOTE_MAX_FRAME_SLICES)
+				return 0;
+
+			size_t offset = sizeof(magic) + sizeof(numSlices) + sizeof(uint32_t) * (numSlices + 1);
+			if (compressedSize < offset)
+				return 0;
+
+			for (uint32_t i = 0; i <= numSlices; ++i) {
+				memcpy(&blobSizes[i], p + sizeof(magic) + sizeof(numSlices) + sizeof(uint32_t) * i, sizeof(blobSizes[i]));
+				if (blobSizes[i] > compressedSize - offset)
+					return 0;
+
+				blobs[i] = p + offset;
+				offset += blobSizes[i];
+			}
+
+			//the blobs must cover the whole frame exactly
+			if (offset != compressedSize)
+				return 0;
+
+			return numSlices;
+		}
+
+		/*------------- ZlibFrameCompressorBase ---------------*/
+		ZlibFrameCompressorBase::ZlibFrameCompressorBase()
+			: m_lastKeyframeId(0)
+		{
+			Reset();
+		}
 
-				bitOffset += 4;
-				if (bitOffset == 8)
-				{
-					p++;
-					bitOffset = 0;
-				}
-			} while (halfByte >= 0x8 && (++steps) < 4);
-
-			//sign extend negative numbers.
-			if (halfByte & 0x4)
-				value |= int32_t(-1) << shift;
-
-			*nextAddr = p;
-			*nextBitOffset = bitOffset;
-
-			return value;
-		}
-
-		/*------------- ZlibFrameCompressorBase ---------------*/
-		ZlibFrameCompressorBase::ZlibFrameCompressorBase()
-			: m_lastKeyframeId(0)
-		{
-			Reset();
-		}
-
 		void ZlibFrameCompressorBase::Reset() {
-			m_lastKeyframeId = 0;
-		}
-
-		/* ------------- FrameCompressorZlib ------------------*/
+			m_lastKeyframeId = 0;
+
+			for (auto& keyframe : m_keyframes) {
+				keyframe.id = 0;
+				keyframe.pins = 0;
+			}
+		}
+
+		ZlibFrameCompressorBase::Keyframe* ZlibFrameCompressorBase::FindKeyframe(uint64_t id) {
+			if (id == 0)
+				return NULL;
+
+			for (auto& keyframe : m_keyframes) {
+				if (keyframe.id == id)
+					return &keyframe;
+			}
+
+			return NULL;
+		}
+
+		ZlibFrameCompressorBase::Keyframe& ZlibFrameCompressorBase::AllocKeyframe(uint64_t id, uint64_t keepId) {
+			Keyframe* oldest = NULL;
+			for (auto& keyframe : m_keyframes) {
+				if (keyframe.pins || (keyframe.id == keepId && keepId != 0))
+					continue;
+				if (oldest == NULL || keyframe.id < oldest->id)
+					oldest = &keyframe;
+			}
+
+			assert(oldest != NULL);
+
+			oldest->id = id;
+			oldest->refreshedBands = REMOTE_INTRA_REFRESH_ALL_BANDS;
+
+			return *oldest;
+		}
+
+		bool ZlibFrameCompressorBase::CanAllocKeyframe() const {
+			// one of the unpinned keyframes might be the one to keep
+			uint unpinned = 0;
+			for (auto& keyframe : m_keyframes) {
+				if (keyframe.pins == 0)
+					unpinned++;
+			}
+
+			return unpinned >= 2;
+		}
+
+		/* ------------- FrameCompressorZlib ------------------*/
 		ZlibFrameCompressor::ZlibFrameCompressor(const HQRemote::Engine& server)
-			: FrameCompressorBase(FRAME_COMPRESSOR_TYPE_ZLIB, true),
-			HQRemote::ZlibImgComressor(ENABLE_REMOTE_FRAME_COMPRESS ? 0 : -1),
+			: ZlibFrameCompressor(FRAME_COMPRESSOR_TYPE_ZLIB, server)
+		{
+		}
+
+		ZlibFrameCompressor::ZlibFrameCompressor(FrameCompressorType type, const HQRemote::Engine& server)
+			: FrameCompressorBase(type, true),
+			HQRemote::ZlibImgComressor(REMOTE_ZLIB_LEVEL),
 			m_server(server),
+			m_running(false),
 			m_avgKeyframeSize(0)
 			, m_compressSizeBudget(0), m_dataRateBudget(0)
+			, m_frameFormat(Remote::REMOTE_FRAME_FORMAT_LEGACY), m_ackedKeyframeId(0), m_buildingKeyframeId(0), m_refreshingBands(0)
+			, m_pendingRefreshPixels(MAX_PENDING_REFRESH_BANDS * REMOTE_INTRA_REFRESH_BAND_PIXELS)
+			, m_interPackedSize(0), m_slicesPool(REMOTE_FRAME_SLICES - 1)
 #if PROFILE_REMOTE_FRAME_COMPRESSION
 			, m_avgCompressionTime(0), m_totalCompressionWindowTime(0)
 #endif
@@ -227,6 +360,9 @@ namespace Nes {
 		ZlibFrameCompressor::~ZlibFrameCompressor()
 		{
 			Stop();
+
+			for (auto compressor : m_freeCompressors)
+				delete compressor;
 		}
 
 		HQRemote::DataRef ZlibFrameCompressor::compress(HQRemote::ConstDataRef src, uint64_t id, uint32_t width, uint32_t height, unsigned int numChannels)
@@ -236,6 +372,7 @@ namespace Nes {
 			assert(numChannels == 1);
 
 			uint32_t willDownSample = this->downSample.load(std::memory_order_relaxed);
+			uint32_t frameFormat = m_frameFormat.load(std::memory_order_relaxed);
 
 #if PROFILE_REMOTE_FRAME_COMPRESSION
 			HQRemote::ScopedTimeProfiler scopedProfiler("framecomp", m_avgCompressionTimeLock, m_avgCompressionTime, m_totalCompressionWindowTime);
@@ -249,13 +386,17 @@ namespace Nes {
 			uint16_t remapColorTbl[Video::Screen::PALETTE];
 			//make sure uint16_t can hold any color index
 			static_assert(sizeof(remapColorTbl[0]) == sizeof(Video::Screen::Pixel), "Incompatible type");
+			const uint16_t* pRemapColorTbl = remapColorTbl;
 			uint32_t numUsedColors = 0;
 #else
+			const uint16_t* pRemapColorTbl = NULL;
 			uint numUsedColors = Video::Screen::PALETTE;
 #endif//if ENABLE_REMAP_REMOTE_COLOR
 
-			//packed data structure = keyframe id | burst phase | downsample flag | num colors | pixels | palette table
-			const auto bufferSize = sizeof(Video::Screen) + sizeof(uint32_t) * 3 + sizeof(uint64_t);
+			//packed data structure = keyframe id | burst phase | downsample flag & format | num colors | [refreshed keyframe id] | pixels | palette table
+			//sliced frame's pixels are packed separately after the palette table
+			const auto bufferSize = sizeof(Video::Screen) + sizeof(uint32_t) * 3 + sizeof(uint64_t) * 2 + FramePacker::DIRTY_TILES_BITMAP_SIZE
+				+ REMOTE_FRAME_SLICES * (FramePacker::DIRTY_TILES_BITMAP_SIZE + 1);
 #if USE_PTHREAD_KEY_FOR_REMOTE_FRAME_COMPRESS
 			auto buffer = getOrCreateThreadSpecificBuffer(bufferSize);
 			if (!buffer)
@@ -270,13 +411,8 @@ namespace Nes {
 			uint32_t* const pNumUsedColors = pDownSample + 1;
 
 			memcpy(pBurstPhase, src->data(), sizeof(uint32_t));
-			size_t stepsX, stepsY;
+			size_t stepsY;
 
-
-			size_t startX, startY, endY;
-			startX = startY = 0;
-			stepsX = 1;
-			endY = Video::Screen::HEIGHT;
 			if (willDownSample)
 			{
 				stepsY = 2;
@@ -286,11 +422,7 @@ namespace Nes {
 			}
 
 			try {
-
-#if ENABLE_REMOTE_KEYFRAME
-				bool isKeyFrame = false;
 				std::unique_lock<std::mutex> lk(m_lock, std::defer_lock);
-#endif//ENABLE_REMOTE_KEYFRAME
 
 #if ENABLE_REMAP_REMOTE_COLOR
 
@@ -306,123 +438,124 @@ namespace Nes {
 
 			beginCompress:
 				unsigned char* packedPixels = (unsigned char*)(pNumUsedColors + 1);
-				unsigned int packedPixelsBitOffset = 0;
 
-				memcpy(pDownSample, &willDownSample, sizeof willDownSample);
-				memcpy(pNumUsedColors, &numUsedColors, sizeof numUsedColors);
+				uint64_t referenceId = 0;//keyframe that this frame's pixels are relative to, 0 if none
+				uint32_t refreshBand = 0;//1 + index of intra refresh band carried by this frame, 0 if none
+				uint64_t refreshKeyframeId = 0;
+				Keyframe* keyframe = NULL;//keyframe constructed by this frame
+				Keyframe* reference = NULL;//pinned keyframe that this frame's pixels are relative to
 
 #if ENABLE_REMOTE_KEYFRAME
-				if (willDownSample || ((id - 1) % REMOTE_KEYFRAME_INTERVAL) == 0 || m_lastKeyframeId == 0)
+				if (!willDownSample)//downsampled frame is never a keyframe nor uses one
 				{
-					//this is keyframe
-					if (!willDownSample)
-					{
-						isKeyFrame = true;
+					lk.lock();
+
+					//keyframes pinned by other threads can't be reused until they are done with them,
+					//references can't be selected while another thread is constructing a keyframe
+					m_cv.wait(lk, [this] { return !m_running || (CanAllocKeyframe() && m_buildingKeyframeId == 0); });
+					if (!m_running)
+						return nullptr;
 
-						lk.lock();//lock other threads until we done constructing keyframe
+					if (frameFormat >= Remote::REMOTE_FRAME_FORMAT_KEYFRAME_ACK)
+					{
+						keyframe = SelectAcknowledgedReference(id, frameFormat, referenceId, refreshBand);
+						refreshKeyframeId = m_lastKeyframeId;
+						if (referenceId)
+							reference = FindKeyframe(referenceId);
+
+						//pin the keyframes so that the slices can be packed without the lock
+						if (reference)
+							reference->pins++;
+						if (keyframe)
+						{
+							keyframe->pins++;
+							m_buildingKeyframeId = id;
+						}
+						lk.unlock();
 					}
-#else//ENABLE_REMOTE_KEYFRAME
+					else if (((id - 1) % REMOTE_KEYFRAME_INTERVAL) == 0 || m_lastKeyframeId == 0)
 					{
-#endif//ENABLE_REMOTE_KEYFRAME
+						//this is keyframe, lock other threads until we done constructing it
+						keyframe = &AllocKeyframe(id, m_lastKeyframeId);
+					}
+					else {
+						//wait for keyframe to be available
+						auto timeout = !m_cv.wait_for(lk, std::chrono::milliseconds(5000), [this, id] { return !m_running || id - m_lastKeyframeId < REMOTE_KEYFRAME_INTERVAL; });
+						if (timeout || !m_running)
+						{
+							if (timeout)
+								HQRemote::Log("compressor dropped a frame due to timeout");
+							return nullptr;
+						}
 
-						memset(pKeyFrameId, 0, sizeof(m_lastKeyframeId));
+						//pin the keyframe so that a keyframe constructed meanwhile by another thread doesn't reuse it
+						referenceId = m_lastKeyframeId;
+						reference = FindKeyframe(referenceId);
+						reference->pins++;
+						lk.unlock();
+					}
+				}//if (!willDownSample)
+#endif//ENABLE_REMOTE_KEYFRAME
 
-						//update the pixels' color index
-						for (size_t y = startY; y < endY; y += stepsY) {
-							for (size_t x = startX; x < Video::Screen::WIDTH; x += stepsX) {
-								size_t i = y * Video::Screen::WIDTH + x;
-								uint32_t oldColorIdx = screen->pixels[i];
-#if ENABLE_REMAP_REMOTE_COLOR
-								auto newColorIdx = remapColorTbl[oldColorIdx];
-#else
-								auto newColorIdx = oldColorIdx;
-#endif//if ENABLE_REMAP_REMOTE_COLOR
+				uint32_t frameFlags = willDownSample | (frameFormat << REMOTE_FRAME_FORMAT_SHIFT) | (refreshBand << REMOTE_REFRESH_BAND_SHIFT);
+				memcpy(pKeyFrameId, &referenceId, sizeof(referenceId));
+				memcpy(pDownSample, &frameFlags, sizeof frameFlags);
+				memcpy(pNumUsedColors, &numUsedColors, sizeof numUsedColors);
 
-								const unsigned char* oldPtr = packedPixels;
-								auto oldOffset = packedPixelsBitOffset;
-								encodeULEB128Ex(newColorIdx, packedPixels, packedPixelsBitOffset, &packedPixels, &packedPixelsBitOffset);
-
-#if defined DEBUG || defined _DEBUG
-								if (newColorIdx > 7)
-								{
-									bool valid = (decodeULEB128Ex(oldPtr, oldOffset, &oldPtr, &oldOffset) == newColorIdx);
-									if (!valid)
-									{
-										int a = 0;//debugging
-									}
-									assert(valid);
-								}
-#endif
+				if (refreshBand)
+				{
+					memcpy(packedPixels, &refreshKeyframeId, sizeof(refreshKeyframeId));
+					packedPixels += sizeof(refreshKeyframeId);
+				}
 
-#if ENABLE_REMOTE_KEYFRAME
-								//cache keyframe's pixel
-								if (!willDownSample)
-									m_lastKeyframe.pixels[i] = newColorIdx;
-#endif//if ENABLE_REMOTE_KEYFRAME
+				const Video::Screen::Pixel* referencePixels = reference ? reference->screen.pixels : NULL;
+				Video::Screen::Pixel* keyframePixels = keyframe ? keyframe->screen.pixels : NULL;
 
-							}//for (size_t x = startX; x < Video::Screen::WIDTH; x += stepsX)
-						}//for (size_t y = startY; y < endY; y += stepsY)
-					}//if (((id - 1) % REMOTE_KEYFRAME_INTERVAL) == 0 || m_lastKeyframeId == 0)
+				//intra frames are always large, inter frames are sliced only if the previous ones were large
+				const uint numSlices = frameFormat >= Remote::REMOTE_FRAME_FORMAT_SLICES &&
+					(referencePixels == NULL || m_interPackedSize.load(std::memory_order_relaxed) >= REMOTE_MIN_SLICED_PACKED_SIZE) ? REMOTE_FRAME_SLICES : 1;
+				HQRemote::DataRef slices[REMOTE_FRAME_SLICES];
+				size_t slicesPackedSizes[REMOTE_FRAME_SLICES];
+				if (numSlices == 1)
+				{
+					unsigned char* packedPixelsBegin = packedPixels;
+					packedPixels = packPixels(screen, pRemapColorTbl, referencePixels, keyframePixels, frameFormat, stepsY, 0, FramePacker::TILES_Y, packedPixels);
 
-#if ENABLE_REMOTE_KEYFRAME
+					if (referencePixels)
+						m_interPackedSize = packedPixels - packedPixelsBegin;
+				}
 				else {
-					lk.lock();//wait for keyframe to be available
-					auto timeout = !m_cv.wait_for(lk, std::chrono::milliseconds(5000), [this, id] { return !m_running || id - m_lastKeyframeId < REMOTE_KEYFRAME_INTERVAL; });
-					lk.unlock();
+					//pack & compress the slices in parallel, each one is stored in its own part of the buffer after the palette table
+					unsigned char* slicesBuffer = (unsigned char*)(pNumUsedColors + 1) + sizeof(uint64_t) + sizeof(Video::Screen::Palette);
 
-					if (timeout || !m_running)
-					{
-						if (timeout)
-							HQRemote::Log("compressor dropped a frame due to timeout");
-						return nullptr;
-					}
-					memcpy(pKeyFrameId, &m_lastKeyframeId, sizeof(m_lastKeyframeId));
-
-					//store the pixels' delta color index
-					for (size_t y = startY; y < endY; y += stepsY) {
-						for (size_t x = startX; x < Video::Screen::WIDTH; x += stepsX) {
-							size_t i = y * Video::Screen::WIDTH + x;
-							uint32_t oldColorIdx = screen->pixels[i];
-							uint32_t keyColorIdx = m_lastKeyframe.pixels[i];
-#if ENABLE_REMAP_REMOTE_COLOR
-							auto newColorIdx = remapColorTbl[oldColorIdx];
-#else
-							auto newColorIdx = oldColorIdx;
-#endif//if ENABLE_REMAP_REMOTE_COLOR
-							int32_t deltaColor = newColorIdx - keyColorIdx;
-
-							const unsigned char* oldPtr = packedPixels;
-							auto oldOffset = packedPixelsBitOffset;
-							encodeSLEB128Ex(deltaColor, packedPixels, packedPixelsBitOffset, &packedPixels, &packedPixelsBitOffset);
-
-#if defined DEBUG || defined _DEBUG
-							if (deltaColor > 7 || deltaColor < 0)
-							{
-								bool valid = (decodeSLEB128Ex(oldPtr, oldOffset, &oldPtr, &oldOffset) == deltaColor);
-								if (!valid)
-								{
-									int a = 0;//debugging
-								}
-								assert(valid);
-							}
-#endif
-						}//for (size_t x = startX; x < Video::Screen::WIDTH; x += stepsX)
-					}//for (size_t y = startY; y < endY; y += stepsY)
-				}//else of if (((id - 1) % REMOTE_KEYFRAME_INTERVAL) == 0 || m_lastKeyframeId == 0)
+					m_slicesPool.Run(numSlices, [&](uint slice) {
+						const uint tileRowBegin = sliceTileRowBegin(slice, numSlices);
+						const uint tileRowEnd = sliceTileRowBegin(slice + 1, numSlices);
 
-				 //done constructing keyframe, wake other compression threads
-				if (isKeyFrame)
-				{
-					m_lastKeyframeId = id;
+						//each pixel takes 2 bytes at most
+						unsigned char* slicePixels = slicesBuffer + tileRowBegin * FramePacker::TILE_SIZE * Video::Screen::WIDTH * sizeof(Video::Screen::Pixel)
+							+ slice * (FramePacker::DIRTY_TILES_BITMAP_SIZE + 1);
+						unsigned char* slicePixelsEnd = packPixels(screen, pRemapColorTbl, referencePixels, keyframePixels, frameFormat, stepsY, tileRowBegin, tileRowEnd, slicePixels);
+						slicesPackedSizes[slice] = slicePixelsEnd - slicePixels;
 
-					m_cv.notify_all();
-					lk.unlock();
-				}//if (isKeyFrame)
-#endif //if ENABLE_REMOTE_KEYFRAME
+						try {
+							slices[slice] = CompressPacked(slicePixels, slicePixelsEnd - slicePixels);
+						}
+						catch (...) {
+							slices[slice] = nullptr;
+						}
+					});
+
+					if (referencePixels)
+					{
+						size_t packedSize = 0;
+						for (uint i = 0; i < numSlices; ++i)
+							packedSize += slicesPackedSizes[i];
+						m_interPackedSize = packedSize;
+					}
+				}//if (numSlices == 1)
 
 				 //write new color palette table
-				if (packedPixelsBitOffset > 0)
-					packedPixels++;
 				uint32_t *newColorTbl = (uint32_t*)(packedPixels);
 
 #if ENABLE_REMAP_REMOTE_COLOR
@@ -438,32 +571,60 @@ namespace Nes {
 					//don't use assignment because of potential misaligned integer's address
 					memcpy(newColorEntry, &color, sizeof(color));
 
-#if ENABLE_REMOTE_KEYFRAME
 					//cache keyframe's palette entry
-					if (isKeyFrame)
-						m_lastKeyframe.palette[newIndex] = color;
-#endif//ENABLE_REMOTE_KEYFRAME
+					if (keyframe)
+						keyframe->screen.palette[newIndex] = color;
 				}
 #else// if ENABLE_REMAP_REMOTE_COLOR
 				//clone the palette table
 				memcpy(newColorTbl, screen->palette, sizeof(screen->palette));
 				//cache keyframe's palette entry
-				if (m_lastKeyframeId == id)
-					memcpy(m_lastKeyframe.palette, screen->palette, sizeof(screen->palette));
+				if (keyframe)
+					memcpy(keyframe->screen.palette, screen->palette, sizeof(screen->palette));
 #endif//if ENABLE_REMAP_REMOTE_COLOR
 
+				//done constructing keyframe or reading the reference, wake other compression threads
+				if (keyframe || reference)
+				{
+					if (!lk.owns_lock())
+						lk.lock();
+
+					if (reference)
+						reference->pins--;
+
+					if (keyframe)
+					{
+						if (m_buildingKeyframeId == id)
+						{
+							keyframe->pins--;
+							m_buildingKeyframeId = 0;
+						}
+
+						m_lastKeyframeId = id;
+					}
+
+					m_cv.notify_all();
+				}
+
+				if (lk.owns_lock())
+					lk.unlock();
+
 				size_t packedSize = (unsigned char*)(newColorTbl + *pNumUsedColors) - buffer;
 
 				//compress frame
-				auto dataToSend = ZlibImgComressor::compress(buffer, packedSize, width, height, numChannels);
+				auto dataToSend = CompressPacked(buffer, packedSize);
+				if (numSlices > 1)
+				{
+					dataToSend = assembleSlices(dataToSend, slices, numSlices);
+					if (!dataToSend)
+						return nullptr;
+				}
 
 				//mutex scope
 				{
 					std::lock_guard<std::mutex> lg(m_lock);
 
-#if ENABLE_REMOTE_KEYFRAME
-					if (!isKeyFrame)//cannot downsample keyframe
-#endif//if ENABLE_REMOTE_KEYFRAME
+					if (!keyframe)//cannot downsample keyframe
 					{
 						//frame too large?
 						auto compressSizeBudget = m_compressSizeBudget.load(std::memory_order_relaxed);
@@ -475,39 +636,100 @@ namespace Nes {
 #endif//if ENABLE_REMOTE_FRAME_SIZE_LIMIT
 							)
 						{
+							//the refresh band will be sent by another frame
+							if (refreshBand && refreshKeyframeId == m_lastKeyframeId)
+								m_refreshingBands &= ~(1 << (refreshBand - 1));
+
 							willDownSample = 1 | ADAPTIVE_DOWNSAMPLE_FLAG;//downsample
 							stepsY = 2;
 							//restart
 							goto beginCompress;
 						}
 					}
+
+					if (refreshBand && dataToSend)
+					{
+						//newer client tells us whether the band arrived, older ones are assumed to receive it
+						if (frameFormat >= Remote::REMOTE_FRAME_FORMAT_REFRESH_BAND_ACK)
+							PendRefreshBand(screen, pRemapColorTbl, id, refreshKeyframeId, refreshBand);
+						else
+							CommitRefreshBand(screen, pRemapColorTbl, refreshKeyframeId, refreshBand);
+					}
 				}//mutex scope
 
-#if ENABLE_REMOTE_KEYFRAME
-				if (isKeyFrame && dataToSend) {
+				if (keyframe && dataToSend) {
 					if (m_avgKeyframeSize == 0)
 						m_avgKeyframeSize = dataToSend->size();
 					else
 						m_avgKeyframeSize = 0.8 * m_avgKeyframeSize + 0.2 * dataToSend->size();
 				}
-#endif//ENABLE_REMOTE_KEYFRAME
 
 				return dataToSend;
 				}
 			catch (...) {
 				return nullptr;
 			}
-		}
-
-		void ZlibFrameCompressor::Restart() {
+		}
+
+		HQRemote::ZlibImgComressor* ZlibFrameCompressor::AcquireCompressor() {
+			{
+				std::lock_guard<std::mutex> lg(m_compressorsLock);
+				if (m_freeCompressors.size())
+				{
+					auto compressor = m_freeCompressors.back();
+					m_freeCompressors.pop_back();
+					return compressor;
+				}
+			}
+
+			return new HQRemote::ZlibImgComressor(REMOTE_ZLIB_LEVEL);
+		}
+
+		void ZlibFrameCompressor::ReleaseCompressor(HQRemote::ZlibImgComressor* compressor) {
+			std::lock_guard<std::mutex> lg(m_compressorsLock);
+			m_freeCompressors.push_back(compressor);
+		}
+
+		HQRemote::DataRef ZlibFrameCompressor::CompressPacked(const void* packed, size_t size) {
+			auto compressor = AcquireCompressor();
+
+			HQRemote::DataRef compressed;
+			try {
+				compressed = compressor->compress(packed, size, Video::Screen::WIDTH, Video::Screen::HEIGHT, 1);
+			}
+			catch (...) {
+				ReleaseCompressor(compressor);
+				throw;
+			}
+
+			ReleaseCompressor(compressor);
+
+			return compressed;
+		}
+
+		void ZlibFrameCompressor::Restart() {
+			// new client might be an older one, use legacy format until it tells us otherwise
+			m_frameFormat = Remote::REMOTE_FRAME_FORMAT_LEGACY;
+
+			{
+				std::lock_guard<std::mutex> lg(m_lock);
+				// new client doesn't have any of our keyframes
+				m_ackedKeyframeId = 0;
+				for (auto& pending : m_pendingRefreshBands)
+					pending.frameId = 0;
+			}
+
 			// enable 50KB budget for 20 fps by default to be compatible with older client
-			EnableDataRateBudget(MIN_REMOTE_SEND_RATE_BUDGET, SLOW_NET_REMOTE_FRAME_INTERVAL);
-		}
-
+			EnableDataRateBudget(MIN_REMOTE_SEND_RATE_BUDGET, SLOW_NET_REMOTE_FRAME_INTERVAL);
+		}
+
 		void ZlibFrameCompressor::Start() {
 			m_running = true;
 
 			m_avgKeyframeSize = 0;
+			m_refreshingBands = 0;
+			m_interPackedSize = 0;
+			m_buildingKeyframeId = 0;
 			Reset();
 			Restart();
 		}
@@ -518,34 +740,65 @@ namespace Nes {
 
 			//wake all waiting threads
 			m_cv.notify_all();
-		}
-
-		bool ZlibFrameCompressor::OnRemoteEvent(const HQRemote::Event& event) {
-			switch (event.type) {
+		}
+
+		bool ZlibFrameCompressor::OnRemoteEvent(const HQRemote::Event& event) {
+			switch (event.type) {
 			case HQRemote::FRAME_INTERVAL: {
 				// we have new frame interval settings, update the data rate budget
 				UpdateFrameInterval(event.frameInterval);
-			}
+			}
 				return true;
 			case Remote::REMOTE_ENABLE_ADAPTIVE_DATA_RATE:
 
 				// reset budget
 				EnableDataRateBudget(0, DEFAULT_REMOTE_FRAME_INTERVAL);
 
-				return true;
-			}
-
-			return false;
-		}
-
-		void ZlibFrameCompressor::AdaptToClientSlowRecvRate(float clientRcvRate, float ourSendingRate) {
-			EnableDataRateBudget((size_t)clientRcvRate, m_server.getFrameInterval());
+				return true;
+			case Remote::REMOTE_FRAME_FORMAT: {
+				// client can decode newer format, use the latest one we both support
+				Remote::RemoteFrameFormatVersion format;
+				memcpy(&format, event.customData, sizeof format);
+
+				if (format.version > Remote::REMOTE_FRAME_FORMAT_LATEST)
+					format.version = Remote::REMOTE_FRAME_FORMAT_LATEST;
+				m_frameFormat = format.version;
+
+				HQRemote::Log("frame compressor's format changed to %u", format.version);
+			}
+				return true;
+			case Remote::REMOTE_KEYFRAME_ACK: {
+				Remote::RemoteKeyframeAck ack;
+				memcpy(&ack, event.customData, sizeof ack);
+
+				std::lock_guard<std::mutex> lg(m_lock);
+				// ignore outdated acknowledgement or the one of keyframe we no longer have
+				auto keyframe = FindKeyframe(ack.id);
+				if (keyframe && keyframe->refreshedBands == REMOTE_INTRA_REFRESH_ALL_BANDS && ack.id > m_ackedKeyframeId)
+					m_ackedKeyframeId = ack.id;
+			}
+				return true;
+			case Remote::REMOTE_REFRESH_BAND_ACK: {
+				Remote::RemoteRefreshBandAck ack;
+				memcpy(&ack, event.customData, sizeof ack);
+
+				std::lock_guard<std::mutex> lg(m_lock);
+				CommitAcknowledgedRefreshBand(ack.id);
+			}
+				return true;
+			}
+
+			return false;
+		}
+
+		void ZlibFrameCompressor::AdaptToClientSlowRecvRate(float clientRcvRate, float ourSendingRate) {
+			EnableDataRateBudget((size_t)clientRcvRate, m_server.getFrameInterval());
+		}
+
+		void ZlibFrameCompressor::AdaptToClientFastRecvRate(float clientRcvRate, float ourSendingRate) {
+			EnableDataRateBudget(0, m_server.getFrameInterval());
 		}
 
-		void ZlibFrameCompressor::AdaptToClientFastRecvRate(float clientRcvRate, float ourSendingRate) {
-			EnableDataRateBudget(0, m_server.getFrameInterval());
-		}
-
 		// bytes per second
 		void ZlibFrameCompressor::EnableDataRateBudget(size_t rate, double frame_interval) {
 			m_dataRateBudget = rate;
@@ -566,92 +819,260 @@ namespace Nes {
 			}
 
 			HQRemote::Log("frame compressor's size budget changed to %u", (uint)m_compressSizeBudget.load(std::memory_order_relaxed));
-		}
-
-		/*--------------- ZlibFrameDecompressor --------------------*/
-		ZlibFrameDecompressor::ZlibFrameDecompressor(Machine& machine, HQRemote::Client& client)
-			: FrameDecompressorBase(FRAME_COMPRESSOR_TYPE_ZLIB),
-			m_machine(machine), m_client(client),
-			m_lastDecompressId(INVALID_FRAME_ID)
-		{}
-
-		void ZlibFrameDecompressor::Start() {
-			m_lastDecompressId = INVALID_FRAME_ID; // invalid id
-			Reset();
-		}
-
-		void ZlibFrameDecompressor::Stop() {
-		}
-
-		bool ZlibFrameDecompressor::OnRemoteEvent(const HQRemote::Event& event) {
-			switch (event.type) {
-			default:
-				break;
-			}
-
-			return false;
-		}
-
-		void ZlibFrameDecompressor::FrameStep(Video::Output* videoOutput) {
-			// try to receive frame frome remote side
-			uint remoteBurstPhase;
-			bool hasFrame = HandleRemoteFrame(remoteBurstPhase);
-
-			// now render the frame
-			auto& ppu = m_machine.ppu;
-			auto& renderer = m_machine.renderer;
-
-			if (videoOutput && (hasFrame || m_lastDecompressId == INVALID_FRAME_ID))
-				renderer.Blit(*videoOutput, ppu.GetScreen(), remoteBurstPhase);
-		}
-
-		bool ZlibFrameDecompressor::HandleRemoteFrame(uint& remoteBurstPhase) {
-			auto eventRef = m_client.getFrameEvent();
-			if (!eventRef)
-				return false;
-
-			auto& event = eventRef->event;
-			auto frameId = event.renderedFrameData.frameId;
-			if (m_lastDecompressId != INVALID_FRAME_ID && m_lastDecompressId >= frameId)
-				return false;
-
-			uint remoteUsePermaLowres;
-
-			if (!Decompress(event.renderedFrameData.frameData, event.renderedFrameData.frameSize, frameId, remoteBurstPhase, remoteUsePermaLowres))
-				return false;
-
+		}
+
+		uint64_t ZlibFrameCompressor::KeyframeInterval() const {
+			auto compressSizeBudget = m_compressSizeBudget.load(std::memory_order_relaxed);
+			if (compressSizeBudget == 0 || m_avgKeyframeSize == 0)
+				return REMOTE_MIN_KEYFRAME_INTERVAL;
+
+			// spread keyframe's size over enough frames so that it only takes a portion of the budget
+			auto interval = (uint64_t)(m_avgKeyframeSize / (compressSizeBudget * REMOTE_KEYFRAME_BUDGET_RATIO)) + 1;
+			if (interval < REMOTE_MIN_KEYFRAME_INTERVAL)
+				interval = REMOTE_MIN_KEYFRAME_INTERVAL;
+			else if (interval > REMOTE_MAX_KEYFRAME_INTERVAL)
+				interval = REMOTE_MAX_KEYFRAME_INTERVAL;
+
+			return interval;
+		}
+
+		ZlibFrameCompressorBase::Keyframe* ZlibFrameCompressor::SelectAcknowledgedReference(uint64_t id, uint32_t frameFormat, uint64_t& referenceId, uint32_t& refreshBand) {
+			referenceId = 0;
+			refreshBand = 0;
+
+			if (m_ackedKeyframeId == 0)
+			{
+				// client hasn't acknowledged any keyframe yet, use the last keyframe like older clients do
+				if (m_lastKeyframeId == 0 || id >= m_lastKeyframeId + REMOTE_KEYFRAME_INTERVAL)
+					return &AllocKeyframe(id, m_lastKeyframeId);
+
+				referenceId = m_lastKeyframeId;
+				return NULL;
+			}
+
+			// losing a keyframe won't break the following frames since they always use the acknowledged one
+			referenceId = m_ackedKeyframeId;
+
+			auto interval = KeyframeInterval();
+#if ENABLE_REMOTE_INTRA_REFRESH
+			if (frameFormat >= Remote::REMOTE_FRAME_FORMAT_INTRA_REFRESH)
+			{
+				// refreshing a keyframe takes several frames, don't start over too early
+				if (interval < 2 * REMOTE_INTRA_REFRESH_BANDS)
+					interval = 2 * REMOTE_INTRA_REFRESH_BANDS;
+
+				// lost bands are sent again when client acknowledges them, let the keyframe being refreshed complete first
+				auto lastKeyframe = FindKeyframe(m_lastKeyframeId);
+				const bool refreshing = frameFormat >= Remote::REMOTE_FRAME_FORMAT_REFRESH_BAND_ACK &&
+					lastKeyframe && lastKeyframe->refreshedBands != REMOTE_INTRA_REFRESH_ALL_BANDS && id < m_lastKeyframeId + REMOTE_MAX_KEYFRAME_INTERVAL;
+
+				if (!refreshing && id >= m_lastKeyframeId + interval)
+				{
+					// start building a new keyframe from the next frames' bands
+					auto& keyframe = AllocKeyframe(id, m_ackedKeyframeId);
+					keyframe.refreshedBands = 0;
+
+					m_lastKeyframeId = id;
+					m_refreshingBands = 0;
+				}
+
+				auto keyframe = FindKeyframe(m_lastKeyframeId);
+				if (m_lastKeyframeId != m_ackedKeyframeId && keyframe)
+				{
+					uint32_t missingBands = REMOTE_INTRA_REFRESH_ALL_BANDS & ~(keyframe->refreshedBands | m_refreshingBands | PendingRefreshBands(id));
+					for (uint32_t band = 0; band < REMOTE_INTRA_REFRESH_BANDS; ++band) {
+						if (missingBands & (1 << band))
+						{
+							m_refreshingBands |= 1 << band;
+							refreshBand = band + 1;
+							break;
+						}
+					}
+				}
+
+				return NULL;
+			}//if (frameFormat >= Remote::REMOTE_FRAME_FORMAT_INTRA_REFRESH)
+#endif//if ENABLE_REMOTE_INTRA_REFRESH
+
+			if (id >= m_lastKeyframeId + interval)
+			{
+				referenceId = 0;
+				return &AllocKeyframe(id, m_ackedKeyframeId);
+			}
+
+			return NULL;
+		}
+
+		void ZlibFrameCompressor::CommitRefreshBand(const Video::Screen* screen, const uint16_t* remapTbl, uint64_t refreshKeyframeId, uint32_t refreshBand) {
+			auto keyframe = FindKeyframe(refreshKeyframeId);
+			if (!keyframe)
+				return;
+
+			// client will copy this band from the decoded frame, do the same
+			const uint32_t band = refreshBand - 1;
+			const size_t begin = band * REMOTE_INTRA_REFRESH_BAND_HEIGHT * Video::Screen::WIDTH;
+			const size_t end = begin + REMOTE_INTRA_REFRESH_BAND_HEIGHT * Video::Screen::WIDTH;
+			for (size_t i = begin; i < end; ++i)
+				keyframe->screen.pixels[i] = remapTbl ? remapTbl[screen->pixels[i]] : screen->pixels[i];
+
+			keyframe->refreshedBands |= 1 << band;
+			if (refreshKeyframeId == m_lastKeyframeId)
+				m_refreshingBands &= ~(1 << band);
+		}
+
+		void ZlibFrameCompressor::PendRefreshBand(const Video::Screen* screen, const uint16_t* remapTbl, uint64_t id, uint64_t refreshKeyframeId, uint32_t refreshBand) {
+			// take a free entry, otherwise the oldest one whose band was most likely lost
+			PendingRefreshBand* pending = &m_pendingRefreshBands[0];
+			for (auto& entry : m_pendingRefreshBands) {
+				if (entry.frameId < pending->frameId)
+					pending = &entry;
+			}
+
+			pending->frameId = id;
+			pending->keyframeId = refreshKeyframeId;
+			pending->band = refreshBand - 1;
+
+			// keep the band as client will copy it from the decoded frame
+			Video::Screen::Pixel* pixels = &m_pendingRefreshPixels[(pending - m_pendingRefreshBands) * REMOTE_INTRA_REFRESH_BAND_PIXELS];
+			const Video::Screen::Pixel* src = screen->pixels + pending->band * REMOTE_INTRA_REFRESH_BAND_PIXELS;
+			for (size_t i = 0; i < REMOTE_INTRA_REFRESH_BAND_PIXELS; ++i)
+				pixels[i] = remapTbl ? remapTbl[src[i]] : src[i];
+
+			// the band is sent again if it isn't acknowledged in time
+			if (refreshKeyframeId == m_lastKeyframeId)
+				m_refreshingBands &= ~(1 << pending->band);
+		}
+
+		void ZlibFrameCompressor::CommitAcknowledgedRefreshBand(uint64_t id) {
+			if (id == 0)
+				return;
+
+			for (auto& pending : m_pendingRefreshBands) {
+				if (pending.frameId != id)
+					continue;
+
+				pending.frameId = 0;
+
+				// client only keeps the first copy of a band it receives, so does the keyframe
+				auto keyframe = FindKeyframe(pending.keyframeId);
+				if (keyframe && !(keyframe->refreshedBands & (1 << pending.band)))
+				{
+					const Video::Screen::Pixel* pixels = &m_pendingRefreshPixels[(&pending - m_pendingRefreshBands) * REMOTE_INTRA_REFRESH_BAND_PIXELS];
+					memcpy(keyframe->screen.pixels + pending.band * REMOTE_INTRA_REFRESH_BAND_PIXELS, pixels, REMOTE_INTRA_REFRESH_BAND_PIXELS * sizeof(pixels[0]));
+
+					keyframe->refreshedBands |= 1 << pending.band;
+				}
+
+				break;
+			}
+		}
+
+		uint32_t ZlibFrameCompressor::PendingRefreshBands(uint64_t id) const {
+			uint32_t bands = 0;
+			for (auto& pending : m_pendingRefreshBands) {
+				if (pending.frameId && pending.keyframeId == m_lastKeyframeId && id < pending.frameId + REMOTE_INTRA_REFRESH_ACK_TIMEOUT)
+					bands |= 1 << pending.band;
+			}
+
+			return bands;
+		}
+
+		/*--------------- ZlibFrameDecompressor --------------------*/
+		ZlibFrameDecompressor::ZlibFrameDecompressor(Machine& machine, HQRemote::Client& client)
+			: ZlibFrameDecompressor(FRAME_COMPRESSOR_TYPE_ZLIB, machine, client)
+		{}
+
+		ZlibFrameDecompressor::ZlibFrameDecompressor(FrameCompressorType type, Machine& machine, HQRemote::Client& client)
+			: FrameDecompressorBase(type),
+			m_machine(machine), m_client(client),
+			m_lastDecompressId(INVALID_FRAME_ID),
+			m_slicesPool(REMOTE_FRAME_SLICES - 1)
+		{}
+
+		void ZlibFrameDecompressor::Start() {
+			m_lastDecompressId = INVALID_FRAME_ID; // invalid id
+			Reset();
+		}
+
+		void ZlibFrameDecompressor::Stop() {
+		}
+
+		bool ZlibFrameDecompressor::OnRemoteEvent(const HQRemote::Event& event) {
+			switch (event.type) {
+			default:
+				break;
+			}
+
+			return false;
+		}
+
+		void ZlibFrameDecompressor::FrameStep(Video::Output* videoOutput) {
+			// try to receive frame frome remote side
+			uint remoteBurstPhase;
+			bool hasFrame = HandleRemoteFrame(remoteBurstPhase);
+
+			// now render the frame
+			auto& ppu = m_machine.ppu;
+			auto& renderer = m_machine.renderer;
+
+			if (videoOutput && (hasFrame || m_lastDecompressId == INVALID_FRAME_ID))
+				renderer.Blit(*videoOutput, ppu.GetScreen(), remoteBurstPhase);
+		}
+
+		bool ZlibFrameDecompressor::HandleRemoteFrame(uint& remoteBurstPhase) {
+			auto eventRef = m_client.getFrameEvent();
+			if (!eventRef)
+				return false;
+
+			auto& event = eventRef->event;
+			auto frameId = event.renderedFrameData.frameId;
+			if (m_lastDecompressId != INVALID_FRAME_ID && m_lastDecompressId >= frameId)
+				return false;
+
+			uint remoteUsePermaLowres;
+
+			if (!Decompress(event.renderedFrameData.frameData, event.renderedFrameData.frameSize, frameId, remoteBurstPhase, remoteUsePermaLowres))
+				return false;
+
 			//check if host changed its frame resolution
 			if (remoteUsePermaLowres != this->downSample)
 			{
 				this->downSample = remoteUsePermaLowres;
 
 				Api::Machine::eventCallback(Api::Machine::EVENT_REMOTE_LOWRES, remoteUsePermaLowres ? RESULT_OK : RESULT_ERR_GENERIC);
-			}
-
-			return true;
-		}
-
+			}
+
+			return true;
+		}
+
 		bool ZlibFrameDecompressor::Decompress(const void* compressed, size_t compressedSize, uint64_t id, uint& burstPhase, uint& permaDownsample)
 		{
 			Video::Screen& screen = m_machine.ppu.GetScreen();
 
-			uint32_t width, height, numChannels;
-			auto packedFrame = HQRemote::ZlibImgComressor::decompress(compressed, compressedSize, width, height, numChannels);
-			if (packedFrame != nullptr)
+			//sliced frame's header & palette table are compressed separately from its slices
+			const unsigned char* blobs[REMOTE_MAX_FRAME_SLICES + 1];
+			uint32_t blobSizes[REMOTE_MAX_FRAME_SLICES + 1];
+			const uint32_t numSlices = parseSlices(compressed, compressedSize, blobs, blobSizes);
+			if (numSlices)
 			{
-				assert(width == Core::Video::Screen::WIDTH);
-				assert(height == Core::Video::Screen::HEIGHT);
-				assert(numChannels == 1);
+				compressed = blobs[0];
+				compressedSize = blobSizes[0];
+			}
 
+			auto packedFrame = DecompressPacked(compressed, compressedSize);
+			if (packedFrame != nullptr)
+			{
 				const unsigned char* pEnd = packedFrame->data() + packedFrame->size();
 				auto fullPixels = sizeof(((Video::Screen*)0)->pixels) / sizeof(Video::Screen::Pixel);
 
-				//packed data structure = keyframe Id | burst phase | downsample flag | num colors | pixels | palette table
+				//packed data structure = keyframe Id | burst phase | downsample flag & format | num colors | [refreshed keyframe id] | pixels | palette table
 				//parse burs phase & downsampling flag & number of used colors
-				uint64_t keyFrameId;
-				uint32_t wasDownsampled, numColors;
-				size_t stepsX, stepsY;
-				size_t startX, startY, endY;
+				uint64_t keyFrameId, refreshKeyframeId = 0;
+				uint32_t wasDownsampled, numColors, frameFormat, refreshBand;
+				size_t stepsY;
+
+				if (packedFrame->size() < sizeof(keyFrameId) + sizeof(burstPhase) + sizeof(wasDownsampled) + sizeof(numColors))//corruption
+					return false;
 
 				memcpy(&keyFrameId, packedFrame->data(), sizeof(keyFrameId));
 				memcpy(&burstPhase, packedFrame->data() + sizeof(keyFrameId), sizeof(burstPhase));
@@ -662,15 +1083,29 @@ namespace Nes {
 				if (numColors > Video::Screen::PALETTE)//corruption
 					return false;
 
+				frameFormat = (wasDownsampled & REMOTE_FRAME_FORMAT_MASK) >> REMOTE_FRAME_FORMAT_SHIFT;
+				refreshBand = (wasDownsampled & REMOTE_REFRESH_BAND_MASK) >> REMOTE_REFRESH_BAND_SHIFT;
+				wasDownsampled &= ~(REMOTE_FRAME_FORMAT_MASK | REMOTE_REFRESH_BAND_MASK);
+				if (frameFormat > Remote::REMOTE_FRAME_FORMAT_LATEST || refreshBand > REMOTE_INTRA_REFRESH_BANDS)//unknown format
+					return false;
+
+				if (numSlices && frameFormat < Remote::REMOTE_FRAME_FORMAT_SLICES)//corruption
+					return false;
+
+				if (refreshBand)
+				{
+					//only inter frame can carry a band of the keyframe being refreshed
+					if (keyFrameId == 0 || wasDownsampled || pEnd - packedPixels < (ptrdiff_t)sizeof(refreshKeyframeId))//corruption
+						return false;
+
+					memcpy(&refreshKeyframeId, packedPixels, sizeof(refreshKeyframeId));
+					packedPixels += sizeof(refreshKeyframeId);
+				}
+
 				permaDownsample = 0;//indicates that host is using low resolution permanently or adaptively
 
 				if (wasDownsampled != 0)
 				{
-					startX = 0;
-					startY = 0;
-					endY = Video::Screen::HEIGHT;
-
-					stepsX = 1;
 					stepsY = 2;
 
 					assert(Video::Screen::PIXELS < fullPixels);
@@ -680,75 +1115,158 @@ namespace Nes {
 						permaDownsample = 1;
 				}
 				else {
-					startX = startY = 0;
-					endY = Video::Screen::HEIGHT;
-					stepsX = stepsY = 1;
+					stepsY = 1;
 
 					assert(Video::Screen::PIXELS < fullPixels);
 					screen.pixels[Video::Screen::PIXELS] = 0;//mark the element after last pixel to indicate that we don't use downsampled frame
 				}
 
 				//unpacking pixels
-				unsigned int packedPixelsBitOffset = 0;
+				Keyframe* keyframe = NULL;
+				const Video::Screen::Pixel* referencePixels = NULL;
 
 				if (keyFrameId == 0)
 				{
 					//this is key frame or downsampled frame, it has full color info
+					//the cached key frame is invalid until the whole frame is decoded
 					if (!wasDownsampled)
-						m_lastKeyframeId = id;
-
-					//decode pixels' color directly
-					for (size_t y = startY; y < endY; y += stepsY) {
-						for (size_t x = startX; x < Video::Screen::WIDTH; x += stepsX) {
-							size_t i = y * Video::Screen::WIDTH + x;
-							auto colorIdx = (Video::Screen::Pixel)decodeULEB128Ex(packedPixels, packedPixelsBitOffset, &packedPixels, &packedPixelsBitOffset);
-							if (colorIdx < numColors)
-								screen.pixels[i] = colorIdx;
-							else
-								screen.pixels[i] = 0;
-
-							if (!wasDownsampled)
-								m_lastKeyframe.pixels[i] = screen.pixels[i];
-						}//for (size_t x = startX; x < Video::Screen::WIDTH; x += stepsX)
-					}//for (size_t y = startY; y < endY; y += stepsY)
+					{
+						keyframe = &AllocKeyframe(id, m_lastKeyframeId);
+						keyframe->id = 0;
+					}
 				}//if (keyFrameId == 0)
 				else {
-					//decode pixels' color base on difference from last key frame's pixels
-					if (m_lastKeyframeId != keyFrameId)
+					//decode pixels' color base on difference from key frame's pixels
+					auto reference = FindKeyframe(keyFrameId);
+					if (!reference || reference->refreshedBands != REMOTE_INTRA_REFRESH_ALL_BANDS)
 						return false;
 
-					for (size_t y = startY; y < endY; y += stepsY) {
-						for (size_t x = startX; x < Video::Screen::WIDTH; x += stepsX) {
-							size_t i = y * Video::Screen::WIDTH + x;
-							auto delta = decodeSLEB128Ex(packedPixels, packedPixelsBitOffset, &packedPixels, &packedPixelsBitOffset);
-							Video::Screen::Pixel colorIdx = delta + m_lastKeyframe.pixels[i];
-
-							if (colorIdx < numColors)
-								screen.pixels[i] = colorIdx;
-							else
-								screen.pixels[i] = 0;
-						}//for (size_t x = startX; x < Video::Screen::WIDTH; x += stepsX)
-					}//for (size_t y = startY; y < endY; y += stepsY)
+					//only the tiles changed since keyframe are stored
+					if (frameFormat >= Remote::REMOTE_FRAME_FORMAT_DIRTY_TILES && wasDownsampled)//corruption
+						return false;
+
+					referencePixels = reference->screen.pixels;
 				}//if (keyFrameId == 0)
 
+				Video::Screen::Pixel* keyframePixels = keyframe ? keyframe->screen.pixels : NULL;
+				const uint32_t *colorTbl;
+
+				if (numSlices == 0)
+				{
+					const unsigned char* packedPixelsEnd;
+					if (!unpackPixels(packedPixels, pEnd, numColors, referencePixels, keyframePixels, frameFormat, stepsY, 0, FramePacker::TILES_Y, screen.pixels, &packedPixelsEnd))
+						return false;//corruption
+
+					colorTbl = (const uint32_t*)(packedPixelsEnd);
+				}
+				else {
+					//the palette table is right after the header, decompress & unpack the slices in parallel
+					colorTbl = (const uint32_t*)(packedPixels);
+
+					bool slicesDecoded[REMOTE_MAX_FRAME_SLICES];
+					m_slicesPool.Run(numSlices, [&](uint slice) {
+						slicesDecoded[slice] = false;
+
+						try {
+							auto packedSlice = DecompressPacked(blobs[slice + 1], blobSizes[slice + 1]);
+							if (packedSlice == nullptr)
+								return;
+
+							slicesDecoded[slice] = unpackPixels(packedSlice->data(), packedSlice->data() + packedSlice->size(), numColors,
+								referencePixels, keyframePixels, frameFormat, stepsY,
+								sliceTileRowBegin(slice, numSlices), sliceTileRowBegin(slice + 1, numSlices),
+								screen.pixels, NULL);
+						}
+						catch (...) {
+						}
+					});
+
+					for (uint32_t i = 0; i < numSlices; ++i) {
+						if (!slicesDecoded[i])
+							return false;//corruption
+					}
+				}//if (numSlices == 0)
+
 				 //copy the color palette table
-				if (packedPixelsBitOffset > 0)
-					packedPixels++;
-				const uint32_t *colorTbl = (const uint32_t*)(packedPixels);
 				if ((unsigned char*)(colorTbl + numColors) > pEnd)//corruption
 					return false;
 				memcpy(screen.palette, colorTbl, numColors * sizeof(colorTbl[0]));
 
-				if (keyFrameId == 0 && !wasDownsampled)
+				if (keyframe)
 				{
 					//cache key frame's palette
-					memcpy(m_lastKeyframe.palette, screen.palette, numColors * sizeof(colorTbl[0]));
-				}//if (keyFrameId == 0)
+					memcpy(keyframe->screen.palette, screen.palette, numColors * sizeof(colorTbl[0]));
+
+					keyframe->id = m_lastKeyframeId = id;
+
+					if (frameFormat >= Remote::REMOTE_FRAME_FORMAT_KEYFRAME_ACK)
+						AcknowledgeKeyframe(id);
+				}//if (keyframe)
+				else if (refreshBand)
+				{
+					//this frame's band becomes a part of the keyframe being refreshed
+					auto refreshKeyframe = FindKeyframe(refreshKeyframeId);
+					if (!refreshKeyframe)
+					{
+						refreshKeyframe = &AllocKeyframe(refreshKeyframeId, keyFrameId);
+						refreshKeyframe->refreshedBands = 0;
+					}
+
+					//keep the first copy of a band, host commits the one we acknowledge
+					const uint32_t band = refreshBand - 1;
+					if (!(refreshKeyframe->refreshedBands & (1 << band)))
+					{
+						const size_t begin = band * REMOTE_INTRA_REFRESH_BAND_PIXELS;
+						memcpy(refreshKeyframe->screen.pixels + begin, screen.pixels + begin, REMOTE_INTRA_REFRESH_BAND_PIXELS * sizeof(screen.pixels[0]));
+
+						refreshKeyframe->refreshedBands |= 1 << band;
+						if (frameFormat >= Remote::REMOTE_FRAME_FORMAT_REFRESH_BAND_ACK)
+							AcknowledgeRefreshBand(id);
+
+						if (refreshKeyframe->refreshedBands == REMOTE_INTRA_REFRESH_ALL_BANDS)
+						{
+							m_lastKeyframeId = refreshKeyframeId;
+
+							AcknowledgeKeyframe(refreshKeyframeId);
+						}
+					}
+				}//else if (refreshBand)
 
 				return true;
 			}//if (packedFrame != nullptr)
 
 			return false;
-		}
-	}
+		}
+
+		HQRemote::DataRef ZlibFrameDecompressor::DecompressPacked(const void* compressed, size_t size) {
+			uint32_t width, height, numChannels;
+			auto packed = HQRemote::ZlibImgComressor::decompress(compressed, size, width, height, numChannels);
+
+			assert(!packed || width == Core::Video::Screen::WIDTH);
+			assert(!packed || height == Core::Video::Screen::HEIGHT);
+			assert(!packed || numChannels == 1);
+
+			return packed;
+		}
+
+		void ZlibFrameDecompressor::AcknowledgeKeyframe(uint64_t id) {
+			// tell host that it can use this keyframe as reference from now on
+			Remote::RemoteKeyframeAck ack;
+			ack.id = id;
+
+			HQRemote::PlainEvent event(Remote::REMOTE_KEYFRAME_ACK);
+			memcpy(event.event.customData, &ack, sizeof ack);
+			m_client.sendEvent(event);
+		}
+
+		void ZlibFrameDecompressor::AcknowledgeRefreshBand(uint64_t id) {
+			// tell host that it can make the band carried by this frame a part of its keyframe
+			Remote::RemoteRefreshBandAck ack;
+			ack.id = id;
+
+			HQRemote::PlainEvent event(Remote::REMOTE_REFRESH_BAND_ACK);
+			memcpy(event.event.customData, &ack, sizeof ack);
+			m_client.sendEvent(event);
+		}
+	}
 }
\ No newline at end of file
@@ -25,10 +25,13 @@
 #pragma once
 
 #include "NstFrameCompressorCommon.hpp"
+#include "NstWorkerPool.hpp"
 
 #include <RemoteController/Server/Engine.h>
 #include <RemoteController/Client/Client.h>
 
+#include <vector>
+
 #if defined DEBUG || defined _DEBUG
 #	define PROFILE_REMOTE_FRAME_COMPRESSION 0
 #else
@@ -39,12 +42,33 @@ namespace Nes {
 	namespace Core {
 		class ZlibFrameCompressorBase {
 		protected:
+			enum {
+				MAX_KEYFRAMES = 4 // number of cached reference frames
+			};
+
+			enum {
+				MAX_PACKED_FRAME_SIZE = sizeof(Video::Screen) * 2 // upper bound of a packed frame's size before entropy coding
+			};
+
+			struct Keyframe {
+				uint64_t id;
+				uint32_t refreshedBands;// bit mask of intra refresh bands received so far
+				uint32_t pins;// compression threads still reading the keyframe outside of the lock
+				Video::Screen screen;
+			};
+
 			ZlibFrameCompressorBase();
 
 			void Reset();
 
+			Keyframe* FindKeyframe(uint64_t id);
+			// reuse the oldest cached keyframe that isn't pinned, except the one having <keepId>
+			Keyframe& AllocKeyframe(uint64_t id, uint64_t keepId);
+			// true if AllocKeyframe() can find a keyframe to reuse whatever <keepId> is
+			bool CanAllocKeyframe() const;
+
 			uint64_t m_lastKeyframeId;
-			Video::Screen m_lastKeyframe;
+			Keyframe m_keyframes[MAX_KEYFRAMES];
 		};
 
 		class ZlibFrameCompressor : public FrameCompressorBase, ZlibFrameCompressorBase, HQRemote::ZlibImgComressor {
@@ -65,11 +89,44 @@ namespace Nes {
 
 			virtual void AdaptToClientSlowRecvRate(float clientRcvRate, float ourSendingRate) override;
 			virtual void AdaptToClientFastRecvRate(float clientRcvRate, float ourSendingRate) override;
+		protected:
+			ZlibFrameCompressor(FrameCompressorType type, const HQRemote::Engine& server);
+
+			// entropy coding of the packed frame, can be called from several threads at once
+			virtual HQRemote::DataRef CompressPacked(const void* packed, size_t size);
 		private:
+			enum {
+				MAX_PENDING_REFRESH_BANDS = 20 // intra refresh bands sent but not acknowledged by client yet
+			};
+
+			struct PendingRefreshBand {
+				uint64_t frameId;// frame carrying the band, 0 if the entry is free
+				uint64_t keyframeId;
+				uint32_t band;
+			};
+
 			// bytes per second
 			void EnableDataRateBudget(size_t rate, double frame_interval);
 			void UpdateFrameInterval(double frame_interval);
 
+			// number of frames between two keyframes, longer if keyframes don't fit the size budget
+			uint64_t KeyframeInterval() const;
+			// choose reference of a frame when client acknowledges keyframes, m_lock must be locked.
+			// Returns the keyframe that will be constructed by this frame, if any.
+			Keyframe* SelectAcknowledgedReference(uint64_t id, uint32_t frameFormat, uint64_t& referenceId, uint32_t& refreshBand);
+			// make a sent frame's band a part of the keyframe being refreshed, m_lock must be locked
+			void CommitRefreshBand(const Video::Screen* screen, const uint16_t* remapTbl, uint64_t refreshKeyframeId, uint32_t refreshBand);
+			// keep a sent frame's band until client acknowledges it, m_lock must be locked
+			void PendRefreshBand(const Video::Screen* screen, const uint16_t* remapTbl, uint64_t id, uint64_t refreshKeyframeId, uint32_t refreshBand);
+			// client received the band carried by frame <id>, m_lock must be locked
+			void CommitAcknowledgedRefreshBand(uint64_t id);
+			// bands of m_lastKeyframeId still waiting for acknowledgement at frame <id>, m_lock must be locked
+			uint32_t PendingRefreshBands(uint64_t id) const;
+
+			// compressor that isn't used by any other thread, return it by ReleaseCompressor()
+			HQRemote::ZlibImgComressor* AcquireCompressor();
+			void ReleaseCompressor(HQRemote::ZlibImgComressor* compressor);
+
 #if PROFILE_REMOTE_FRAME_COMPRESSION
 			std::mutex m_avgCompressionTimeLock;
 			float m_avgCompressionTime;
@@ -84,9 +141,20 @@ namespace Nes {
 			double m_avgKeyframeSize;
 			std::atomic<size_t> m_compressSizeBudget;
 			size_t m_dataRateBudget;
+			std::atomic<uint32_t> m_frameFormat;//format of inter frames, negotiated with client
+			uint64_t m_ackedKeyframeId;//last keyframe acknowledged by client
+			uint64_t m_buildingKeyframeId;//keyframe being constructed outside of the lock, 0 if none
+			uint32_t m_refreshingBands;//intra refresh bands of m_lastKeyframeId being sent
+			PendingRefreshBand m_pendingRefreshBands[MAX_PENDING_REFRESH_BANDS];
+			std::vector<Video::Screen::Pixel> m_pendingRefreshPixels;//remapped pixels of the pending bands
+			std::atomic<size_t> m_interPackedSize;//size of last inter frame's packed pixels
+			WorkerPool m_slicesPool;//packs & compresses frame's slices in parallel
+
+			std::mutex m_compressorsLock;
+			std::vector<HQRemote::ZlibImgComressor*> m_freeCompressors;//slices compressed at once don't share a zlib stream
 		};
 
-		class ZlibFrameDecompressor : public FrameDecompressorBase, ZlibFrameCompressorBase {
+		class ZlibFrameDecompressor : public FrameDecompressorBase, protected ZlibFrameCompressorBase {
 		public:
 			ZlibFrameDecompressor(Machine& machine, HQRemote::Client& client);
 
@@ -95,14 +163,23 @@ namespace Nes {
 
 			virtual void FrameStep(Video::Output* videoOutput) override;
 			virtual bool OnRemoteEvent(const HQRemote::Event& event) override;
+		protected:
+			ZlibFrameDecompressor(FrameCompressorType type, Machine& machine, HQRemote::Client& client);
+
+			// reverse of compressor's CompressPacked(), can be called from several threads at once.
+			// HQRemote's decompress() is static and inflates with its own stream on each call.
+			virtual HQRemote::DataRef DecompressPacked(const void* compressed, size_t size);
 		private:
 			bool HandleRemoteFrame(uint& burstPhase);
 			bool Decompress(const void* compressed, size_t compressedSize, uint64_t id, uint& burstPhase, uint& permaDownsample);
+			void AcknowledgeKeyframe(uint64_t id);
+			void AcknowledgeRefreshBand(uint64_t id);
 
 			Machine& m_machine;
 			HQRemote::Client& m_client;
 
 			uint64_t m_lastDecompressId;
+			WorkerPool m_slicesPool;//decompresses & unpacks frame's slices in parallel
 		};
 	}
 }
@@ -0,0 +1,219 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#include "NstMachine.hpp"
+#include "NstFrameCompressorZstd.hpp"
+
+#if REMOTE_USE_ZSTD
+
+#include <zstd.h>
+#include <zdict.h>
+
+#define REMOTE_ZSTD_LEVEL 3
+#define REMOTE_ZSTD_DICTIONARY_SIZE (32 * 1024)
+#define REMOTE_ZSTD_MAX_DICTIONARY_SAMPLES_SIZE (100 * REMOTE_ZSTD_DICTIONARY_SIZE)//total bytes of recent packed frames kept for training a dictionary
+
+namespace Nes {
+	namespace Core {
+		/* ------------- ZstdFrameCompressor ------------------*/
+		ZstdFrameCompressor::ZstdFrameCompressor(const HQRemote::Engine& server, const std::vector<unsigned char>& dictionary)
+			: ZlibFrameCompressor(FRAME_COMPRESSOR_TYPE_ZSTD, server),
+			m_dictionary(NULL), m_sampling(false), m_samplesSize(0)
+		{
+			if (dictionary.size())
+				m_dictionary = ZSTD_createCDict(dictionary.data(), dictionary.size(), REMOTE_ZSTD_LEVEL);
+		}
+
+		ZstdFrameCompressor::~ZstdFrameCompressor()
+		{
+			for (auto context : m_freeContexts)
+				ZSTD_freeCCtx(context);
+
+			ZSTD_freeCDict(m_dictionary);
+		}
+
+		ZSTD_CCtx* ZstdFrameCompressor::AcquireContext() {
+			{
+				std::lock_guard<std::mutex> lg(m_contextsLock);
+				if (m_freeContexts.size())
+				{
+					auto context = m_freeContexts.back();
+					m_freeContexts.pop_back();
+					return context;
+				}
+			}
+
+			return ZSTD_createCCtx();
+		}
+
+		void ZstdFrameCompressor::ReleaseContext(ZSTD_CCtx* context) {
+			std::lock_guard<std::mutex> lg(m_contextsLock);
+			m_freeContexts.push_back(context);
+		}
+
+		HQRemote::DataRef ZstdFrameCompressor::CompressPacked(const void* packed, size_t size) {
+			if (m_sampling)
+			{
+				//keep the recent frames for training a dictionary, dropping the oldest ones past the size limit
+				std::lock_guard<std::mutex> lg(m_samplesLock);
+				if (m_sampling)
+				{
+					m_samples.push_back(std::vector<unsigned char>((const unsigned char*)packed, (const unsigned char*)packed + size));
+					m_samplesSize += size;
+
+					while (m_samplesSize > REMOTE_ZSTD_MAX_DICTIONARY_SAMPLES_SIZE && m_samples.size() > 1)
+					{
+						m_samplesSize -= m_samples.front().size();
+						m_samples.pop_front();
+					}
+				}
+			}
+
+			auto context = AcquireContext();
+			if (!context)
+				return nullptr;
+
+			std::vector<unsigned char> buffer(ZSTD_compressBound(size));
+			size_t compressedSize;
+			if (m_dictionary)
+				compressedSize = ZSTD_compress_usingCDict(context, buffer.data(), buffer.size(), packed, size, m_dictionary);
+			else
+				compressedSize = ZSTD_compressCCtx(context, buffer.data(), buffer.size(), packed, size, REMOTE_ZSTD_LEVEL);
+
+			ReleaseContext(context);
+
+			if (ZSTD_isError(compressedSize))
+				return nullptr;
+
+			auto compressed = std::make_shared<HQRemote::CData>(compressedSize);
+			memcpy(compressed->data(), buffer.data(), compressedSize);
+
+			return compressed;
+		}
+
+		Result ZstdFrameCompressor::TrainDictionary(std::vector<unsigned char>& dictionary) {
+			std::vector<unsigned char> samples;
+			std::vector<size_t> sampleSizes;
+
+			{
+				std::lock_guard<std::mutex> lg(m_samplesLock);
+				if (!m_sampling)
+				{
+					//start collecting frames, the dictionary is trained on the next call
+					m_sampling = true;
+					return RESULT_ERR_NOT_READY;
+				}
+
+				if (m_samples.empty())
+					return RESULT_ERR_NOT_READY;
+
+				samples.reserve(m_samplesSize);
+				for (auto& sample : m_samples) {
+					samples.insert(samples.end(), sample.begin(), sample.end());
+					sampleSizes.push_back(sample.size());
+				}
+
+				m_sampling = false;
+				m_samples.clear();
+				m_samplesSize = 0;
+			}
+
+			dictionary.resize(REMOTE_ZSTD_DICTIONARY_SIZE);
+			size_t dictionarySize = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), samples.data(), sampleSizes.data(), (unsigned)sampleSizes.size());
+			if (ZDICT_isError(dictionarySize))
+			{
+				HQRemote::Log("frame compressor failed to train dictionary: %s", ZDICT_getErrorName(dictionarySize));
+				dictionary.clear();
+				return RESULT_ERR_GENERIC;
+			}
+
+			dictionary.resize(dictionarySize);
+
+			return RESULT_OK;
+		}
+
+		/*--------------- ZstdFrameDecompressor --------------------*/
+		ZstdFrameDecompressor::ZstdFrameDecompressor(Machine& machine, HQRemote::Client& client, const std::vector<unsigned char>& dictionary)
+			: ZlibFrameDecompressor(FRAME_COMPRESSOR_TYPE_ZSTD, machine, client),
+			m_dictionary(NULL)
+		{
+			if (dictionary.size())
+				m_dictionary = ZSTD_createDDict(dictionary.data(), dictionary.size());
+		}
+
+		ZstdFrameDecompressor::~ZstdFrameDecompressor()
+		{
+			for (auto context : m_freeContexts)
+				ZSTD_freeDCtx(context);
+
+			ZSTD_freeDDict(m_dictionary);
+		}
+
+		ZSTD_DCtx* ZstdFrameDecompressor::AcquireContext() {
+			{
+				std::lock_guard<std::mutex> lg(m_contextsLock);
+				if (m_freeContexts.size())
+				{
+					auto context = m_freeContexts.back();
+					m_freeContexts.pop_back();
+					return context;
+				}
+			}
+
+			return ZSTD_createDCtx();
+		}
+
+		void ZstdFrameDecompressor::ReleaseContext(ZSTD_DCtx* context) {
+			std::lock_guard<std::mutex> lg(m_contextsLock);
+			m_freeContexts.push_back(context);
+		}
+
+		HQRemote::DataRef ZstdFrameDecompressor::DecompressPacked(const void* compressed, size_t size) {
+			auto packedSize = ZSTD_getFrameContentSize(compressed, size);
+			if (packedSize == ZSTD_CONTENTSIZE_UNKNOWN || packedSize == ZSTD_CONTENTSIZE_ERROR ||
+				packedSize == 0 || packedSize > MAX_PACKED_FRAME_SIZE)//corruption
+				return nullptr;
+
+			auto context = AcquireContext();
+			if (!context)
+				return nullptr;
+
+			auto packed = std::make_shared<HQRemote::CData>((size_t)packedSize);
+			size_t decompressedSize;
+			if (m_dictionary)
+				decompressedSize = ZSTD_decompress_usingDDict(context, packed->data(), packed->size(), compressed, size, m_dictionary);
+			else
+				decompressedSize = ZSTD_decompressDCtx(context, packed->data(), packed->size(), compressed, size);
+
+			ReleaseContext(context);
+
+			if (ZSTD_isError(decompressedSize) || decompressedSize != packedSize)//corruption
+				return nullptr;
+
+			return packed;
+		}
+	}
+}
+
+#endif//if REMOTE_USE_ZSTD
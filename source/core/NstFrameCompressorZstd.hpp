@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "NstFrameCompressorZlib.hpp"
+
+#if REMOTE_USE_ZSTD
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+namespace Nes {
+	namespace Core {
+		// same indexed color packing as zlib frame compressor, but entropy coded by zstd using a dictionary
+		// trained on packed frames. Host & client must use the same dictionary.
+		class ZstdFrameCompressor : public ZlibFrameCompressor {
+		public:
+			ZstdFrameCompressor(const HQRemote::Engine& server, const std::vector<unsigned char>& dictionary);
+			~ZstdFrameCompressor();
+
+			// train a dictionary from the frames sent since the previous call. Frames are only kept between a first call,
+			// which starts collecting them and returns RESULT_ERR_NOT_READY, and the next one, which trains the dictionary.
+			Result TrainDictionary(std::vector<unsigned char>& dictionary);
+		protected:
+			virtual HQRemote::DataRef CompressPacked(const void* packed, size_t size) override;
+		private:
+			ZSTD_CCtx_s* AcquireContext();
+			void ReleaseContext(ZSTD_CCtx_s* context);
+
+			ZSTD_CDict_s* m_dictionary;
+
+			std::mutex m_contextsLock;
+			std::vector<ZSTD_CCtx_s*> m_freeContexts;
+
+			std::mutex m_samplesLock;
+			std::atomic<bool> m_sampling;
+			std::deque<std::vector<unsigned char> > m_samples;
+			size_t m_samplesSize;
+		};
+
+		class ZstdFrameDecompressor : public ZlibFrameDecompressor {
+		public:
+			ZstdFrameDecompressor(Machine& machine, HQRemote::Client& client, const std::vector<unsigned char>& dictionary);
+			~ZstdFrameDecompressor();
+		protected:
+			virtual HQRemote::DataRef DecompressPacked(const void* compressed, size_t size) override;
+		private:
+			ZSTD_DCtx_s* AcquireContext();
+			void ReleaseContext(ZSTD_DCtx_s* context);
+
+			ZSTD_DDict_s* m_dictionary;
+
+			std::mutex m_contextsLock;
+			std::vector<ZSTD_DCtx_s*> m_freeContexts;
+		};
+	}
+}
+
+#endif//if REMOTE_USE_ZSTD
@@ -0,0 +1,170 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2003-2008 Martin Freij
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#include "NstIoMap.hpp"
+
+namespace Nes
+{
+	namespace Core
+	{
+		namespace Io
+		{
+			#ifdef NST_MSVC_OPTIMIZE
+			#pragma optimize("s", on)
+			#endif
+
+			Map<0>::Map(const Port& port,const uint numPages)
+			{
+				Block* const block = new Block;
+
+				block->refs = numPages;
+
+				for (uint i=0; i < PAGE_SIZE; ++i)
+					block->ports[i] = 0;
+
+				ports.Append( port );
+				refs.Append( PAGE_SIZE );
+				blocks.Append( block );
+			}
+
+			Map<0>::~Map()
+			{
+				for (dword i=0; i < blocks.Size(); ++i)
+					delete blocks[i];
+			}
+
+			void Map<0>::BeginUpdate()
+			{
+				// ports no longer referenced may be reused, but only the
+				// ones not handed out again earlier in this same update
+
+				unused.Clear();
+
+				for (dword i=ports.Size(); i--; )
+				{
+					if (!refs[i])
+						unused.Append( i );
+				}
+			}
+
+			uint Map<0>::Intern(const Port& port)
+			{
+				for (dword i=0; i < ports.Size(); ++i)
+				{
+					if (ports[i] == port)
+					{
+						if (!refs[i])
+						{
+							for (word* it=unused.Begin(); it != unused.End(); ++it)
+							{
+								if (*it == i)
+								{
+									unused.Erase( it );
+									break;
+								}
+							}
+						}
+
+						return i;
+					}
+				}
+
+				if (unused.Size())
+				{
+					const uint i = unused.Pop();
+					ports[i] = port;
+					return i;
+				}
+
+				// blocks index the ports with words
+				if (ports.Size() > 0xFFFF)
+					throw RESULT_ERR_OUT_OF_MEMORY;
+
+				ports.Append( port );
+				refs.Append( 0 );
+
+				return ports.Size() - 1;
+			}
+
+			void Map<0>::Commit(Block*& page,const word* const indices)
+			{
+				if (std::memcmp( page->ports, indices, sizeof(page->ports) ) == 0)
+					return;
+
+				Block* block = NULL;
+
+				for (dword i=0; i < blocks.Size(); ++i)
+				{
+					if (std::memcmp( blocks[i]->ports, indices, sizeof(blocks[i]->ports) ) == 0)
+					{
+						block = blocks[i];
+						break;
+					}
+				}
+
+				if (!block)
+				{
+					block = new Block;
+					block->refs = 0;
+					std::memcpy( block->ports, indices, sizeof(block->ports) );
+
+					for (uint i=0; i < PAGE_SIZE; ++i)
+						refs[indices[i]]++;
+
+					blocks.Append( block );
+				}
+
+				block->refs++;
+				Release( page );
+				page = block;
+			}
+
+			void Map<0>::Release(Block* const block)
+			{
+				NST_ASSERT( block->refs );
+
+				if (--block->refs)
+					return;
+
+				for (uint i=0; i < PAGE_SIZE; ++i)
+					refs[block->ports[i]]--;
+
+				for (dword i=0; i < blocks.Size(); ++i)
+				{
+					if (blocks[i] == block)
+					{
+						blocks.Erase( blocks.Begin() + i );
+						break;
+					}
+				}
+
+				delete block;
+			}
+
+			#ifdef NST_MSVC_OPTIMIZE
+			#pragma optimize("", on)
+			#endif
+		}
+	}
+}
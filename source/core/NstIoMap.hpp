@@ -25,6 +25,8 @@
 #ifndef NST_IO_MAP_H
 #define NST_IO_MAP_H
 
+#include <cstring>
+#include "NstVector.hpp"
 #include "NstIoPort.hpp"
 
 #ifdef NST_PRAGMA_ONCE
@@ -37,7 +39,142 @@ namespace Nes
 	{
 		namespace Io
 		{
-			template<dword N> class Map
+			template<dword N> class Map;
+
+			// Two-level port table. Every 256 byte page points to a block of
+			// port indices and blocks are shared between pages with identical
+			// contents, so the whole address space usually fits in a few KB.
+
+			template<>
+			class Map<0>
+			{
+			public:
+
+				enum
+				{
+					PAGE_SHIFT = 8,
+					PAGE_SIZE = 1U << PAGE_SHIFT,
+					PAGE_MASK = PAGE_SIZE - 1
+				};
+
+			protected:
+
+				struct Block
+				{
+					dword refs;
+					word ports[PAGE_SIZE];
+				};
+
+				Map(const Port&,uint);
+				~Map();
+
+				template<typename F>
+				void Apply(Block**,Address,Address,const F&);
+
+				void BeginUpdate();
+				uint Intern(const Port&);
+				void Commit(Block*&,const word*);
+				void Release(Block*);
+
+				Vector<Port> ports;
+				Vector<dword> refs;
+				Vector<Block*> blocks;
+				Vector<word> unused;
+
+			private:
+
+				Map(const Map&);
+				void operator = (const Map&);
+
+				template<typename A,typename B,typename C>
+				struct Setter3
+				{
+					A a; B b; C c;
+
+					Setter3(A a_,B b_,C c_)
+					: a(a_), b(b_), c(c_) {}
+
+					void operator () (Port& port) const
+					{
+						port.Set( a, b, c );
+					}
+				};
+
+				template<typename A,typename B>
+				struct Setter2
+				{
+					A a; B b;
+
+					Setter2(A a_,B b_)
+					: a(a_), b(b_) {}
+
+					void operator () (Port& port) const
+					{
+						port.Set( a, b );
+					}
+				};
+
+				template<typename A>
+				struct Setter1
+				{
+					A a;
+
+					explicit Setter1(A a_)
+					: a(a_) {}
+
+					void operator () (Port& port) const
+					{
+						port.Set( a );
+					}
+				};
+
+				struct Assigner
+				{
+					const Port& port;
+
+					explicit Assigner(const Port& p)
+					: port(p) {}
+
+					void operator () (Port& p) const
+					{
+						p = port;
+					}
+				};
+
+				template<dword N> friend class Map;
+			};
+
+			template<typename F>
+			void Map<0>::Apply(Block** const pages,const Address first,const Address last,const F& f)
+			{
+				BeginUpdate();
+
+				for (Address page=first >> PAGE_SHIFT, end=last >> PAGE_SHIFT; page <= end; ++page)
+				{
+					word indices[PAGE_SIZE];
+					std::memcpy( indices, pages[page]->ports, sizeof(indices) );
+
+					uint prev = ~0U, next = 0;
+
+					for (uint i=(page << PAGE_SHIFT < first ? first & PAGE_MASK : 0), n=(page == end ? last & PAGE_MASK : uint(PAGE_MASK)); i <= n; ++i)
+					{
+						if (indices[i] != prev)
+						{
+							prev = indices[i];
+
+							Port port( ports[prev] );
+							f( port );
+							next = Intern( port );
+						}
+
+						indices[i] = next;
+					}
+
+					Commit( pages[page], indices );
+				}
+			}
+
+			template<dword N> class Map : public Map<0>
 			{
 			public:
 
@@ -45,79 +182,77 @@ namespace Nes
 				{
 					SIZE = N,
 					OVERFLOW_SIZE = 0x100,
-					FULL_SIZE = SIZE + OVERFLOW_SIZE
+					FULL_SIZE = SIZE + OVERFLOW_SIZE,
+					NUM_PAGES = FULL_SIZE >> PAGE_SHIFT
 				};
 
-			protected:
+			private:
+
+				NST_COMPILE_ASSERT( SIZE % PAGE_SIZE == 0 );
 
-				Port ports[FULL_SIZE];
+				Block* pages[NUM_PAGES];
 
 			public:
 
 				class Section
 				{
-					Port* NST_RESTRICT port;
-					const Port* const end;
+					Map& map;
+					const Address first;
+					const Address last;
 
 				public:
 
-					Section(Port* b,const Port* e)
-					: port(b), end(e) {}
+					Section(Map& m,Address f,Address l)
+					: map(m), first(f), last(l) {}
 
 					template<typename A,typename B,typename C>
-					void Set(A a,B b,C c)
+					void Set(A a,B b,C c) const
 					{
-						do
-						{
-							port->Set( a, b, c );
-						}
-						while (++port != end);
+						map.Apply( map.pages, first, last, Setter3<A,B,C>(a,b,c) );
 					}
 
 					template<typename A,typename B>
-					void Set(A a,B b)
+					void Set(A a,B b) const
 					{
-						do
-						{
-							port->Set( a, b );
-						}
-						while (++port != end);
+						map.Apply( map.pages, first, last, Setter2<A,B>(a,b) );
 					}
 
 					template<typename A>
-					void Set(A a)
+					void Set(A a) const
 					{
-						do
-						{
-							port->Set( a );
-						}
-						while (++port != end);
+						map.Apply( map.pages, first, last, Setter1<A>(a) );
+					}
+
+					void operator = (const Port& port) const
+					{
+						map.Apply( map.pages, first, last, Assigner(port) );
 					}
 				};
 
 				template<typename A,typename B,typename C>
 				Map(A a,B b,C c)
+				: Map<0>( Port(a,b,c), NUM_PAGES )
 				{
-					for (dword i=SIZE; i < FULL_SIZE; ++i)
-						ports[i].Set( a, b, c );
+					for (uint i=0; i < NUM_PAGES; ++i)
+						pages[i] = blocks.Front();
 				}
 
 				const Port& operator [] (Address address) const
 				{
 					NST_ASSERT( address < FULL_SIZE );
-					return ports[address];
+					return ports[pages[address >> PAGE_SHIFT]->ports[address & PAGE_MASK]];
 				}
 
-				Port& operator () (Address address)
+				Section operator () (Address address)
 				{
 					NST_ASSERT( address < FULL_SIZE );
-					return ports[address];
+					return Section( *this, address, address );
 				}
 
 				Section operator () (Address first,Address last)
 				{
 					NST_ASSERT( first <= last && last < SIZE );
-					return Section( ports + first, ports + last + 1 );
+					return Section( *this, first, last );
 				}
 			};
 		}
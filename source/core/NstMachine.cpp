@@ -34,6 +34,13 @@
 #include "NstFrameCompressorH264.hpp"
 #endif
 #include "NstFrameCompressorZlib.hpp"
+#if REMOTE_USE_LZ4
+#include "NstFrameCompressorLz4.hpp"
+#endif
+#if REMOTE_USE_ZSTD
+#include "NstFrameCompressorZstd.hpp"
+#endif
+#include "NstCrc32.hpp"
 #include "input/NstInpDevice.hpp"
 #include "input/NstInpAdapter.hpp"
 #include "input/NstInpPad.hpp"
@@ -148,6 +155,8 @@ namespace Nes
 		Machine::Machine()
 			:state(Api::Machine::NTSC),
 			frame(0),
+			headless(false),
+			pipelined(false),
 			extPort(new Input::AdapterTwo(*new Input::Pad(cpu, 0), *new Input::Pad(cpu, 1))),
 			expPort(new Input::Device(cpu)),
 			image(NULL),
@@ -155,6 +164,10 @@ namespace Nes
 			imageDatabase(NULL),
 			ppu(cpu),
 			lastSentInputId(0), lastSentInputTime(0), 
+			preferredFrameCompressorType(FRAME_COMPRESSOR_TYPE_ZLIB),
+			clientFrameCompressors(0), clientFrameDictionaryId(0), remoteFrameDictionaryId(0),
+			lockstepAllowed(true), lockstepInputDelay(Netplay::DEFAULT_INPUT_DELAY), lockstepMaxRollbackFrames(0),
+			rollbackSnapshots(Netplay::MAX_ROLLBACK_FRAMES + 2), lockstepLocalPad(0), lockstepRemotePad(1),
 			avgExecuteTime(0), executeWindowTime(0),
 			avgCpuExecuteTime(0), cpuExecuteWindowTime(0),
 			avgPpuEndFrameTime(0), ppuEndFrameWindowTime(0),
@@ -319,6 +332,9 @@ namespace Nes
 
 		void Machine::StopRemoteControl()
 		{
+			if (netplay.IsActive())
+				StopLockstep(RESULT_ERR_NOT_READY);
+
 			if (remoteFrameDecompressor) {
 				remoteFrameDecompressor->Stop();
 				remoteFrameDecompressor = nullptr;
@@ -341,6 +357,11 @@ namespace Nes
 			if (!this->hostEngine)
 				return;
 			if (!this->remoteFrameCompressor || this->remoteFrameCompressor->type != type) {
+				// keep host's low resolution setting
+				uint32_t downSample = this->remoteFrameCompressor ? this->remoteFrameCompressor->downSample.load() : 0;
+				if (this->remoteFrameCompressor)
+					this->remoteFrameCompressor->Stop();
+
 				switch (type) {
 #if REMOTE_USE_H264
 				case FRAME_COMPRESSOR_TYPE_H264:
@@ -348,6 +369,20 @@ namespace Nes
 					ppu.EnableColorUseCount(false);
 					renderer.EnableRenderedFrameCaching(true);
 					break;
+#endif
+#if REMOTE_USE_LZ4
+				case FRAME_COMPRESSOR_TYPE_LZ4:
+					this->remoteFrameCompressor = std::make_shared<Lz4FrameCompressor>(*this->hostEngine);
+					ppu.EnableColorUseCount(true);
+					renderer.EnableRenderedFrameCaching(false);
+					break;
+#endif
+#if REMOTE_USE_ZSTD
+				case FRAME_COMPRESSOR_TYPE_ZSTD:
+					this->remoteFrameCompressor = std::make_shared<ZstdFrameCompressor>(*this->hostEngine, this->remoteFrameDictionary);
+					ppu.EnableColorUseCount(true);
+					renderer.EnableRenderedFrameCaching(false);
+					break;
 #endif
 				default:
 					this->remoteFrameCompressor = std::make_shared<ZlibFrameCompressor>(*this->hostEngine);
@@ -355,6 +390,7 @@ namespace Nes
 					renderer.EnableRenderedFrameCaching(false);
 				}
 
+				this->remoteFrameCompressor->downSample = downSample;
 				this->remoteFrameCompressor->Start();
 				this->hostEngine->setImageCompressor(this->remoteFrameCompressor);
 			}
@@ -363,6 +399,33 @@ namespace Nes
 			}
 		}
 
+		void Machine::SelectRemoteFrameCompressor() {
+			// H264 is requested by client, keep it
+			if (!this->remoteFrameCompressor || !this->remoteFrameCompressor->UseIndexedColor())
+				return;
+
+			// use host's preferred compressor if client can decode it
+			int type = FRAME_COMPRESSOR_TYPE_ZLIB;
+			if (this->clientFrameCompressors & (1 << this->preferredFrameCompressorType))
+			{
+				if (this->preferredFrameCompressorType != FRAME_COMPRESSOR_TYPE_ZSTD || this->clientFrameDictionaryId == this->remoteFrameDictionaryId)
+					type = this->preferredFrameCompressorType;
+			}
+
+			if (this->remoteFrameCompressor->type == type)
+				return;
+
+			UseFrameCompressorType(type);
+
+			// tell client to switch its decompressor too
+			Remote::RemoteFrameCompressor compressor;
+			compressor.type = type;
+
+			HQRemote::PlainEvent event(Remote::REMOTE_USE_FRAME_COMPRESSOR);
+			memcpy(event.event.customData, &compressor, sizeof compressor);
+			this->hostEngine->sendEvent(event);
+		}
+
 		void Machine::UseFrameDecompressorType(int type) {
 			if (!this->clientEngine)
 				return;
@@ -373,6 +436,18 @@ namespace Nes
 					this->remoteFrameDecompressor = std::make_shared<H264FrameDecompressor>(*this, *this->clientEngine);
 					this->clientEngine->setMaxPendingFrames(10);
 					break;
+#endif
+#if REMOTE_USE_LZ4
+				case FRAME_COMPRESSOR_TYPE_LZ4:
+					this->remoteFrameDecompressor = std::make_shared<Lz4FrameDecompressor>(*this, *this->clientEngine);
+					this->clientEngine->setMaxPendingFrames(4);
+					break;
+#endif
+#if REMOTE_USE_ZSTD
+				case FRAME_COMPRESSOR_TYPE_ZSTD:
+					this->remoteFrameDecompressor = std::make_shared<ZstdFrameDecompressor>(*this, *this->clientEngine, this->remoteFrameDictionary);
+					this->clientEngine->setMaxPendingFrames(4);
+					break;
 #endif
 				default:
 					this->remoteFrameDecompressor = std::make_shared<ZlibFrameDecompressor>(*this, *this->clientEngine);
@@ -460,6 +535,9 @@ namespace Nes
 		{
 			//TODO: support more than 1 remote controller
 			if (hostEngine) {
+				if (netplay.IsActive())
+					StopLockstep(RESULT_ERR_CONNECTION);
+
 				//frame compressor must be stopped before stopping host engine to prevent deadlock
 				if (this->remoteFrameCompressor) {
 					this->remoteFrameCompressor->Stop();
@@ -509,6 +587,46 @@ namespace Nes
 			}
 		}
 
+		void Machine::SetRemoteFrameCompressor(int type) {
+			this->preferredFrameCompressorType = type;
+
+			//switch now if client is already connected
+			if (this->hostEngine && this->hostEngine->connected() && this->clientFrameCompressors)
+				SelectRemoteFrameCompressor();
+		}
+
+		void Machine::SetRemoteFrameDictionary(const void* data, size_t size) {
+			if (data && size)
+			{
+				this->remoteFrameDictionary.assign((const unsigned char*)data, (const unsigned char*)data + size);
+				this->remoteFrameDictionaryId = Crc32::Compute((const byte*)data, size);
+			}
+			else {
+				this->remoteFrameDictionary.clear();
+				this->remoteFrameDictionaryId = 0;
+			}
+		}
+
+		Result Machine::TrainRemoteFrameDictionary(std::vector<unsigned char>& dictionary) {
+#if REMOTE_USE_ZSTD
+			if (!this->remoteFrameCompressor || this->remoteFrameCompressor->type != FRAME_COMPRESSOR_TYPE_ZSTD)
+				return RESULT_ERR_NOT_READY;
+
+			return static_cast<ZstdFrameCompressor*>(this->remoteFrameCompressor.get())->TrainDictionary(dictionary);
+#else
+			return RESULT_ERR_UNSUPPORTED;
+#endif
+		}
+
+		void Machine::SendFrameFormatToHost() {
+			Remote::RemoteFrameFormatVersion frameFormat;
+			frameFormat.version = Remote::REMOTE_FRAME_FORMAT_LATEST;
+
+			HQRemote::PlainEvent event(Remote::REMOTE_FRAME_FORMAT);
+			memcpy(event.event.customData, &frameFormat, sizeof frameFormat);
+			this->clientEngine->sendEvent(event);
+		}
+
 		//<id> is used for ACK message later to acknowledge that the message is received by remote side.
 		//<message> must not have more than MAX_REMOTE_MESSAGE_SIZE bytes (excluding NULL character). Otherwise RESULT_ERR_BUFFER_TOO_BIG is retuned.
 		//This function can be used to send message between client & server
@@ -558,6 +676,481 @@ namespace Nes
 			}
 		}
 
+		/*----------lockstep netplay ----------------*/
+		void Machine::EnableRemoteLockstep(bool enable, uint inputDelay, uint maxRollbackFrames) {
+			this->lockstepAllowed = enable;
+			this->lockstepInputDelay = __min__(inputDelay, (uint)Netplay::MAX_INPUT_DELAY);
+			this->lockstepMaxRollbackFrames = __min__(maxRollbackFrames, (uint)Netplay::MAX_ROLLBACK_FRAMES);
+		}
+
+		Result Machine::LoadRemoteLockstep(const std::string& remoteIp, int remotePort, const char* clientInfo)
+		{
+			HQRemote::ConnectionEndpoint reliableHost(remoteIp.c_str(), remotePort);
+			HQRemote::ConnectionEndpoint unreliableHost(remoteIp.c_str(), remotePort + 1);
+
+			auto clientConnHandler = std::make_shared<HQRemote::SocketClientHandler>(remotePort + 2, remotePort + 3, reliableHost, unreliableHost);
+
+			return LoadRemoteLockstep(clientConnHandler, clientInfo);
+		}
+
+		Result Machine::LoadRemoteLockstep(std::shared_ptr<HQRemote::IConnectionHandler> clientConnHandler, const char* _clientInfo)
+		{
+			//the image is run locally, so it must be loaded first
+			if (!Is(Api::Machine::GAME, Api::Machine::ON) || Is(Api::Machine::REMOTE))
+				return RESULT_ERR_NOT_READY;
+
+			DisableRemoteControllers();
+			StopRemoteControl();
+
+			Result re = RESULT_OK;
+
+			auto audioCapturer = std::make_shared<NesClientAudioCapturer>(*this);
+
+			this->clientEngine = std::make_shared<HQRemote::Client>(clientConnHandler, DEFAULT_REMOTE_FRAME_INTERVAL, audioCapturer);
+			this->clientEngine->setDesc(_clientInfo);
+
+			if (!this->clientEngine->start(true))
+			{
+				this->clientEngine = nullptr;
+				re = RESULT_ERR_CONNECTION;
+			}
+			else {
+				this->clientState = 0;
+
+				this->clientInfo = _clientInfo != NULL ? _clientInfo : "";
+
+				this->hostName.clear();//invalidate host name until receiving update from host
+
+				//apu's state depends on sound settings, they must be the same as host's
+				EnsureCorrectRemoteSoundSettings();
+			}
+
+			Api::Machine::eventCallback(Api::Machine::EVENT_LOAD_REMOTE, re);
+			return re;
+		}
+
+		template <class EventType>
+		void Machine::SendEventToRemote(const EventType& event) {
+			if (this->hostEngine)
+				this->hostEngine->sendEvent(event);
+			else if (this->clientEngine)
+				this->clientEngine->sendEvent(event);
+		}
+
+		void Machine::StartLockstepAsHost(uint32_t prgCrc) {
+			Result result = RESULT_OK;
+
+			if (!this->lockstepAllowed)
+				result = RESULT_ERR_UNSUPPORTED;
+			else if (!Is(Api::Machine::GAME, Api::Machine::ON))
+				result = RESULT_ERR_NOT_READY;
+			else if (prgCrc != image->GetPrgCrc())
+				result = RESULT_ERR_INVALID_CRC;
+
+			if (NES_SUCCEEDED(result))
+			{
+				try {
+					//apu's state depends on sound settings, client will use the same ones
+					EnsureCorrectRemoteSoundSettings();
+
+					//send our current state, both sides start executing from it
+					std::ostringstream stateStream;
+					{
+						State::Saver saver(static_cast<std::ostream*>(&stateStream), true, false);
+						SaveState(saver);
+					}
+					const std::string stateData = stateStream.str();
+
+					Remote::RemoteLockstepStart start;
+					start.prgCrc = prgCrc;
+					start.mode = (state & Api::Machine::NTSC) ? Api::Machine::NTSC : Api::Machine::PAL;
+					start.inputDelay = this->lockstepInputDelay;
+					start.clientPad = cpu.GetRemoteControllerIdx() < 4 ? cpu.GetRemoteControllerIdx() : 1;
+					start.maxRollbackFrames = this->lockstepMaxRollbackFrames;
+
+					HQRemote::FrameEvent startEvent(sizeof start + stateData.size(), 0, Remote::REMOTE_LOCKSTEP_START);
+					memcpy(startEvent.event.renderedFrameData.frameData, &start, sizeof start);
+					memcpy(startEvent.event.renderedFrameData.frameData + sizeof start, stateData.data(), stateData.size());
+					this->hostEngine->sendEvent(startEvent);
+
+					this->lockstepLocalPad = 0;
+					this->lockstepRemotePad = start.clientPad;
+				}
+				catch (Result r) {
+					result = r;
+				}
+				catch (...) {
+					result = RESULT_ERR_GENERIC;
+				}
+			}
+
+			if (NES_FAILED(result))
+			{
+				//client can keep streaming video instead
+				Remote::RemoteLockstepEnd end;
+				end.result = result;
+
+				HQRemote::PlainEvent endEvent(Remote::REMOTE_LOCKSTEP_END);
+				memcpy(endEvent.event.customData, &end, sizeof end);
+				this->hostEngine->sendEvent(endEvent);
+
+				Api::Machine::eventCallback(Api::Machine::EVENT_REMOTE_LOCKSTEP, result);
+				return;
+			}
+
+			this->rollbackSnapshots.Clear();
+			this->netplay.Start(this->lockstepInputDelay, this->lockstepMaxRollbackFrames);
+
+			Api::Machine::eventCallback(Api::Machine::EVENT_REMOTE_LOCKSTEP, RESULT_OK);
+		}
+
+		void Machine::StartLockstepAsClient(const unsigned char* data, size_t size) {
+			Remote::RemoteLockstepStart start;
+			if (size < sizeof start)
+				return;
+			memcpy(&start, data, sizeof start);
+
+			Result result = RESULT_OK;
+
+			if (!image || start.prgCrc != image->GetPrgCrc())
+				result = RESULT_ERR_INVALID_CRC;
+			else
+			{
+				try {
+					if ((state & start.mode) == 0)
+					{
+						//switch region like Api::Machine::SetMode() does, but keep the connection alive
+						state &= ~uint(Api::Machine::ON);
+						SwitchMode();
+						Reset(true);
+					}
+
+					EnsureCorrectRemoteSoundSettings();
+
+					std::istringstream stateStream(std::string((const char*)data + sizeof start, size - sizeof start));
+					State::Loader loader(static_cast<std::istream*>(&stateStream), true);
+
+					tracker.Resync();
+					if (!LoadState(loader, false))
+						result = RESULT_ERR_INVALID_CRC;
+				}
+				catch (Result r) {
+					result = r;
+				}
+				catch (...) {
+					result = RESULT_ERR_GENERIC;
+				}
+			}
+
+			if (NES_FAILED(result))
+			{
+				StopLockstep(result);
+				return;
+			}
+
+			this->lockstepLocalPad = start.clientPad < 4 ? start.clientPad : 1;
+			this->lockstepRemotePad = 0;
+			this->rollbackSnapshots.Clear();
+			this->netplay.Start(start.inputDelay, start.maxRollbackFrames);
+
+			Api::Machine::eventCallback(Api::Machine::EVENT_REMOTE_LOCKSTEP, RESULT_OK);
+		}
+
+		void Machine::StopLockstep(Result reason) {
+			const bool wasActive = this->netplay.IsActive();
+
+			this->netplay.Stop();
+			cpu.SetLockstepPads(NULL);
+
+			if (this->hostEngine)
+			{
+				//tell client to stop too
+				if (wasActive && this->hostEngine->connected())
+				{
+					Remote::RemoteLockstepEnd end;
+					end.result = reason;
+
+					HQRemote::PlainEvent endEvent(Remote::REMOTE_LOCKSTEP_END);
+					memcpy(endEvent.event.customData, &end, sizeof end);
+					this->hostEngine->sendEvent(endEvent);
+				}
+			}
+			else if (this->clientEngine && !(state & Api::Machine::REMOTE))
+			{
+				//lockstep client has no use of the connection anymore, the image keeps running locally
+				this->clientEngine->stop();
+				this->clientEngine = nullptr;
+				this->clientState = 0;
+			}
+
+			if (wasActive || NES_FAILED(reason))
+				Api::Machine::eventCallback(Api::Machine::EVENT_REMOTE_LOCKSTEP, reason);
+		}
+
+		bool Machine::HandleLockstepEventsAsClient() {
+			if (this->clientEngine->connected() == false) {
+				auto errorMsg = this->clientEngine->getConnectionInternalError();
+				if (errorMsg || this->clientEngine->timeSinceStart() > 60.0f || this->clientState != 0)
+				{
+					StopLockstep(RESULT_ERR_CONNECTION);
+
+					if (errorMsg)
+						Api::Machine::eventCallback(Api::Machine::EVENT_REMOTE_CONNECTION_INTERNAL_ERROR, (Result)(intptr_t)(errorMsg->c_str()));
+					else
+						Api::Machine::eventCallback(Api::Machine::EVENT_REMOTE_DISCONNECTED);
+
+					return true;
+				}
+
+				return false;
+			}//if (this->clientEngine->connected() == false)
+
+			if (this->clientState == 0) {
+				this->clientState = CLIENT_CONNECTED_STATE;
+
+				//send client info to host
+				HQRemote::FrameEvent clientInfoEvent(this->clientInfo.size(), 0, HQRemote::ENDPOINT_NAME);
+				memcpy(clientInfoEvent.event.renderedFrameData.frameData, this->clientInfo.c_str(), this->clientInfo.size());
+				this->clientEngine->sendEvent(clientInfoEvent);
+
+				//ask host to run its image in lockstep with us
+				Remote::RemoteLockstepRequest request;
+				request.prgCrc = image->GetPrgCrc();
+
+				HQRemote::PlainEvent event(Remote::REMOTE_LOCKSTEP_REQUEST);
+				memcpy(event.event.customData, &request, sizeof request);
+				this->clientEngine->sendEvent(event);
+			}
+
+			// consume as many events as possible
+			while (this->clientEngine && HandleLockstepEventAsClient()) {
+			}
+
+			return !this->clientEngine || this->netplay.IsActive();
+		}
+
+		bool Machine::HandleLockstepEventAsClient() {
+			auto eventRef = this->clientEngine->getEvent();
+			if (eventRef == nullptr)
+				return false;
+
+			auto & event = eventRef->event;
+
+			switch (event.type) {
+			case Remote::REMOTE_LOCKSTEP_START:
+				StartLockstepAsClient((const unsigned char*)event.renderedFrameData.frameData, event.renderedFrameData.frameSize);
+				break;
+			case Remote::REMOTE_LOCKSTEP_END:
+			{
+				Remote::RemoteLockstepEnd end;
+				memcpy(&end, event.customData, sizeof end);
+
+				StopLockstep((Result)end.result);
+			}
+				break;
+			case Remote::REMOTE_LOCKSTEP_INPUT:
+			case Remote::REMOTE_LOCKSTEP_CHECKSUM:
+				OnLockstepEvent(event);
+				break;
+			case HQRemote::ENDPOINT_NAME://name of host
+			{
+				if (event.renderedFrameData.frameSize == 0)
+					this->hostName = "A player";
+				else
+					this->hostName.assign((const char*)event.renderedFrameData.frameData, event.renderedFrameData.frameSize);
+
+				//invoke callback
+				Api::Machine::eventCallback(Api::Machine::EVENT_REMOTE_CONNECTED, (Result)(intptr_t)(this->hostName.c_str()));
+			}
+				break;
+			case HQRemote::MESSAGE:
+			case HQRemote::MESSAGE_ACK:
+				HandleCommonEvent(event);
+				break;
+			default:
+				// video & audio streaming events are not used in lockstep
+				break;
+			}
+
+			return true;
+		}
+
+		void Machine::OnLockstepEvent(const HQRemote::Event& event) {
+			switch (event.type) {
+			case Remote::REMOTE_LOCKSTEP_INPUT:
+			{
+				Remote::RemoteLockstepInput lockstepInput;
+				memcpy(&lockstepInput, event.customData, sizeof lockstepInput);
+
+				this->netplay.QueueRemoteInput(lockstepInput.frame, lockstepInput.buttons);
+			}
+				break;
+			case Remote::REMOTE_LOCKSTEP_CHECKSUM:
+			{
+				Remote::RemoteLockstepChecksum checksum;
+				memcpy(&checksum, event.customData, sizeof checksum);
+
+				if (this->netplay.AddRemoteChecksum(checksum.frame, checksum.crc))
+					Api::Machine::eventCallback(Api::Machine::EVENT_REMOTE_DESYNC, (Result)checksum.frame);
+			}
+				break;
+			}
+		}
+
+		dword Machine::GetLockstepChecksum() const {
+			std::ostringstream stateStream;
+			{
+				State::Saver saver(static_cast<std::ostream*>(&stateStream), false, false);
+				SaveState(saver);
+			}
+			const std::string stateData = stateStream.str();
+
+			return Crc32::Compute((const byte*)stateData.data(), stateData.size());
+		}
+
+		bool Machine::BeginLockstepFrame(Input::Controllers*& input) {
+			//schedule local input for a future frame & send it to remote side
+			if (this->netplay.NeedLocalInput())
+			{
+				uint buttons = 0;
+				if (input)
+				{
+					Input::Controllers::Pad& pad = input->pad[0];
+					if (Input::Controllers::Pad::callback(pad, 0))
+					{
+						enum
+						{
+							UP    = Input::Controllers::Pad::UP,
+							RIGHT = Input::Controllers::Pad::RIGHT,
+							DOWN  = Input::Controllers::Pad::DOWN,
+							LEFT  = Input::Controllers::Pad::LEFT
+						};
+
+						//filter by our own setting, remote side must see the same buttons
+						buttons = pad.buttons & 0xFF;
+						if (!pad.allowSimulAxes)
+						{
+							if ((buttons & (UP|DOWN)) == (UP|DOWN))
+								buttons &= (UP|DOWN) ^ 0xFFU;
+
+							if ((buttons & (LEFT|RIGHT)) == (LEFT|RIGHT))
+								buttons &= (LEFT|RIGHT) ^ 0xFFU;
+						}
+					}
+				}
+
+				Remote::RemoteLockstepInput lockstepInput;
+				lockstepInput.frame = this->netplay.QueueLocalInput(buttons);
+				lockstepInput.buttons = buttons;
+
+				HQRemote::PlainEvent inputEvent(Remote::REMOTE_LOCKSTEP_INPUT);
+				memcpy(inputEvent.event.customData, &lockstepInput, sizeof lockstepInput);
+				SendEventToRemote(inputEvent);
+			}
+
+			//re-simulate the frames executed with mispredicted remote input
+			if (this->netplay.NeedRollback())
+				RollbackLockstepFrames();
+
+			if (!this->netplay.IsFrameReady())
+				return false;
+
+			//keep the state before this frame in case remote input turns out to be mispredicted
+			if (this->netplay.GetMaxRollbackFrames())
+				this->rollbackSnapshots.Save(*this, this->netplay.GetFrame());
+
+			//exchange state's checksum periodically to detect desync
+			SendLockstepChecksum();
+
+			SetLockstepPads();
+
+			this->netplay.AdvanceFrame();
+
+			//pads are only polled if there is an input object
+			if (!input)
+			{
+				static Input::Controllers noInput;
+				input = &noInput;
+			}
+
+			return true;
+		}
+
+		void Machine::SetLockstepPads() {
+			uint pads[4] = { 0 };
+			pads[this->lockstepLocalPad] |= this->netplay.GetLocalInput();
+			pads[this->lockstepRemotePad] |= this->netplay.GetRemoteInput();
+			cpu.SetLockstepPads(pads);
+		}
+
+		void Machine::RollbackLockstepFrames() {
+			const uint64_t rollbackFrame = this->netplay.GetRollbackFrame();
+			const uint64_t currentFrame = this->netplay.BeginRollback();
+
+			bool loaded;
+			try {
+				loaded = this->rollbackSnapshots.Load(*this, rollbackFrame);
+			}
+			catch (...) {
+				loaded = false;
+			}
+
+			if (!loaded)
+			{
+				//the ring holds more snapshots than the rollback window, so this should not happen
+				StopLockstep(RESULT_ERR_CORRUPT_FILE);
+				return;
+			}
+
+			//replayed frames are never presented, skip video & sound output
+			static Input::Controllers noInput;
+
+			while (this->netplay.GetFrame() < currentFrame)
+			{
+				this->rollbackSnapshots.Save(*this, this->netplay.GetFrame());
+
+				SetLockstepPads();
+
+				this->netplay.AdvanceFrame();
+
+				EmulateFrame(NULL, NULL, &noInput, true);
+			}
+		}
+
+		void Machine::SendLockstepChecksum() {
+			uint64_t frame;
+			if (!this->netplay.GetPendingChecksumFrame(frame))
+				return;
+
+			Remote::RemoteLockstepChecksum checksum;
+			checksum.frame = frame;
+
+			if (this->netplay.GetMaxRollbackFrames())
+			{
+				//state before this frame is final now but may have been executed already, use its snapshot
+				size_t size;
+				const byte* data = this->rollbackSnapshots.GetData(frame, size);
+				if (!data)
+				{
+					this->netplay.SkipChecksum();
+					return;
+				}
+
+				checksum.crc = Crc32::Compute(data, size);
+			}
+			else
+			{
+				checksum.crc = GetLockstepChecksum();
+			}
+
+			HQRemote::PlainEvent checksumEvent(Remote::REMOTE_LOCKSTEP_CHECKSUM);
+			memcpy(checksumEvent.event.customData, &checksum, sizeof checksum);
+			SendEventToRemote(checksumEvent);
+
+			if (this->netplay.AddLocalChecksum(checksum.frame, checksum.crc))
+				Api::Machine::eventCallback(Api::Machine::EVENT_REMOTE_DESYNC, (Result)checksum.frame);
+		}
+
 		void Machine::HandleCommonEvent(const HQRemote::Event& event) {
 			switch (event.type)
 			{
@@ -647,6 +1240,25 @@ namespace Nes
 				this->clientEngine->sendEvent(event);
 #endif
 
+				// tell host the frame compressors we can decode, it must be sent before frame format
+				// since switching compressor will reset the format. Older host will just ignore this
+				Remote::RemoteFrameCompressors frameCompressors;
+				frameCompressors.types = 1 << FRAME_COMPRESSOR_TYPE_ZLIB;
+#if REMOTE_USE_LZ4
+				frameCompressors.types |= 1 << FRAME_COMPRESSOR_TYPE_LZ4;
+#endif
+#if REMOTE_USE_ZSTD
+				frameCompressors.types |= 1 << FRAME_COMPRESSOR_TYPE_ZSTD;
+#endif
+				frameCompressors.dictionaryId = this->remoteFrameDictionaryId;
+
+				event.event.type = Remote::REMOTE_FRAME_COMPRESSORS;
+				memcpy(event.event.customData, &frameCompressors, sizeof frameCompressors);
+				this->clientEngine->sendEvent(event);
+
+				// tell host the latest frame format we can decode, older host will just ignore this
+				SendFrameFormatToHost();
+
 				event.event.type = Remote::REMOTE_MODE;
 				this->clientEngine->sendEvent(event);
 
@@ -789,6 +1401,17 @@ namespace Nes
 				}
 					break;
 #endif
+				case Remote::REMOTE_USE_FRAME_COMPRESSOR: {
+					// host switched its frame compressor
+					Remote::RemoteFrameCompressor compressor;
+					memcpy(&compressor, event.customData, sizeof compressor);
+
+					UseFrameDecompressorType(compressor.type);
+
+					// new compressor on host side starts with legacy format
+					SendFrameFormatToHost();
+				}
+					break;
 				case HQRemote::MESSAGE:
 				case HQRemote::MESSAGE_ACK:
 					HandleCommonEvent(event);
@@ -1049,7 +1672,9 @@ namespace Nes
 					// reset timer
 					this->lastRemoteDataRateUpdateTime = 0;
 
-					// reset to default zlib compressor
+					// reset to default zlib compressor until client tells us what it can decode
+					this->clientFrameCompressors = 0;
+					this->clientFrameDictionaryId = 0;
 					UseFrameCompressorType(FRAME_COMPRESSOR_TYPE_ZLIB);
 				}
 				else
@@ -1060,6 +1685,9 @@ namespace Nes
 			if (this->hostEngine->connected() == false)
 			{
 				this->clientState = 0;
+
+				if (netplay.IsActive())
+					StopLockstep(RESULT_ERR_CONNECTION);
 				if (clientInfo.size() != 0)
 					Api::Machine::eventCallback(Api::Machine::EVENT_CLIENT_DISCONNECTED, (Result)(intptr_t)(this->clientInfo.c_str()));
 				else
@@ -1223,6 +1851,29 @@ namespace Nes
 			case Remote::REMOTE_ENABLE_ADAPTIVE_DATA_RATE:
 				// deprecated. ignore
 
+				break;
+			case Remote::REMOTE_FRAME_COMPRESSORS:
+			{
+				Remote::RemoteFrameCompressors frameCompressors;
+				memcpy(&frameCompressors, event.customData, sizeof frameCompressors);
+
+				this->clientFrameCompressors = frameCompressors.types;
+				this->clientFrameDictionaryId = frameCompressors.dictionaryId;
+
+				SelectRemoteFrameCompressor();
+			}
+				break;
+			case Remote::REMOTE_LOCKSTEP_REQUEST:
+			{
+				Remote::RemoteLockstepRequest request;
+				memcpy(&request, event.customData, sizeof request);
+
+				StartLockstepAsHost(request.prgCrc);
+			}
+				break;
+			case Remote::REMOTE_LOCKSTEP_INPUT:
+			case Remote::REMOTE_LOCKSTEP_CHECKSUM:
+				OnLockstepEvent(event);
 				break;
 			default:
 				// cpu may receive reset input event, which can be sent before CLIENT_EXCHANGE_DATA_STATE state
@@ -1864,100 +2515,165 @@ namespace Nes
 			}
 			else if (!(state & Api::Machine::SOUND))
 			{
-				if (state & Api::Machine::CARTRIDGE)
-					static_cast<Cartridge*>(image)->BeginFrame( Api::Input(*this), input );
+				Input::Controllers* frameInput = input;
 
-				extPort->BeginFrame( input );
-				expPort->BeginFrame( input );
-
-				ppu.BeginFrame( tracker.IsFrameLocked() );
-
-				if (cheats)
-					cheats->BeginFrame( tracker.IsFrameLocked() );
-
-				//handle remote event
+				//handle remote event. It must be done before the frame starts since lockstep netplay can start here
+				bool stalled = false;
 				if (this->hostEngine != nullptr)
 				{
 					HandleRemoteEventsAsServer();
 				}
+				else if (this->clientEngine != nullptr)
+				{
+					stalled = !HandleLockstepEventsAsClient();
+				}
 
-				//CPU
+				//lockstep netplay: wait until both peers' input of this frame is known
+				if (stalled || (this->netplay.IsActive() && !BeginLockstepFrame(frameInput)))
 				{
+					//show the last frame again
+					if (video && !pipelined)
+						renderer.Blit(*video, ppu.GetScreen(), ppu.GetBurstPhase());
+
+					this->currentInputAudio = nullptr;
+					return;
+				}
+
+				EmulateFrame(video, sound, frameInput, !video && headless);
+			}
+			else
+			{
+				static_cast<Nsf*>(image)->BeginFrame();
+
+				cpu.ExecuteFrame( sound );
+				cpu.EndFrame();
+
+				image->VSync();
+			}
+
+			this->currentInputAudio = nullptr;//LHQ
+		}
+
+		bool Machine::IsNetworked() const
+		{
+			return (state & Api::Machine::REMOTE) || this->hostEngine || this->clientEngine || this->netplay.IsActive();
+		}
+
+		void Machine::BeginBlit(Video::Output* const video)
+		{
+			//the remote side captures the frame right after it's been blitted
+			pipelined = renderer.IsPipelined() && !IsNetworked();
+
+			if (pipelined && video)
+				renderer.BlitAsync(*video, ppu.GetScreen(), ppu.GetBurstPhase());
+		}
+
+		void Machine::EndBlit()
+		{
+			renderer.Sync();
+			pipelined = false;
+		}
+
+		bool Machine::NeedsPixels() const
+		{
+			//light guns sample the screen while the frame is running
+			for (uint i=0, n=extPort->NumPorts(); i < n; ++i)
+			{
+				if (extPort->GetDevice(i).GetType() == Api::Input::ZAPPER)
+					return true;
+			}
+
+			if (expPort->GetType() == Api::Input::BANDAIHYPERSHOT)
+				return true;
+
+			//output redirected, i.e. the rewinder is recording frames for reverse playback
+			return ppu.GetOutputPixels() != ppu.GetScreen().pixels;
+		}
+
+		void Machine::EmulateFrame
+		(
+			Video::Output* const video,
+			Sound::Output* const sound,
+			Input::Controllers* const input,
+			const bool discard
+		)
+		{
+			if (state & Api::Machine::CARTRIDGE)
+				static_cast<Cartridge*>(image)->BeginFrame( Api::Input(*this), input );
+
+			extPort->BeginFrame( input );
+			expPort->BeginFrame( input );
+
+			ppu.BeginFrame( tracker.IsFrameLocked(), discard && !NeedsPixels() );
+
+			if (cheats)
+				cheats->BeginFrame( tracker.IsFrameLocked() );
+
+			//CPU
+			{
 #if PROFILE_EXECUTION_TIME
-					HQRemote::ScopedTimeProfiler profiler("machine's cpu execution", avgCpuExecuteTime, cpuExecuteWindowTime);
+				HQRemote::ScopedTimeProfiler profiler("machine's cpu execution", avgCpuExecuteTime, cpuExecuteWindowTime);
 #endif
-					cpu.ExecuteFrame(sound);
-				}
+				cpu.ExecuteFrame(sound);
+			}
 
-				//PPU
-				{
+			//PPU
+			{
 #if PROFILE_EXECUTION_TIME
-					HQRemote::ScopedTimeProfiler profiler("machine's ppu endframe", avgPpuEndFrameTime, ppuEndFrameWindowTime);
+				HQRemote::ScopedTimeProfiler profiler("machine's ppu endframe", avgPpuEndFrameTime, ppuEndFrameWindowTime);
 #endif
-					ppu.EndFrame();
-				}
+				ppu.EndFrame();
+			}
 
-				//render
-				renderer.bgColor = ppu.output.bgColor;
+			//render, unless it's left to the next Execute() to do in the background
+			renderer.bgColor = ppu.output.bgColor;
 
-				if (video)
-				{
+			if (video && !pipelined)
+			{
 #if PROFILE_EXECUTION_TIME
-					HQRemote::ScopedTimeProfiler profiler("machine's video blitting", avgVideoBlitTime, videoBlitWindowTime);
+				HQRemote::ScopedTimeProfiler profiler("machine's video blitting", avgVideoBlitTime, videoBlitWindowTime);
 #endif
-					renderer.Blit(*video, ppu.GetScreen(), ppu.GetBurstPhase());
-				}
+				renderer.Blit(*video, ppu.GetScreen(), ppu.GetBurstPhase());
+			}
 
-				cpu.EndFrame();
+			cpu.EndFrame();
 
-				//LHQ
-				if (this->hostEngine)
-				{
-					// update frame compressor
-					this->remoteFrameCompressor->FrameStep(video);
+			//LHQ: no video & audio streaming in lockstep netplay
+			if (this->hostEngine && !this->netplay.IsActive())
+			{
+				// update frame compressor
+				this->remoteFrameCompressor->FrameStep(video);
 
-					//capture frame & audio
-					EnsureCorrectRemoteSoundSettings();
+				//capture frame & audio
+				EnsureCorrectRemoteSoundSettings();
 
-					//capture video frame
-					if (video)
-					{
+				//capture video frame
+				if (video)
+				{
 #if PROFILE_EXECUTION_TIME
-						HQRemote::ScopedTimeProfiler profiler("captureAndSendFrame", avgFrameCaptureTime, frameCaptureWindowTime);
+					HQRemote::ScopedTimeProfiler profiler("captureAndSendFrame", avgFrameCaptureTime, frameCaptureWindowTime);
 #endif
-						RateControlledCaptureAndSendFrame();
-					}
+					RateControlledCaptureAndSendFrame();
+				}
 
-					//capture audio
-					if (sound)
-					{
+				//capture audio
+				if (sound)
+				{
 #if PROFILE_EXECUTION_TIME
-						HQRemote::ScopedTimeProfiler profiler("captureAndSendAudio", avgAudioCaptureTime, audioCaptureWindowTime);
+					HQRemote::ScopedTimeProfiler profiler("captureAndSendAudio", avgAudioCaptureTime, audioCaptureWindowTime);
 #endif
-						this->hostEngine->captureAndSendAudio();
-					}
+					this->hostEngine->captureAndSendAudio();
 				}
-				//end LHQ
-
-				if (image)
-					image->VSync();
-
-				extPort->EndFrame();
-				expPort->EndFrame();
-
-				frame++;
 			}
-			else
-			{
-				static_cast<Nsf*>(image)->BeginFrame();
-
-				cpu.ExecuteFrame( sound );
-				cpu.EndFrame();
+			//end LHQ
 
+			if (image)
 				image->VSync();
-			}
 
-			this->currentInputAudio = nullptr;//LHQ
+			extPort->EndFrame();
+			expPort->EndFrame();
+
+			frame++;
 		}
 
 		NES_POKE_D(Machine,4016)
@@ -30,6 +30,8 @@
 #include "NstPpu.hpp"
 #include "NstTracker.hpp"
 #include "NstVideoRenderer.hpp"
+#include "NstNetplay.hpp"
+#include "NstSnapshotRing.hpp"
 
 #include <memory>
 #include <string>
@@ -126,6 +128,32 @@ namespace Nes
 			bool RemoteControllerEnabled(uint idx) const;
 			void EnableLowResRemoteControl(bool e);
 
+			//host's preferred frame compressor, used if client can decode it
+			void SetRemoteFrameCompressor(int type);
+			//zstd frame compressor's dictionary, must be identical on host & client side
+			void SetRemoteFrameDictionary(const void* data, size_t size);
+			Result TrainRemoteFrameDictionary(std::vector<unsigned char>& dictionary);
+
+			//input-only lockstep netplay.
+			//host side: accept clients' lockstep requests, local input is delayed by <inputDelay> frames.
+			//<maxRollbackFrames> > 0 enables rollback: remote input is predicted & mispredicted frames are re-simulated
+			void EnableRemoteLockstep(bool enable, uint inputDelay, uint maxRollbackFrames);
+			//client side: the same image as host's must be loaded & powered on
+			Result LoadRemoteLockstep(std::shared_ptr<HQRemote::IConnectionHandler> connHandler, const char* clientName = NULL);
+			Result LoadRemoteLockstep(const std::string& remoteIp, int remotePort, const char* clientName = NULL);
+			bool IsRemoteLockstepRunning() const { return netplay.IsActive(); }
+			//remote control or lockstep netplay, the frames executed are seen by the other side
+			bool IsNetworked() const;
+
+			//frames executed without video output skip pixel rendering, see Ppu::BeginFrame()
+			void EnableHeadless(bool enable) { headless = enable; }
+			bool IsHeadless() const { return headless; }
+
+			//pipelined blitting: the frame shown before an Execute() is filtered on the renderer's
+			//thread while that Execute() emulates, and is in <video> by the time it returns
+			void BeginBlit(Video::Output* video);
+			void EndBlit();
+
 			//<id> is used for ACK message later to acknowledge that the message is received by remote side.
 			//<message> must not have more than MAX_REMOTE_MESSAGE_SIZE bytes (excluding NULL character). Otherwise RESULT_ERR_BUFFER_TOO_BIG is retuned.
 			//This function can be used to send message between client & server
@@ -159,14 +187,35 @@ namespace Nes
 		private:
 			typedef void (Machine::*remote_audio_mix_handler)(unsigned char* output, const unsigned char* remoteAudioData, size_t size);
 
+			//execute one frame, video & sound output are skipped if NULL.
+			//<discard> frames are never looked at so the PPU doesn't render their pixels
+			void EmulateFrame(Video::Output*, Sound::Output*, Input::Controllers*, bool discard);
+			bool NeedsPixels() const;
+
 			void StopRemoteControl();
 			void UseFrameCompressorType(int type);
 			void UseFrameDecompressorType(int type);
+			void SelectRemoteFrameCompressor();
+			void SendFrameFormatToHost();
 			void HandleRemoteEventsAsClient(Video::Output* videoOutput, Sound::Output* soundOutput);
 			bool HandleGenericRemoteEventAsClient();
 			void HandleRemoteFrameEventAsClient(Video::Output* videoOutput);
 			void HandleRemoteAudioEventAsClient(Sound::Output* soundOutput);
 
+			bool HandleLockstepEventsAsClient();
+			bool HandleLockstepEventAsClient();
+			void StartLockstepAsHost(uint32_t prgCrc);
+			void StartLockstepAsClient(const unsigned char* data, size_t size);
+			void StopLockstep(Result reason);
+			bool BeginLockstepFrame(Input::Controllers*& input);
+			void SetLockstepPads();
+			void RollbackLockstepFrames();
+			void SendLockstepChecksum();
+			void OnLockstepEvent(const HQRemote::Event& event);
+			dword GetLockstepChecksum() const;
+			template <class EventType>
+			void SendEventToRemote(const EventType& event);
+
 			void HandleRemoteEventsAsServer();
 			bool HandleGenericRemoteEventAsServer();
 			void CalcFrameCaptureRate();
@@ -202,6 +251,8 @@ namespace Nes
 
 			uint state;
 			dword frame;
+			bool headless;
+			bool pipelined;
 
 			std::shared_ptr<HQRemote::Engine> hostEngine;
 			std::shared_ptr<HQRemote::Client> clientEngine;
@@ -217,6 +268,20 @@ namespace Nes
 			uint64_t lastSentInputTime;
 			uint lastSentInput;
 
+			int preferredFrameCompressorType;
+			uint32_t clientFrameCompressors;//bit mask of frame compressors client can decode
+			uint32_t clientFrameDictionaryId;
+			std::vector<unsigned char> remoteFrameDictionary;
+			uint32_t remoteFrameDictionaryId;//checksum of zstd dictionary, 0 if none
+
+			Netplay netplay;
+			bool lockstepAllowed;
+			uint lockstepInputDelay;
+			uint lockstepMaxRollbackFrames;
+			SnapshotRing rollbackSnapshots;
+			uint lockstepLocalPad;
+			uint lockstepRemotePad;
+
 			double renderedFramesSinceLastCapture = 0;
 			double renderToCaptureRatio = 1;
 
@@ -276,6 +276,11 @@ namespace Nes
 				return pages.mem[page];
 			}
 
+			const byte* const* Slot(uint page) const
+			{
+				return pages.mem + page;
+			}
+
 			void Poke(uint address,uint data)
 			{
 				const uint page = address >> MEM_PAGE_SHIFT;
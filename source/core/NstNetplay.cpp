@@ -0,0 +1,219 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "NstNetplay.hpp"
+
+#include <string.h>
+
+#define NO_ROLLBACK_FRAME 0xffffffffffffffffull
+
+namespace Nes {
+	namespace Core {
+		Netplay::Netplay()
+		{
+			Stop();
+		}
+
+		void Netplay::Start(uint inputDelay, uint maxRollbackFrames)
+		{
+			Stop();
+
+			if (inputDelay > MAX_INPUT_DELAY)
+				inputDelay = MAX_INPUT_DELAY;
+			if (maxRollbackFrames > MAX_ROLLBACK_FRAMES)
+				maxRollbackFrames = MAX_ROLLBACK_FRAMES;
+
+			m_inputDelay = inputDelay;
+			m_maxRollbackFrames = maxRollbackFrames;
+			m_active = true;
+
+			for (uint i = 0; i < inputDelay; ++i)
+			{
+				QueueLocalInput(0);
+				QueueRemoteInput(i, 0);
+			}
+		}
+
+		void Netplay::Stop()
+		{
+			memset(m_localInputs, 0, sizeof m_localInputs);
+			memset(m_remoteInputs, 0, sizeof m_remoteInputs);
+			memset(m_usedRemoteInputs, 0, sizeof m_usedRemoteInputs);
+			memset(m_checksums, 0, sizeof m_checksums);
+
+			m_frame = 0;
+			m_nextLocalInputFrame = 0;
+			m_confirmedFrame = 0;
+			m_rollbackFrame = NO_ROLLBACK_FRAME;
+			m_nextChecksumFrame = 0;
+			m_desyncFrame = 0;
+			m_lastConfirmedRemoteInput = 0;
+			m_inputDelay = 0;
+			m_maxRollbackFrames = 0;
+			m_active = false;
+			m_desynced = false;
+		}
+
+		const Netplay::InputSlot* Netplay::FindInput(const InputSlot* slots, uint64_t frame)
+		{
+			auto& slot = slots[frame % INPUT_QUEUE_SIZE];
+			return slot.valid && slot.frame == frame ? &slot : NULL;
+		}
+
+		uint64_t Netplay::QueueLocalInput(uint buttons)
+		{
+			auto frame = m_nextLocalInputFrame++;
+			auto& slot = m_localInputs[frame % INPUT_QUEUE_SIZE];
+
+			slot.frame = frame;
+			slot.buttons = buttons;
+			slot.valid = true;
+
+			return frame;
+		}
+
+		bool Netplay::QueueRemoteInput(uint64_t frame, uint buttons)
+		{
+			if (!m_active || frame < m_confirmedFrame || frame >= m_confirmedFrame + INPUT_QUEUE_SIZE)
+				return false;
+
+			auto& slot = m_remoteInputs[frame % INPUT_QUEUE_SIZE];
+
+			slot.frame = frame;
+			slot.buttons = buttons;
+			slot.valid = true;
+
+			//the frame was executed with a different prediction
+			if (frame < m_frame && frame < m_rollbackFrame)
+			{
+				auto used = FindInput(m_usedRemoteInputs, frame);
+				if (!used || used->buttons != buttons)
+					m_rollbackFrame = frame;
+			}
+
+			while (auto confirmed = FindInput(m_remoteInputs, m_confirmedFrame))
+			{
+				m_lastConfirmedRemoteInput = confirmed->buttons;
+				m_confirmedFrame++;
+			}
+
+			return true;
+		}
+
+		bool Netplay::IsFrameReady() const
+		{
+			if (!m_active || !FindInput(m_localInputs, m_frame))
+				return false;
+
+			return m_frame < m_confirmedFrame + m_maxRollbackFrames || FindInput(m_remoteInputs, m_frame);
+		}
+
+		uint Netplay::GetRemoteInput() const
+		{
+			auto input = FindInput(m_remoteInputs, m_frame);
+
+			return input ? input->buttons : m_lastConfirmedRemoteInput;
+		}
+
+		void Netplay::AdvanceFrame()
+		{
+			auto& used = m_usedRemoteInputs[m_frame % INPUT_QUEUE_SIZE];
+
+			used.frame = m_frame;
+			used.buttons = GetRemoteInput();
+			used.valid = true;
+
+			m_frame++;
+		}
+
+		uint64_t Netplay::BeginRollback()
+		{
+			auto frame = m_frame;
+
+			m_frame = m_rollbackFrame;
+			m_rollbackFrame = NO_ROLLBACK_FRAME;
+
+			return frame;
+		}
+
+		bool Netplay::GetPendingChecksumFrame(uint64_t& frame) const
+		{
+			if (!m_active || m_nextChecksumFrame > m_frame || m_nextChecksumFrame > m_confirmedFrame)
+				return false;
+
+			frame = m_nextChecksumFrame;
+
+			return true;
+		}
+
+		Netplay::ChecksumSlot& Netplay::GetChecksumSlot(uint64_t frame)
+		{
+			auto& slot = m_checksums[(frame / CHECKSUM_INTERVAL) % CHECKSUM_QUEUE_SIZE];
+			if (slot.frame != frame)
+			{
+				//recycle the slot of an old frame
+				slot.frame = frame;
+				slot.flags = 0;
+			}
+
+			return slot;
+		}
+
+		bool Netplay::CompareChecksums(ChecksumSlot& slot)
+		{
+			if (m_desynced || slot.flags != (ChecksumSlot::LOCAL | ChecksumSlot::REMOTE) || slot.local == slot.remote)
+				return false;
+
+			m_desynced = true;
+			m_desyncFrame = slot.frame;
+
+			return true;
+		}
+
+		bool Netplay::AddLocalChecksum(uint64_t frame, dword crc)
+		{
+			if (frame == m_nextChecksumFrame)
+				m_nextChecksumFrame += CHECKSUM_INTERVAL;
+
+			auto& slot = GetChecksumSlot(frame);
+			slot.local = crc;
+			slot.flags |= ChecksumSlot::LOCAL;
+
+			return CompareChecksums(slot);
+		}
+
+		bool Netplay::AddRemoteChecksum(uint64_t frame, dword crc)
+		{
+			if (!m_active)
+				return false;
+
+			auto& slot = GetChecksumSlot(frame);
+			slot.remote = crc;
+			slot.flags |= ChecksumSlot::REMOTE;
+
+			return CompareChecksums(slot);
+		}
+	}
+}
@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include "NstBase.hpp"
+
+#include <stdint.h>
+
+namespace Nes {
+	namespace Core {
+		//Input-only netplay. Both peers run the same image starting from the same state and only exchange
+		//their pads' input, local input is scheduled <inputDelay> frames ahead to hide the network latency.
+		//In lockstep mode a frame is executed once both peers' input for it is known. In rollback mode remote input is
+		//predicted to be the same as the last received one, the emulation runs up to <maxRollbackFrames> frames ahead of
+		//the received input, and the frames executed with mispredicted input are re-simulated once the real input arrives.
+		class Netplay {
+		public:
+			enum {
+				DEFAULT_INPUT_DELAY = 2,
+				MAX_INPUT_DELAY = 15,
+				MAX_ROLLBACK_FRAMES = 8,
+				INPUT_QUEUE_SIZE = 64,//must hold at least MAX_ROLLBACK_FRAMES + 2 * MAX_INPUT_DELAY + 1 frames
+				CHECKSUM_INTERVAL = 60,//number of frames between two state checksums
+				CHECKSUM_QUEUE_SIZE = 8
+			};
+
+			Netplay();
+
+			//start at frame 0, the first <inputDelay> frames use empty input on both sides.
+			//<maxRollbackFrames> = 0 means lockstep mode
+			void Start(uint inputDelay, uint maxRollbackFrames = 0);
+			void Stop();
+
+			bool IsActive() const { return m_active; }
+			uint64_t GetFrame() const { return m_frame; }
+			uint GetInputDelay() const { return m_inputDelay; }
+			uint GetMaxRollbackFrames() const { return m_maxRollbackFrames; }
+			//all remote input before this frame is known
+			uint64_t GetConfirmedFrame() const { return m_confirmedFrame; }
+
+			//true if local input should be queued for a new frame
+			bool NeedLocalInput() const { return m_active && m_nextLocalInputFrame <= m_frame + m_inputDelay; }
+			//returns the frame the input is scheduled for
+			uint64_t QueueLocalInput(uint buttons);
+			//returns false if <frame> is outside the queue's window
+			bool QueueRemoteInput(uint64_t frame, uint buttons);
+
+			//true if the current frame can be executed
+			bool IsFrameReady() const;
+			uint GetLocalInput() const { return m_localInputs[m_frame % INPUT_QUEUE_SIZE].buttons; }
+			//predicted input if it's not received yet
+			uint GetRemoteInput() const;
+			//remember the remote input used by the current frame & move to next frame
+			void AdvanceFrame();
+
+			//rollback: true if some frames were executed with mispredicted remote input
+			bool NeedRollback() const { return m_rollbackFrame < m_frame; }
+			//first frame to re-simulate, its snapshot must be restored
+			uint64_t GetRollbackFrame() const { return m_rollbackFrame; }
+			//move back to the rollback frame, returns the frame to re-simulate up to
+			uint64_t BeginRollback();
+
+			//returns true if the state before <frame> must be checksummed now. State before a frame is final once all remote
+			//input before it is known, so in rollback mode it may be an earlier frame than the current one
+			bool GetPendingChecksumFrame(uint64_t& frame) const;
+			//both return true if the checksums of <frame> are known on both sides and differ. Only the first desync is reported.
+			bool AddLocalChecksum(uint64_t frame, dword crc);
+			bool AddRemoteChecksum(uint64_t frame, dword crc);
+			//skip the pending checksum if the state is not available anymore
+			void SkipChecksum() { m_nextChecksumFrame += CHECKSUM_INTERVAL; }
+			bool IsDesynced() const { return m_desynced; }
+			uint64_t GetDesyncFrame() const { return m_desyncFrame; }
+		private:
+			struct InputSlot {
+				uint64_t frame;
+				uint buttons;
+				bool valid;
+			};
+
+			struct ChecksumSlot {
+				enum {
+					LOCAL = 0x1,
+					REMOTE = 0x2
+				};
+
+				uint64_t frame;
+				dword local;
+				dword remote;
+				uint flags;
+			};
+
+			static const InputSlot* FindInput(const InputSlot* slots, uint64_t frame);
+			ChecksumSlot& GetChecksumSlot(uint64_t frame);
+			bool CompareChecksums(ChecksumSlot& slot);
+
+			InputSlot m_localInputs[INPUT_QUEUE_SIZE];
+			InputSlot m_remoteInputs[INPUT_QUEUE_SIZE];
+			InputSlot m_usedRemoteInputs[INPUT_QUEUE_SIZE];//remote input the frames were executed with
+			ChecksumSlot m_checksums[CHECKSUM_QUEUE_SIZE];
+
+			uint64_t m_frame;
+			uint64_t m_nextLocalInputFrame;
+			uint64_t m_confirmedFrame;
+			uint64_t m_rollbackFrame;
+			uint64_t m_nextChecksumFrame;
+			uint64_t m_desyncFrame;
+			uint m_lastConfirmedRemoteInput;
+			uint m_inputDelay;
+			uint m_maxRollbackFrames;
+			bool m_active;
+			bool m_desynced;
+		};
+	}
+}
@@ -107,6 +107,8 @@ namespace Nes
 		model  (PPU_RP2C02),
 		rgbMap (NULL),
 		yuvMap (NULL),
+		lineRenderer (false),
+		headless (false),
 		colorUseCountShouldRestart(false),//LHQ
 		enableColorUseCount(false) //LHQ
 		{
@@ -487,7 +489,11 @@ namespace Nes
 			return cycles.one == PPU_RP2C02_CC ? clock / PPU_RP2C02_CC : (clock+PPU_RP2C07_CC-1) / PPU_RP2C07_CC;
 		}
 
-		void Ppu::BeginFrame(bool frameLock)
+		// In headless frames nothing gets written to the screen, the PPU still does
+		// all its fetches and keeps track of sprite zero hits and overflows so that
+		// the CPU and mappers can't tell the difference.
+
+		void Ppu::BeginFrame(bool frameLock,bool pixelless)
 		{
 			NST_ASSERT
 			(
@@ -499,6 +505,7 @@ namespace Nes
 
 			oam.limit = oam.buffer + ((oam.spriteLimit || frameLock) ? Oam::STD_LINE_SPRITES*4 : Oam::MAX_LINE_SPRITES*4);
 			output.target = output.pixels;
+			headless = pixelless;
 
 			Cycle frame;
 
@@ -1409,6 +1416,9 @@ namespace Nes
 				}
 			}
 
+			if (headless)
+				return;
+
 			Video::Screen::Pixel* const NST_RESTRICT target = output.target++;
 			*target = output.palette[pixel];
 
@@ -1420,6 +1430,10 @@ namespace Nes
 		NST_SINGLE_CALL void Ppu::RenderPixel255()
 		{
 			cycles.hClock = 256;
+
+			if (headless)
+				return;
+
 			uint pixel = tiles.pixels[(255 + scroll.xFine) & 15] & tiles.mask;
 
 			for (const Oam::Output* NST_RESTRICT sprite=oam.output, *const end=oam.visible; sprite != end; ++sprite)
@@ -1448,6 +1462,150 @@ namespace Nes
 				RenderPixelPostProcess((uint)(target - output.pixels), *target);
 		}
 
+		// Runs dots 0-255 of a visible line in one go. The fetches, address line
+		// updates and sprite evaluation steps are the same and happen in the same
+		// order and at the same hClock as in Run(), only the pixels are composed a
+		// tile at a time against a line buffer of the sprites loaded for this line.
+		// Run() only takes this path when nothing got in between the line start
+		// and its end, any register or mapper write mid-line makes it catch up to
+		// that point first and so falls back on the per-dot path.
+
+		void Ppu::RenderLine()
+		{
+			NST_ASSERT( cycles.hClock == 0 && cycles.count >= 256 && uint(scanline) < 240 );
+
+			enum
+			{
+				SP_COLOR  = 0x1F,
+				SP_BEHIND = 0x40,
+				SP_ZERO   = 0x80
+			};
+
+			byte sprites[256+8];
+			const bool visible = (oam.output != oam.visible) && (!headless || oam.output->zero);
+
+			if (visible)
+			{
+				std::memset( sprites, 0, sizeof(sprites) );
+
+				for (const Oam::Output* NST_RESTRICT sprite=oam.output, *const end=oam.visible; sprite != end; ++sprite)
+				{
+					byte* const NST_RESTRICT dst = sprites + sprite->x;
+					const uint flags = sprite->palette | (sprite->behind ? SP_BEHIND : 0) | (sprite->zero ? SP_ZERO : 0);
+
+					for (uint i=0; i < 8; ++i)
+					{
+						if (!dst[i] && sprite->pixels[i])
+							dst[i] = flags + sprite->pixels[i];
+					}
+				}
+			}
+
+			Video::Screen::Pixel* const NST_RESTRICT target = output.target;
+			uint bgMask = tiles.mask;
+			uint spMask = oam.mask;
+
+			do
+			{
+				LoadTiles();
+				EvaluateSpritesEven();
+				OpenName();
+				cycles.hClock++;
+
+				FetchName();
+				EvaluateSpritesOdd();
+				cycles.hClock++;
+
+				EvaluateSpritesEven();
+				OpenAttribute();
+				cycles.hClock++;
+
+				FetchAttribute();
+				EvaluateSpritesOdd();
+
+				if (cycles.hClock == 251)
+					scroll.ClockY();
+
+				scroll.ClockX();
+				cycles.hClock++;
+
+				EvaluateSpritesEven();
+				OpenPattern( io.pattern | 0x0 );
+				cycles.hClock++;
+
+				FetchBgPattern0();
+				EvaluateSpritesOdd();
+				cycles.hClock++;
+
+				EvaluateSpritesEven();
+				OpenPattern( io.pattern | 0x8 );
+				cycles.hClock++;
+
+				FetchBgPattern1();
+				EvaluateSpritesOdd();
+				cycles.hClock++;
+
+				if (headless)
+				{
+					if (visible && !(regs.status & Regs::STATUS_SP_ZERO_HIT))
+					{
+						for (uint clock=cycles.hClock-8, end=cycles.hClock; clock != end; ++clock)
+						{
+							if ((sprites[clock] & spMask & SP_ZERO) && (tiles.pixels[(clock + scroll.xFine) & 15] & bgMask) && clock != 255)
+								regs.status |= Regs::STATUS_SP_ZERO_HIT;
+						}
+					}
+				}
+				else for (uint clock=cycles.hClock-8, end=cycles.hClock; clock != end; ++clock)
+				{
+					uint pixel = tiles.pixels[(clock + scroll.xFine) & 15] & bgMask;
+
+					if (visible)
+					{
+						const uint sprite = sprites[clock] & spMask;
+
+						if (sprite)
+						{
+							if ((sprite & SP_ZERO) && pixel && clock != 255)
+								regs.status |= Regs::STATUS_SP_ZERO_HIT;
+
+							if (!(pixel && (sprite & SP_BEHIND)))
+								pixel = sprite & SP_COLOR;
+						}
+					}
+
+					target[clock] = output.palette[pixel];
+				}
+
+				bgMask = tiles.show[0];
+				spMask = oam.show[0];
+
+				if (cycles.hClock == 64)
+				{
+					NST_VERIFY( regs.oam == 0 );
+					oam.address = regs.oam & Oam::OFFSET_TO_0_1;
+					oam.phase = &Ppu::EvaluateSpritesPhase1;
+					oam.latch = 0xFF;
+				}
+			}
+			while (cycles.hClock != 256);
+
+			tiles.mask = bgMask;
+			oam.mask = spMask;
+
+			if (headless)
+				return;
+
+			output.target += 256;
+
+			//LHQ
+			if (this->enableColorUseCount)
+			{
+				for (uint i=0; i < 256; ++i)
+					RenderPixelPostProcess((uint)(target + i - output.pixels), target[i]);
+			}
+		}
+
 		NST_NO_INLINE void Ppu::Run()
 		{
 			NST_VERIFY( cycles.count != cycles.hClock );
@@ -1457,6 +1615,18 @@ namespace Nes
 				switch (cycles.hClock)
 				{
 					case 0:
+					HActiveLine:
+
+						if (lineRenderer && cycles.count >= 256)
+						{
+							RenderLine();
+
+							if (cycles.count <= 256)
+								break;
+
+							goto HActiveEnd;
+						}
+
 					case 8:
 					case 16:
 					case 24:
@@ -1808,6 +1978,7 @@ namespace Nes
 							break;
 
 					case 256:
+					HActiveEnd:
 
 						OpenName();
 						oam.latch = 0xFF;
@@ -2120,7 +2291,7 @@ namespace Nes
 
 							cycles.count -= line;
 
-							goto HActive;
+							goto HActiveLine;
 						}
 						else
 						{
@@ -2695,16 +2866,28 @@ namespace Nes
 						tiles.index = (hClock - 1) & 8;
 
 						byte* const NST_RESTRICT tile = tiles.pixels;
-						Video::Screen::Pixel* NST_RESTRICT target = output.target;
 
-						do
+						if (headless)
 						{
-							tile[i++ & 15] = 0;
-							*target++ = pixel;
+							do
+							{
+								tile[i++ & 15] = 0;
+							}
+							while (i != hClock);
 						}
-						while (i != hClock);
+						else
+						{
+							Video::Screen::Pixel* NST_RESTRICT target = output.target;
 
-						output.target = target;
+							do
+							{
+								tile[i++ & 15] = 0;
+								*target++ = pixel;
+							}
+							while (i != hClock);
+
+							output.target = target;
+						}
 
 						if (cycles.count <= 256)
 							break;
@@ -62,7 +62,7 @@ namespace Nes
 
 			void Reset(bool,bool);
 			void PowerOff();
-			void BeginFrame(bool);
+			void BeginFrame(bool,bool);
 			void EndFrame();
 
 			enum
@@ -225,6 +225,7 @@ namespace Nes
 			NST_SINGLE_CALL void LoadTiles();
 			NST_FORCE_INLINE void RenderPixel();
 			NST_SINGLE_CALL void RenderPixel255();
+			void RenderLine();
 			NST_FORCE_INLINE void RenderPixelPostProcess(uint index, Video::Screen::Pixel value);//LHQ
 			NST_NO_INLINE void Run();
 
@@ -437,6 +438,8 @@ namespace Nes
 			NameTable nameTable;
 			const TileLut tileLut;
 			Video::Screen screen;
+			bool lineRenderer;
+			bool headless;
 
 			static const byte yuvMaps[4][0x40];
 
@@ -557,6 +560,21 @@ namespace Nes
 				return oam.spriteLimit;
 			}
 
+			bool IsHeadless() const
+			{
+				return headless;
+			}
+
+			void EnableLineRenderer(bool enable)
+			{
+				lineRenderer = enable;
+			}
+
+			bool HasLineRenderer() const
+			{
+				return lineRenderer;
+			}
+
 			const ColorUseCountTable& GetColorUseCountTable() {
 				return colorUseCountTable;
 			}
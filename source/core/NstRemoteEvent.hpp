@@ -58,6 +58,32 @@ namespace Nes
 				REMOTE_BANDWITH_DETECT_DATA,
 				REMOTE_BANDWITH_DETECT_END,
 				REMOTE_BANDWITH_DETECT_RESULT,
+
+				REMOTE_FRAME_FORMAT, // client tells host the latest zlib frame format it can decode
+				REMOTE_KEYFRAME_ACK, // client received a keyframe, host can use it as reference from now on
+				REMOTE_FRAME_COMPRESSORS, // client tells host the indexed color frame compressors it can decode
+				REMOTE_USE_FRAME_COMPRESSOR, // host tells client the frame compressor it switched to
+
+				// input-only lockstep netplay
+				REMOTE_LOCKSTEP_REQUEST, // client asks host to run the same image locally instead of receiving video & audio
+				REMOTE_LOCKSTEP_START, // host accepted lockstep, carries RemoteLockstepStart followed by host's state
+				REMOTE_LOCKSTEP_END, // host refused or stopped lockstep
+				REMOTE_LOCKSTEP_INPUT, // frame numbered pad input
+				REMOTE_LOCKSTEP_CHECKSUM, // checksum of the state before executing a frame, used to detect desync
+
+				REMOTE_REFRESH_BAND_ACK, // client received a frame's intra refresh band, host can make it a part of the keyframe
+			};
+
+			/*----------zlib frame format versions ------------*/
+			enum RemoteFrameFormat {
+				REMOTE_FRAME_FORMAT_LEGACY = 0, // one half byte code per pixel
+				REMOTE_FRAME_FORMAT_DIRTY_TILES = 1, // inter frames skip 8x8 tiles unchanged since keyframe
+				REMOTE_FRAME_FORMAT_KEYFRAME_ACK = 2, // client acknowledges keyframes & caches several of them
+				REMOTE_FRAME_FORMAT_INTRA_REFRESH = 3, // keyframe can be built band by band from inter frames
+				REMOTE_FRAME_FORMAT_SLICES = 4, // frame is split into slices of tile rows compressed independently
+				REMOTE_FRAME_FORMAT_REFRESH_BAND_ACK = 5, // client acknowledges each intra refresh band it receives
+
+				REMOTE_FRAME_FORMAT_LATEST = REMOTE_FRAME_FORMAT_REFRESH_BAND_ACK,
 			};
 
 			struct RemoteInput {
@@ -68,6 +94,53 @@ namespace Nes
 			struct RemoteMode {
 				uint32_t mode;
 			};
+
+			struct RemoteFrameFormatVersion {
+				uint32_t version;
+			};
+
+			struct RemoteKeyframeAck {
+				uint64_t id;
+			};
+
+			struct RemoteRefreshBandAck {
+				uint64_t id;// frame carrying the band
+			};
+
+			struct RemoteFrameCompressors {
+				uint32_t types;// bit mask of (1 << FrameCompressorType)
+				uint32_t dictionaryId;// zstd dictionary's checksum, 0 if none
+			};
+
+			struct RemoteFrameCompressor {
+				uint32_t type;
+			};
+
+			struct RemoteLockstepRequest {
+				uint32_t prgCrc;// checksum of client's loaded image
+			};
+
+			struct RemoteLockstepStart {
+				uint32_t prgCrc;
+				uint32_t mode;// NTSC or PAL
+				uint32_t inputDelay;
+				uint32_t clientPad;// pad controlled by client, host controls pad 0
+				uint32_t maxRollbackFrames;// 0 = lockstep, otherwise remote input is predicted
+			};
+
+			struct RemoteLockstepEnd {
+				int32_t result;// reason, one of error codes in Result
+			};
+
+			struct RemoteLockstepInput {
+				uint64_t frame;
+				uint32_t buttons;
+			};
+
+			struct RemoteLockstepChecksum {
+				uint64_t frame;
+				uint32_t crc;
+			};
 		}
 	}
 }
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "NstMachine.hpp"
+#include "NstSnapshotRing.hpp"
+#include "NstState.hpp"
+
+namespace Nes {
+	namespace Core {
+		SnapshotRing::SnapshotRing(uint numSlots)
+			: m_slots(numSlots)
+		{
+			Clear();
+		}
+
+		void SnapshotRing::Clear()
+		{
+			for (auto& slot : m_slots)
+			{
+				slot.frame = 0;
+				slot.valid = false;
+				slot.size = 0;
+			}
+		}
+
+		void SnapshotRing::Save(const Machine& machine, uint64_t frame)
+		{
+			auto& slot = m_slots[frame % m_slots.size()];
+			slot.valid = false;
+
+			for (;;)
+			{
+				if (slot.data.size())
+				{
+					try {
+						State::Saver saver(slot.data.data(), (dword)slot.data.size(), false);
+						machine.SaveState(saver);
+
+						slot.frame = frame;
+						slot.size = saver.MemorySize();
+						slot.valid = true;
+
+						return;
+					}
+					catch (Result result) {
+						//only a too small buffer is worth growing
+						if (result != RESULT_ERR_BUFFER_TOO_SMALL)
+							throw;
+					}
+				}
+
+				//only happens for the first snapshots
+				slot.data.resize(slot.data.size() ? slot.data.size() * 2 : 64 * 1024);
+			}
+		}
+
+		const SnapshotRing::Slot* SnapshotRing::GetSlot(uint64_t frame) const
+		{
+			auto& slot = m_slots[frame % m_slots.size()];
+			if (!slot.valid || slot.frame != frame)
+				return NULL;
+
+			return &slot;
+		}
+
+		bool SnapshotRing::Load(Machine& machine, uint64_t frame)
+		{
+			auto slot = GetSlot(frame);
+			if (!slot)
+				return false;
+
+			State::Loader loader(slot->data.data(), (dword)slot->size, false);
+			return machine.LoadState(loader, false);
+		}
+
+		const byte* SnapshotRing::GetData(uint64_t frame, size_t& size) const
+		{
+			auto slot = GetSlot(frame);
+			if (!slot)
+				return NULL;
+
+			size = slot->size;
+			return slot->data.data();
+		}
+	}
+}
@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include "NstBase.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+namespace Nes {
+	namespace Core {
+		class Machine;
+
+		//Ring of uncompressed in-memory save states, used to roll the emulation back a few frames.
+		//Slots' buffers are reused, so once they have grown to the state's size, saving & loading don't allocate memory.
+		class SnapshotRing {
+		public:
+			explicit SnapshotRing(uint numSlots);
+
+			uint NumSlots() const { return (uint)m_slots.size(); }
+			void Clear();
+
+			//save <machine>'s current state as the snapshot taken before executing <frame>
+			void Save(const Machine& machine, uint64_t frame);
+			//returns false if <frame>'s snapshot has been overwritten
+			bool Load(Machine& machine, uint64_t frame);
+			//returns NULL if <frame>'s snapshot has been overwritten
+			const byte* GetData(uint64_t frame, size_t& size) const;
+		private:
+			struct Slot {
+				uint64_t frame;
+				bool valid;
+				size_t size;
+				std::vector<byte> data;
+			};
+
+			const Slot* GetSlot(uint64_t frame) const;
+
+			std::vector<Slot> m_slots;
+		};
+	}
+}
@@ -22,6 +22,7 @@
 //
 ////////////////////////////////////////////////////////////////////////////////////////
 
+#include <cmath>
 #include <algorithm>
 #include "NstCpu.hpp"
 #include "NstSoundRenderer.hpp"
@@ -58,6 +59,64 @@ namespace Nes
 					std::fill( output, output+SIZE, iword(0) );
 			}
 
+			Blip::Blip()
+			: deltas(new idword [SIZE+WIDTH]), rate(1)
+			{
+				// windowed sinc steps cut off slightly below nyquist, one set of
+				// taps per sub-sample phase, each summing up to unity
+
+				const double pi = 3.141592653589793;
+				const double cutoff = 0.45;
+
+				for (uint phase=0; phase < PHASES; ++phase)
+				{
+					double taps[WIDTH];
+					double sum = 0;
+
+					for (uint i=0; i < WIDTH; ++i)
+					{
+						const double x = double(i) - (WIDTH/2 - 1) - double(phase) / PHASES;
+
+						taps[i] = (x ? std::sin( 2 * pi * cutoff * x ) / (pi * x) : 2 * cutoff) *
+						(
+							0.42 +
+							0.50 * std::cos( pi * x / (WIDTH/2) ) +
+							0.08 * std::cos( 2 * pi * x / (WIDTH/2) )
+						);
+
+						sum += taps[i];
+					}
+
+					idword total = 0;
+
+					for (uint i=0; i < WIDTH; ++i)
+						total += kernel[phase][i] = idword(std::floor( taps[i] * (1UL << KERNEL_BITS) / sum + 0.5 ));
+
+					kernel[phase][WIDTH/2 - 1 + (phase >= PHASES/2)] += idword(1UL << KERNEL_BITS) - total;
+				}
+
+				Reset();
+			}
+
+			Blip::~Blip()
+			{
+				delete [] deltas;
+			}
+
+			void Blip::Reset()
+			{
+				accumulator = 0;
+				length = 0;
+
+				std::fill( deltas, deltas+SIZE+WIDTH, idword(0) );
+			}
+
+			void Blip::SetRate(dword r)
+			{
+				NST_ASSERT( r && r <= 0xFFFFFFFF / SIZE );
+				rate = r;
+			}
+
 			#ifdef NST_MSVC_OPTIMIZE
 			#pragma optimize("", on)
 			#endif
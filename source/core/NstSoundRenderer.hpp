@@ -106,6 +106,7 @@ namespace Nes
 			public:
 
 				inline void operator << (const Sample);
+				inline uint Length() const;
 
 				History history;
 			};
@@ -157,6 +158,59 @@ namespace Nes
 				inline void operator << (Sample);
 				NST_FORCE_INLINE bool operator << (Block&);
 			};
+
+			class Blip
+			{
+			public:
+
+				Blip();
+				~Blip();
+
+				enum
+				{
+					SIZE = 0x1000
+				};
+
+				void Reset();
+				void SetRate(dword);
+				void Flush(Buffer&);
+
+				inline void AddDelta(dword,idword);
+				inline void Advance(uint);
+
+			private:
+
+				enum
+				{
+					WIDTH       = 16,
+					PHASE_BITS  = 5,
+					PHASES      = 1U << PHASE_BITS,
+					KERNEL_BITS = 13
+				};
+
+				idword* const NST_RESTRICT deltas;
+				idword accumulator;
+				dword rate;
+				uint length;
+				idword kernel[PHASES][WIDTH];
+
+			public:
+
+				uint Length() const
+				{
+					return length;
+				}
+
+				dword Rate() const
+				{
+					return rate;
+				}
+
+				dword Clock() const
+				{
+					return length * rate;
+				}
+			};
 		}
 	}
 }
@@ -83,6 +83,11 @@ namespace Nes
 				output[p] = sample;
 			}
 
+			inline uint Buffer::Length() const
+			{
+				return (dword(pos) + SIZE - start) & MASK;
+			}
+
 			inline Buffer::Renderer<iword,0U>::Renderer(void* samples,uint length,const History&)
 			: BaseRenderer<iword>(samples,length) {}
 
@@ -180,6 +185,47 @@ namespace Nes
 
 				return dst != end;
 			}
+
+			inline void Blip::AddDelta(const dword clock,const idword delta)
+			{
+				NST_ASSERT( clock / rate < SIZE );
+
+				const dword pos = clock / rate;
+				const idword* const NST_RESTRICT taps = kernel[(clock - pos * rate) * PHASES / rate];
+				idword* const NST_RESTRICT dst = deltas + pos;
+
+				for (uint i=0; i < WIDTH; ++i)
+					dst[i] += taps[i] * delta;
+			}
+
+			inline void Blip::Advance(const uint count)
+			{
+				NST_ASSERT( length + count <= SIZE );
+				length += count;
+			}
+
+			void Blip::Flush(Buffer& output)
+			{
+				idword sum = accumulator;
+
+				for (uint i=0; i < length; ++i)
+				{
+					sum += deltas[i];
+					const idword sample = signed_shr( sum, KERNEL_BITS );
+
+					// leaky integration, doubles as the DC blocker
+
+					sum -= sample;
+					output << Clamp<-32767,32767>( sample );
+				}
+
+				accumulator = sum;
+
+				std::memmove( deltas, deltas+length, sizeof(idword) * WIDTH );
+				std::fill( deltas+WIDTH, deltas+WIDTH+length, idword(0) );
+
+				length = 0;
+			}
 		}
 	}
 }
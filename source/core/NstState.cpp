@@ -42,21 +42,23 @@ namespace Nes
 			#endif
 
 			Saver::Saver(StdStream p,bool c,bool i,dword append)
-			: stream(p), chunks(CHUNK_RESERVE), useCompression(c), internal(i)
+			: stream(p), useCompression(c), internal(i)
 			{
-				NST_COMPILE_ASSERT( CHUNK_RESERVE >= 2 );
-
-				chunks.SetTo(1);
-				chunks.Front() = 0;
+				chunks.Append( 0 );
 
 				if (append)
 				{
-					chunks.SetTo(2);
-					chunks[1] = append;
+					chunks.Append( append );
 					stream.Seek( 4 + 4 + append );
 				}
 			}
 
+			Saver::Saver(byte* data,dword capacity,bool i)
+			: stream(data,capacity), useCompression(false), internal(i)
+			{
+				chunks.Append( 0 );
+			}
+
 			Saver::~Saver()
 			{
 				NST_VERIFY( chunks.Size() == 1 );
@@ -153,9 +155,13 @@ namespace Nes
 			#endif
 
 			Loader::Loader(StdStream p,bool c)
-			: stream(p), chunks(CHUNK_RESERVE), checkCrc(c)
+			: stream(p), checkCrc(c)
+			{
+			}
+
+			Loader::Loader(const byte* data,dword size,bool c)
+			: stream(data,size), checkCrc(c)
 			{
-				chunks.SetTo(0);
 			}
 
 			Loader::~Loader()
@@ -41,11 +41,59 @@ namespace Nes
 	{
 		namespace State
 		{
+			class Chunks
+			{
+				enum
+				{
+					MAX_DEPTH = 16
+				};
+
+				dword sizes[MAX_DEPTH];
+				uint depth;
+
+			public:
+
+				Chunks()
+				: depth(0) {}
+
+				void Append(dword size)
+				{
+					if (depth == MAX_DEPTH)
+						throw RESULT_ERR_CORRUPT_FILE;
+
+					sizes[depth++] = size;
+				}
+
+				dword Pop()
+				{
+					NST_ASSERT( depth );
+					return sizes[--depth];
+				}
+
+				dword& Back()
+				{
+					NST_ASSERT( depth );
+					return sizes[depth-1];
+				}
+
+				dword Back() const
+				{
+					NST_ASSERT( depth );
+					return sizes[depth-1];
+				}
+
+				uint Size() const
+				{
+					return depth;
+				}
+			};
+
 			class Saver
 			{
 			public:
 
 				Saver(StdStream,bool,bool,dword=0);
+				Saver(byte*,dword,bool);
 				~Saver();
 
 				Saver& Begin(dword);
@@ -57,18 +105,18 @@ namespace Nes
 				Saver& Compress(const byte*,dword);
 				Saver& End();
 
+				dword MemorySize() const
+				{
+					return stream.MemorySize();
+				}
+
 			protected:
 
 				Stream::Out stream;
 
 			private:
 
-				enum
-				{
-					CHUNK_RESERVE = 8
-				};
-
-				Vector<dword> chunks;
+				Chunks chunks;
 				const bool useCompression;
 				const bool internal;
 
@@ -99,6 +147,7 @@ namespace Nes
 			public:
 
 				Loader(StdStream,bool);
+				Loader(const byte*,dword,bool);
 				~Loader();
 
 				dword Begin();
@@ -148,12 +197,7 @@ namespace Nes
 
 				void CheckRead(dword);
 
-				enum
-				{
-					CHUNK_RESERVE = 8
-				};
-
-				Vector<dword> chunks;
+				Chunks chunks;
 				const bool checkCrc;
 
 			public:
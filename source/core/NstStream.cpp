@@ -22,6 +22,7 @@
 //
 ////////////////////////////////////////////////////////////////////////////////////////
 
+#include <cstring>
 #include <iostream>
 #include "NstVector.hpp"
 #include "NstStream.hpp"
@@ -34,6 +35,9 @@ namespace Nes
 		{
 			void In::Clear()
 			{
+				if (mem)
+					return;
+
 				std::istream& ref = *static_cast<std::istream*>(stream);
 
 				if (!ref.bad())
@@ -42,6 +46,16 @@ namespace Nes
 
 			void In::SafeRead(byte* data,dword size)
 			{
+				if (mem)
+				{
+					if (size > memSize - memPos)
+						size = memSize - memPos;
+
+					std::memcpy( data, mem + memPos, size );
+					memPos += size;
+					return;
+				}
+
 				static_cast<std::istream*>(stream)->read( reinterpret_cast<char*>(data), size );
 			}
 
@@ -49,6 +63,16 @@ namespace Nes
 			{
 				NST_ASSERT( data && size );
 
+				if (mem)
+				{
+					if (size > memSize - memPos)
+						throw RESULT_ERR_CORRUPT_FILE;
+
+					std::memcpy( data, mem + memPos, size );
+					memPos += size;
+					return;
+				}
+
 				SafeRead( data, size );
 
 				if (!*static_cast<std::istream*>(stream))
@@ -90,6 +114,9 @@ namespace Nes
 
 			uint In::SafeRead8()
 			{
+				if (mem)
+					return memPos < memSize ? mem[memPos++] : ~0U;
+
 				byte data;
 				SafeRead( &data, 1 );
 				return *static_cast<std::istream*>(stream) ? data : ~0U;
@@ -101,6 +128,15 @@ namespace Nes
 
 			void In::Seek(idword distance)
 			{
+				if (mem)
+				{
+					if (distance < 0 ? dword(-distance) > memPos : dword(distance) > memSize - memPos)
+						throw RESULT_ERR_CORRUPT_FILE;
+
+					memPos += distance;
+					return;
+				}
+
 				Clear();
 
 				if (!static_cast<std::istream*>(stream)->seekg( distance, std::ios::cur ))
@@ -109,6 +145,9 @@ namespace Nes
 
 			ulong In::Length()
 			{
+				if (mem)
+					return memSize - memPos;
+
 				Clear();
 
 				std::istream& ref = *static_cast<std::istream*>(stream);
@@ -281,6 +320,9 @@ namespace Nes
 
 			bool In::Eof()
 			{
+				if (mem)
+					return memPos == memSize;
+
 				std::istream& ref = *static_cast<std::istream*>(stream);
 				return ref.eof() || (ref.peek(), ref.eof());
 			}
@@ -289,6 +331,22 @@ namespace Nes
 			{
 				NST_VERIFY( data && size );
 
+				if (memory)
+				{
+					if (size > memCapacity - memPos)
+						throw RESULT_ERR_BUFFER_TOO_SMALL;
+
+					if (mem)
+						std::memcpy( mem + memPos, data, size );
+
+					memPos += size;
+
+					if (memSize < memPos)
+						memSize = memPos;
+
+					return;
+				}
+
 				if (!static_cast<std::ostream*>(stream)->write( reinterpret_cast<const char*>(data), size ))
 					throw RESULT_ERR_CORRUPT_FILE;
 			}
@@ -352,6 +410,9 @@ namespace Nes
 
 			void Out::Clear()
 			{
+				if (memory)
+					return;
+
 				std::ostream& ref = *static_cast<std::ostream*>(stream);
 
 				if (!ref.bad())
@@ -360,6 +421,19 @@ namespace Nes
 
 			void Out::Seek(idword distance)
 			{
+				if (memory)
+				{
+					if (distance < 0 ? dword(-distance) > memPos : dword(distance) > memCapacity - memPos)
+						throw RESULT_ERR_BUFFER_TOO_SMALL;
+
+					memPos += distance;
+
+					if (memSize < memPos)
+						memSize = memPos;
+
+					return;
+				}
+
 				Clear();
 
 				if (!static_cast<std::ostream*>(stream)->seekp( distance, std::ios::cur ))
@@ -368,6 +442,13 @@ namespace Nes
 
 			bool Out::SeekEnd()
 			{
+				if (memory)
+				{
+					const bool advanced = (memPos != memSize);
+					memPos = memSize;
+					return advanced;
+				}
+
 				Clear();
 
 				std::ostream& ref = *static_cast<std::ostream*>(stream);
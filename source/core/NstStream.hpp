@@ -48,17 +48,28 @@ namespace Nes
 			{
 				StdStream const stream;
 
+				// memory block used instead of stream
+				const byte* const mem;
+				const dword memSize;
+				dword memPos;
+
 				void SafeRead(byte*,dword);
 				void Clear();
 
 			public:
 
 				explicit In(StdStream s)
-				: stream(s)
+				: stream(s), mem(NULL), memSize(0), memPos(0)
 				{
 					NST_ASSERT( stream );
 				}
 
+				In(const byte* data,dword size)
+				: stream(NULL), mem(data), memSize(size), memPos(0)
+				{
+					NST_ASSERT( data );
+				}
+
 				static dword AsciiToC(char* NST_RESTRICT,const byte* NST_RESTRICT,dword);
 
 				void  Read(byte*,dword);
@@ -99,16 +110,29 @@ namespace Nes
 			{
 				StdStream const stream;
 
+				// memory block used instead of stream, NULL data only counts the written bytes,
+				// writing past its capacity throws RESULT_ERR_BUFFER_TOO_SMALL
+				byte* const mem;
+				const dword memCapacity;
+				dword memPos;
+				dword memSize;
+				const bool memory;
+
 				void Clear();
 
 			public:
 
 				explicit Out(StdStream s)
-				: stream(s)
+				: stream(s), mem(NULL), memCapacity(0), memPos(0), memSize(0), memory(false)
 				{
 					NST_ASSERT( stream );
 				}
 
+				Out(byte* data,dword capacity)
+				: stream(NULL), mem(data), memCapacity(data ? capacity : ~dword(0)), memPos(0), memSize(0), memory(true)
+				{
+				}
+
 				void Write(const byte*,dword);
 				void Write8(uint);
 				void Write16(uint);
@@ -117,6 +141,12 @@ namespace Nes
 				void Seek(idword);
 				bool SeekEnd();
 
+				dword MemorySize() const
+				{
+					NST_ASSERT( memory );
+					return memSize;
+				}
+
 				template<dword N>
 				void Write(const byte (&data)[N])
 				{
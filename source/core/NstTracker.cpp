@@ -27,6 +27,9 @@
 #include "NstMachine.hpp"
 #include "NstTrackerMovie.hpp"
 #include "NstTrackerRewinder.hpp"
+#include "NstTrackerDeltaRewinder.hpp"
+#include "NstTrackerRunAhead.hpp"
+#include "NstTrackerTurbo.hpp"
 #include "NstImage.hpp"
 #include "api/NstApiMachine.hpp"
 
@@ -42,14 +45,21 @@ namespace Nes
 		:
 		frame           (0),
 		rewinderSound   (false),
+		rewinderBudget  (0),
 		rewinderEnabled (NULL),
 		rewinder        (NULL),
+		deltaRewinder   (NULL),
+		runAhead        (NULL),
+		turbo           (NULL),
 		movie           (NULL)
 		{}
 
 		Tracker::~Tracker()
 		{
 			delete rewinder;
+			delete deltaRewinder;
+			delete runAhead;
+			delete turbo;
 			delete movie;
 		}
 
@@ -59,6 +69,8 @@ namespace Nes
 
 			if (rewinder)
 				rewinder->Unload();
+			else if (deltaRewinder)
+				deltaRewinder->Unload();
 			else
 				StopMovie();
 		}
@@ -71,6 +83,10 @@ namespace Nes
 			{
 				rewinder->Reset();
 			}
+			else if (deltaRewinder)
+			{
+				deltaRewinder->Reset();
+			}
 			else if (movie)
 			{
 				movie->Reset();
@@ -88,6 +104,10 @@ namespace Nes
 			{
 				rewinder->Reset();
 			}
+			else if (deltaRewinder)
+			{
+				deltaRewinder->Reset();
+			}
 			else if (movie && !excludeFrame)
 			{
 				movie->Resync();
@@ -121,17 +141,119 @@ namespace Nes
 
 			if (rewinder)
 				rewinder->EnableSound( enable );
+			else if (deltaRewinder)
+				deltaRewinder->EnableSound( enable );
+		}
+
+		void Tracker::SetRewinderBudget(dword budget)
+		{
+			if (rewinderBudget == budget)
+				return;
+
+			UpdateRewinderState( false );
+			rewinderBudget = budget;
+			UpdateRewinderState( true );
+		}
+
+		ulong Tracker::GetRewinderMemoryUsage() const
+		{
+			return deltaRewinder ? deltaRewinder->MemoryUsage() : 0;
 		}
 
 		void Tracker::ResetRewinder() const
 		{
 			if (rewinder)
 				rewinder->Reset();
+			else if (deltaRewinder)
+				deltaRewinder->Reset();
+		}
+
+		Result Tracker::SetRunAhead(Machine* const emulator,const uint frames)
+		{
+			if (frames > RunAhead::MAX_FRAMES)
+				return RESULT_ERR_INVALID_PARAM;
+
+			if (!frames || !emulator)
+			{
+				if (!runAhead)
+					return RESULT_NOP;
+
+				delete runAhead;
+				runAhead = NULL;
+			}
+			else if (!runAhead)
+			{
+				runAhead = new RunAhead
+				(
+					*emulator,
+					&Machine::Execute,
+					&Machine::LoadState,
+					&Machine::SaveState,
+					frames
+				);
+			}
+			else
+			{
+				if (runAhead->NumFrames() == frames)
+					return RESULT_NOP;
+
+				runAhead->SetFrames( frames );
+			}
+
+			return RESULT_OK;
+		}
+
+		Result Tracker::SetTurbo(const uint frames)
+		{
+			if (frames > Turbo::MAX_FRAMES)
+				return RESULT_ERR_INVALID_PARAM;
+
+			if (frames <= 1)
+			{
+				if (!turbo)
+					return RESULT_NOP;
+
+				delete turbo;
+				turbo = NULL;
+			}
+			else if (!turbo)
+			{
+				turbo = new Turbo( frames );
+			}
+			else
+			{
+				if (turbo->NumFrames() == frames)
+					return RESULT_NOP;
+
+				turbo->SetFrames( frames );
+			}
+
+			return RESULT_OK;
+		}
+
+		uint Tracker::GetTurbo() const
+		{
+			return turbo ? turbo->NumFrames() : 1;
 		}
 
 		void Tracker::UpdateRewinderState(bool enable)
 		{
-			if (enable && rewinderEnabled && !movie)
+			if (enable && rewinderEnabled && !movie && rewinderBudget)
+			{
+				if (!deltaRewinder)
+				{
+					deltaRewinder = new DeltaRewinder
+					(
+						*rewinderEnabled,
+						&Machine::Execute,
+						&Machine::LoadState,
+						&Machine::SaveState,
+						rewinderBudget,
+						rewinderSound
+					);
+				}
+			}
+			else if (enable && rewinderEnabled && !movie)
 			{
 				if (!rewinder)
 				{
@@ -152,6 +274,9 @@ namespace Nes
 			{
 				delete rewinder;
 				rewinder = NULL;
+
+				delete deltaRewinder;
+				deltaRewinder = NULL;
 			}
 		}
 
@@ -265,17 +390,17 @@ namespace Nes
 
 		Result Tracker::StartRewinding() const
 		{
-			return rewinder ? rewinder->Start() : RESULT_ERR_NOT_READY;
+			return rewinder ? rewinder->Start() : deltaRewinder ? deltaRewinder->Start() : RESULT_ERR_NOT_READY;
 		}
 
 		Result Tracker::StopRewinding() const
 		{
-			return rewinder ? rewinder->Stop() : RESULT_NOP;
+			return rewinder ? rewinder->Stop() : deltaRewinder ? deltaRewinder->Stop() : RESULT_NOP;
 		}
 
 		bool Tracker::IsRewinding() const
 		{
-			return rewinder && rewinder->IsRewinding();
+			return (rewinder && rewinder->IsRewinding()) || (deltaRewinder && deltaRewinder->IsRewinding());
 		}
 
 		bool Tracker::IsMoviePlaying() const
@@ -298,6 +423,24 @@ namespace Nes
 			return IsRewinding() || movie;
 		}
 
+		class Tracker::Pipeline
+		{
+			Machine& machine;
+
+		public:
+
+			Pipeline(Machine& m,Video::Output* video)
+			: machine(m)
+			{
+				machine.BeginBlit( video );
+			}
+
+			~Pipeline()
+			{
+				machine.EndBlit();
+			}
+		};
+
 		Result Tracker::Execute
 		(
 			Machine& machine,
@@ -309,31 +452,17 @@ namespace Nes
 		{
 			if (machine.Is(Api::Machine::ON))
 			{
-				++frame;
-
 				try
 				{
-					if (machine.Is(Api::Machine::GAME))
-					{
-						if (rewinder)
-						{
-							rewinder->Execute( video, sound, input, inputSound);
-							return RESULT_OK;
-						}
-						else if (movie)
-						{
-							if (!movie->Execute())
-							{
-								StopMovie();
-							}
-							else if (movie->IsPlaying())
-							{
-								input = NULL;
-							}
-						}
-					}
+					const Pipeline pipeline( machine, video );
+
+					// fast-forwarding a networked session would leave the other side behind
+
+					if (turbo && machine.Is(Api::Machine::GAME) && !machine.IsNetworked())
+						turbo->Execute( *this, machine, video, sound, input, inputSound );
+					else
+						ExecuteFrame( machine, video, sound, input, inputSound );
 
-					machine.Execute( video, sound, input, inputSound );
 					return RESULT_OK;
 				}
 				catch (Result result)
@@ -354,5 +483,69 @@ namespace Nes
 				return RESULT_ERR_NOT_READY;
 			}
 		}
+
+		void Tracker::ExecuteFrame
+		(
+			Machine& machine,
+			Video::Output* const video,
+			Sound::Output* const sound,
+			Input::Controllers* input,
+			Sound::Input* inputSound
+		)
+		{
+			if (runAhead)
+			{
+				// the real frame still goes through the rewinder, only rewinding stops run-ahead
+
+				if (machine.Is(Api::Machine::GAME) && !movie && !IsRewinding())
+				{
+					runAhead->Execute( *this, video, sound, input, inputSound );
+					return;
+				}
+
+				runAhead->Skip();
+			}
+
+			EmulateFrame( machine, video, sound, input, inputSound );
+		}
+
+		void Tracker::EmulateFrame
+		(
+			Machine& machine,
+			Video::Output* const video,
+			Sound::Output* const sound,
+			Input::Controllers* input,
+			Sound::Input* inputSound
+		)
+		{
+			++frame;
+
+			if (machine.Is(Api::Machine::GAME))
+			{
+				if (rewinder)
+				{
+					rewinder->Execute( video, sound, input, inputSound);
+					return;
+				}
+				else if (deltaRewinder)
+				{
+					deltaRewinder->Execute( video, sound, input, inputSound );
+					return;
+				}
+				else if (movie)
+				{
+					if (!movie->Execute())
+					{
+						StopMovie();
+					}
+					else if (movie->IsPlaying())
+					{
+						input = NULL;
+					}
+				}
+			}
+
+			machine.Execute( video, sound, input, inputSound );
+		}
 	}
 }
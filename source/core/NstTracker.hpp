@@ -59,6 +59,9 @@ namespace Nes
 			Tracker();
 			~Tracker();
 
+			class RunAhead;
+			class Turbo;
+
 			void   Reset();
 			void   PowerOff();
 			Result Execute(Machine&,Video::Output*,Sound::Output*, Input::Controllers*, Sound::Input*);
@@ -70,11 +73,17 @@ namespace Nes
 
 			Result EnableRewinder(Machine*);
 			void   EnableRewinderSound(bool);
+			void   SetRewinderBudget(dword);
+			ulong  GetRewinderMemoryUsage() const;
 			void   ResetRewinder() const;
 			Result StartRewinding() const;
 			Result StopRewinding() const;
 			bool   IsRewinding() const;
 
+			Result SetRunAhead(Machine*,uint);
+			Result SetTurbo(uint);
+			uint   GetTurbo() const;
+
 			Result PlayMovie(Machine&,std::istream&);
 			Result RecordMovie(Machine&,std::iostream&,bool);
 			void   StopMovie();
@@ -84,14 +93,22 @@ namespace Nes
 		private:
 
 			void UpdateRewinderState(bool);
+			void ExecuteFrame(Machine&,Video::Output*,Sound::Output*,Input::Controllers*,Sound::Input*);
+			void EmulateFrame(Machine&,Video::Output*,Sound::Output*,Input::Controllers*,Sound::Input*);
 
 			class Movie;
 			class Rewinder;
+			class DeltaRewinder;
+			class Pipeline;
 
 			dword frame;
 			ibool rewinderSound;
+			dword rewinderBudget;
 			Machine* rewinderEnabled;
 			Rewinder* rewinder;
+			DeltaRewinder* deltaRewinder;
+			RunAhead* runAhead;
+			Turbo* turbo;
 			Movie* movie;
 
 		public:
@@ -106,6 +123,16 @@ namespace Nes
 				return rewinderSound;
 			}
 
+			dword GetRewinderBudget() const
+			{
+				return rewinderBudget;
+			}
+
+			const RunAhead* GetRunAhead() const
+			{
+				return runAhead;
+			}
+
 			bool IsFrameLocked() const
 			{
 				return movie;
@@ -0,0 +1,370 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+// Copyright (C) 2003-2008 Martin Freij
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include "NstMachine.hpp"
+#include "NstState.hpp"
+#include "NstTrackerDeltaRewinder.hpp"
+#include "api/NstApiRewinder.hpp"
+
+namespace Nes
+{
+	namespace Core
+	{
+		#ifdef NST_MSVC_OPTIMIZE
+		#pragma optimize("s", on)
+		#endif
+
+		Tracker::DeltaRewinder::DeltaRewinder(Machine& e,EmuExecute x,EmuLoadState l,EmuSaveState s,dword budget,bool b)
+		:
+		rewinding    (false),
+		uturn        (false),
+		sound        (b),
+		head         (0),
+		used         (0),
+		arena        (budget),
+		emulator     (e),
+		emuExecute   (x),
+		emuLoadState (l),
+		emuSaveState (s)
+		{
+		}
+
+		Tracker::DeltaRewinder::~DeltaRewinder()
+		{
+		}
+
+		void Tracker::DeltaRewinder::Reset()
+		{
+			if (rewinding)
+			{
+				rewinding = false;
+				Api::Rewinder::stateCallback( Api::Rewinder::STOPPED );
+			}
+
+			uturn = false;
+			head = 0;
+			used = 0;
+
+			deltas.clear();
+			current.Clear();
+		}
+
+		ulong Tracker::DeltaRewinder::MemoryUsage() const
+		{
+			return used + current.Capacity() + next.Capacity() + packed.Capacity() + deltas.size() * sizeof(Delta);
+		}
+
+		#ifdef NST_MSVC_OPTIMIZE
+		#pragma optimize("", on)
+		#endif
+
+		byte* Tracker::DeltaRewinder::PutRun(byte* dst,dword run)
+		{
+			for (; run >= 0x80; run >>= 7)
+				*dst++ = (run & 0x7F) | 0x80;
+
+			*dst++ = run;
+
+			return dst;
+		}
+
+		dword Tracker::DeltaRewinder::GetRun(const byte*& src,const byte* const end)
+		{
+			dword run = 0;
+
+			for (uint shift=0; shift < 32; shift += 7)
+			{
+				if (src == end)
+					break;
+
+				const uint data = *src++;
+				run |= dword(data & 0x7F) << shift;
+
+				if (!(data & 0x80))
+					return run;
+			}
+
+			throw RESULT_ERR_CORRUPT_FILE;
+		}
+
+		dword Tracker::DeltaRewinder::Pack(const byte* NST_RESTRICT prev,const byte* NST_RESTRICT state,const dword length,byte* NST_RESTRICT dst)
+		{
+			// sequence of [zero run][literal run][literal bytes], a literal run ends at MIN_ZERO_RUN unchanged bytes
+			byte* const begin = dst;
+
+			for (dword i=0; i < length; )
+			{
+				const dword zeros = i;
+
+				while (i + sizeof(qaword) <= length)
+				{
+					qaword a, b;
+					std::memcpy( &a, prev + i, sizeof(qaword) );
+					std::memcpy( &b, state + i, sizeof(qaword) );
+
+					if (a != b)
+						break;
+
+					i += sizeof(qaword);
+				}
+
+				while (i < length && prev[i] == state[i])
+					++i;
+
+				if (i == length)
+					break;
+
+				const dword literals = i;
+				dword literalsEnd = i;
+
+				for (uint run=0; i < length && run < MIN_ZERO_RUN; ++i)
+				{
+					if (prev[i] == state[i])
+					{
+						++run;
+					}
+					else
+					{
+						run = 0;
+						literalsEnd = i + 1;
+					}
+				}
+
+				dst = PutRun( dst, literals - zeros );
+				dst = PutRun( dst, literalsEnd - literals );
+
+				for (i=literals; i < literalsEnd; ++i)
+					*dst++ = prev[i] ^ state[i];
+			}
+
+			return dst - begin;
+		}
+
+		void Tracker::DeltaRewinder::Unpack(const byte* src,const dword size,byte* const state,const dword length)
+		{
+			const byte* const end = src + size;
+
+			for (dword pos=0; src != end; )
+			{
+				const dword zeros = GetRun( src, end );
+
+				if (zeros > length - pos)
+					throw RESULT_ERR_CORRUPT_FILE;
+
+				pos += zeros;
+
+				const dword literals = GetRun( src, end );
+
+				if (literals > length - pos || literals > dword(end - src))
+					throw RESULT_ERR_CORRUPT_FILE;
+
+				for (const byte* const literalsEnd = src + literals; src != literalsEnd; )
+					state[pos++] ^= *src++;
+			}
+		}
+
+		void Tracker::DeltaRewinder::SaveImage(Vector<byte>& image) const
+		{
+			if (image.Capacity())
+			{
+				try
+				{
+					image.Resize( image.Capacity() );
+
+					State::Saver saver( image.Begin(), image.Size(), false );
+					(emulator.*emuSaveState)( saver );
+
+					image.SetTo( saver.MemorySize() );
+					return;
+				}
+				catch (Result)
+				{
+					// state has grown
+				}
+			}
+
+			State::Saver counter( static_cast<byte*>(NULL), 0, false );
+			(emulator.*emuSaveState)( counter );
+
+			image.Resize( counter.MemorySize() );
+
+			State::Saver saver( image.Begin(), image.Size(), false );
+			(emulator.*emuSaveState)( saver );
+		}
+
+		void Tracker::DeltaRewinder::Push(const dword length)
+		{
+			if (length > arena.Size())
+			{
+				head = 0;
+				used = 0;
+				deltas.clear();
+				return;
+			}
+
+			if (length > arena.Size() - head)
+			{
+				// what is left of the previous lap past the head is older than
+				// the frames written since, drop it before wrapping around
+				while (!deltas.empty() && deltas.front().offset >= head)
+				{
+					used -= deltas.front().length;
+					deltas.pop_front();
+				}
+
+				head = 0;
+			}
+
+			// drop the oldest frames in the way, they are in arena order from here
+			while (!deltas.empty() && deltas.front().offset < head + length && head < deltas.front().offset + deltas.front().length)
+			{
+				used -= deltas.front().length;
+				deltas.pop_front();
+			}
+
+			std::memcpy( arena.Begin() + head, packed.Begin(), length );
+
+			const Delta delta = {head,length};
+			deltas.push_back( delta );
+
+			head += length;
+			used += length;
+		}
+
+		void Tracker::DeltaRewinder::Store()
+		{
+			SaveImage( next );
+
+			if (current.Size() && current.Size() == next.Size())
+			{
+				if (packed.Size() < current.Size() * 3 + 16)
+					packed.Resize( current.Size() * 3 + 16 );
+
+				Push( Pack( current.Begin(), next.Begin(), current.Size(), packed.Begin() ) );
+			}
+			else
+			{
+				// a new image or a different state layout, older frames can't be restored anymore
+				head = 0;
+				used = 0;
+				deltas.clear();
+			}
+
+			Vector<byte>::Swap( current, next );
+		}
+
+		bool Tracker::DeltaRewinder::Restore()
+		{
+			if (deltas.empty())
+				return false;
+
+			const Delta delta = deltas.back();
+			deltas.pop_back();
+
+			head = delta.offset;
+			used -= delta.length;
+
+			Unpack( arena.Begin() + delta.offset, delta.length, current.Begin(), current.Size() );
+
+			State::Loader loader( current.Begin(), current.Size(), false );
+			(emulator.*emuLoadState)( loader, true );
+
+			return true;
+		}
+
+		void Tracker::DeltaRewinder::Execute(Video::Output* videoOut,Sound::Output* soundOut,Input::Controllers* inputOut,Sound::Input* inputSoundOut)
+		{
+			try
+			{
+				if (uturn)
+				{
+					uturn = false;
+
+					if (rewinding)
+					{
+						// the current state becomes the newest frame to step back from
+						Store();
+						Api::Rewinder::stateCallback( Api::Rewinder::REWINDING );
+					}
+					else
+					{
+						Api::Rewinder::stateCallback( Api::Rewinder::STOPPED );
+					}
+				}
+
+				if (rewinding)
+				{
+					if (Restore())
+					{
+						// render the restored frame, its resulting state is discarded on the next step
+						(emulator.*emuExecute)( videoOut, sound ? soundOut : NULL, NULL, NULL );
+						return;
+					}
+
+					rewinding = false;
+					Api::Rewinder::stateCallback( Api::Rewinder::STOPPED );
+				}
+
+				Store();
+			}
+			catch (...)
+			{
+				Reset();
+				throw;
+			}
+
+			(emulator.*emuExecute)( videoOut, soundOut, inputOut, inputSoundOut );
+		}
+
+		Result Tracker::DeltaRewinder::Start()
+		{
+			if (rewinding)
+				return RESULT_NOP;
+
+			if (uturn || current.Size() == 0)
+				return RESULT_ERR_NOT_READY;
+
+			uturn = true;
+			rewinding = true;
+
+			return RESULT_OK;
+		}
+
+		Result Tracker::DeltaRewinder::Stop()
+		{
+			if (!rewinding)
+				return RESULT_NOP;
+
+			if (uturn)
+				return RESULT_ERR_NOT_READY;
+
+			uturn = true;
+			rewinding = false;
+
+			return RESULT_OK;
+		}
+	}
+}
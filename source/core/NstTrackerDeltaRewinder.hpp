@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+// Copyright (C) 2003-2008 Martin Freij
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef NST_TRACKER_DELTAREWINDER_H
+#define NST_TRACKER_DELTAREWINDER_H
+
+#include <deque>
+
+#ifndef NST_VECTOR_H
+#include "NstVector.hpp"
+#endif
+
+#ifdef NST_PRAGMA_ONCE
+#pragma once
+#endif
+
+namespace Nes
+{
+	namespace Core
+	{
+		// Stores every frame's state as a compressed XOR delta from the previous one
+		// in a fixed size arena, rewinding steps back one frame at a time without re-emulation.
+		class Tracker::DeltaRewinder
+		{
+			typedef void (Machine::*EmuExecute)(Video::Output*,Sound::Output*,Input::Controllers*,Sound::Input*);
+			typedef void (Machine::*EmuSaveState)(State::Saver&) const;
+			typedef bool (Machine::*EmuLoadState)(State::Loader&,bool);
+
+		public:
+
+			DeltaRewinder(Machine&,EmuExecute,EmuLoadState,EmuSaveState,dword,bool);
+			~DeltaRewinder();
+
+			Result Start();
+			Result Stop();
+			void   Reset();
+			void   Execute(Video::Output*,Sound::Output*,Input::Controllers*,Sound::Input*);
+			ulong  MemoryUsage() const;
+
+		private:
+
+			void SaveImage(Vector<byte>&) const;
+			void Store();
+			bool Restore();
+			void Push(dword);
+
+			static dword Pack(const byte* NST_RESTRICT,const byte* NST_RESTRICT,dword,byte* NST_RESTRICT);
+			static void  Unpack(const byte*,dword,byte*,dword);
+			static byte* PutRun(byte*,dword);
+			static dword GetRun(const byte*&,const byte*);
+
+			enum
+			{
+				MIN_ZERO_RUN = 4
+			};
+
+			struct Delta
+			{
+				dword offset;
+				dword length;
+			};
+
+			ibool rewinding;
+			ibool uturn;
+			ibool sound;
+			dword head;
+			dword used;
+
+			std::deque<Delta> deltas;
+			Vector<byte> arena;
+			Vector<byte> current;
+			Vector<byte> next;
+			Vector<byte> packed;
+
+			Machine& emulator;
+			const EmuExecute emuExecute;
+			const EmuLoadState emuLoadState;
+			const EmuSaveState emuSaveState;
+
+		public:
+
+			void Unload()
+			{
+				Reset();
+			}
+
+			void EnableSound(bool enable)
+			{
+				sound = enable;
+			}
+
+			bool IsRewinding() const
+			{
+				return rewinding;
+			}
+
+			dword NumFrames() const
+			{
+				return deltas.size();
+			}
+		};
+	}
+}
+
+#endif
@@ -724,6 +724,30 @@ namespace Nes
 
 			uturn = false;
 
+			// none of the frames replayed here get displayed, the ones recorded
+			// for reverse playback still get their pixels through the video mutex
+
+			class Headless
+			{
+				Machine& emulator;
+				const bool state;
+
+			public:
+
+				explicit Headless(Machine& e)
+				: emulator(e), state(e.IsHeadless())
+				{
+					emulator.EnableHeadless( true );
+				}
+
+				~Headless()
+				{
+					emulator.EnableHeadless( state );
+				}
+			};
+
+			const Headless headless( emulator );
+
 			if (rewinding)
 			{
 				for (uint i=frame; i < LAST_FRAME; ++i)
@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+// Copyright (C) 2003-2008 Martin Freij
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include "NstMachine.hpp"
+#include "NstState.hpp"
+#include "NstTrackerRunAhead.hpp"
+
+namespace Nes
+{
+	namespace Core
+	{
+		#ifdef NST_MSVC_OPTIMIZE
+		#pragma optimize("s", on)
+		#endif
+
+		Tracker::RunAhead::RunAhead(Machine& e,EmuExecute x,EmuLoadState l,EmuSaveState s,uint n)
+		:
+		frames       (n),
+		size         (0),
+		emulator     (e),
+		emuExecute   (x),
+		emuLoadState (l),
+		emuSaveState (s)
+		{
+			NST_ASSERT( n && n <= MAX_FRAMES );
+
+			stats.frames = 0;
+			stats.time = 0;
+			stats.overhead = 0;
+
+			// saving the state drains the sound worker and loading it detaches
+			// the worker, so it would be set up anew and waited on every frame
+
+			emulator.cpu.GetApu().SuspendParallel( true );
+		}
+
+		Tracker::RunAhead::~RunAhead()
+		{
+			emulator.cpu.GetApu().SuspendParallel( false );
+		}
+
+		#ifdef NST_MSVC_OPTIMIZE
+		#pragma optimize("", on)
+		#endif
+
+		void Tracker::RunAhead::Save()
+		{
+			for (;;)
+			{
+				if (state.Size())
+				{
+					try
+					{
+						State::Saver saver( state.Begin(), state.Size(), false );
+						(emulator.*emuSaveState)( saver );
+						size = saver.MemorySize();
+						return;
+					}
+					catch (Result result)
+					{
+						// buffer too small, only happens the first time around
+						if (result != RESULT_ERR_BUFFER_TOO_SMALL)
+							throw;
+					}
+				}
+
+				state.Resize( state.Size() ? state.Size() * 2 : dword(SIZE_64K) );
+			}
+		}
+
+		void Tracker::RunAhead::Load()
+		{
+			State::Loader loader( state.Begin(), size, false );
+			(emulator.*emuLoadState)( loader, true );
+		}
+
+		void Tracker::RunAhead::Execute(Tracker& tracker,Video::Output* video,Sound::Output* sound,Input::Controllers* input,Sound::Input* inputSound)
+		{
+			typedef std::chrono::steady_clock Clock;
+			const Clock::time_point begin( Clock::now() );
+
+			// speculative frames would be seen by the remote side, and there's no
+			// point in running ahead of a frame that isn't going to be shown anyway
+
+			if (!video || emulator.IsNetworked())
+			{
+				tracker.EmulateFrame( emulator, video, sound, input, inputSound );
+
+				stats.frames = 0;
+				stats.overhead = 0;
+			}
+			else
+			{
+				const bool headless = emulator.IsHeadless();
+				emulator.EnableHeadless( true );
+
+				Clock::time_point real;
+
+				try
+				{
+					// the real frame, recorded by the rewinder if there's one
+					tracker.EmulateFrame( emulator, NULL, sound, input, inputSound );
+
+					real = Clock::now();
+					Save();
+
+					for (uint i=1; i < frames; ++i)
+						(emulator.*emuExecute)( NULL, NULL, input, NULL );
+
+					emulator.EnableHeadless( headless );
+					(emulator.*emuExecute)( video, NULL, input, NULL );
+
+					Load();
+				}
+				catch (...)
+				{
+					emulator.EnableHeadless( headless );
+					throw;
+				}
+
+				stats.frames = frames;
+				stats.overhead = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - real).count();
+			}
+
+			stats.time = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - begin).count();
+		}
+	}
+}
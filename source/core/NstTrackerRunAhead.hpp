@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+// Copyright (C) 2003-2008 Martin Freij
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef NST_TRACKER_RUNAHEAD_H
+#define NST_TRACKER_RUNAHEAD_H
+
+#ifndef NST_VECTOR_H
+#include "NstVector.hpp"
+#endif
+
+#ifdef NST_PRAGMA_ONCE
+#pragma once
+#endif
+
+namespace Nes
+{
+	namespace Core
+	{
+		// Hides the game's own input lag. Each frame is first emulated for real, with
+		// sound but no picture, then the state is saved, the following frames are
+		// emulated ahead with the same input and the last one of them is shown, and
+		// the saved state is put back.
+		class Tracker::RunAhead
+		{
+			typedef void (Machine::*EmuExecute)(Video::Output*,Sound::Output*,Input::Controllers*,Sound::Input*);
+			typedef void (Machine::*EmuSaveState)(State::Saver&) const;
+			typedef bool (Machine::*EmuLoadState)(State::Loader&,bool);
+
+		public:
+
+			RunAhead(Machine&,EmuExecute,EmuLoadState,EmuSaveState,uint);
+			~RunAhead();
+
+			void Execute(Tracker&,Video::Output*,Sound::Output*,Input::Controllers*,Sound::Input*);
+
+			enum
+			{
+				MAX_FRAMES = 8
+			};
+
+			struct Stats
+			{
+				uint frames;
+				dword time;
+				dword overhead;
+			};
+
+		private:
+
+			void Save();
+			void Load();
+
+			uint frames;
+			dword size;
+			Vector<byte> state;
+			Stats stats;
+
+			Machine& emulator;
+			const EmuExecute emuExecute;
+			const EmuLoadState emuLoadState;
+			const EmuSaveState emuSaveState;
+
+		public:
+
+			void SetFrames(uint count)
+			{
+				NST_ASSERT( count && count <= MAX_FRAMES );
+				frames = count;
+			}
+
+			uint NumFrames() const
+			{
+				return frames;
+			}
+
+			const Stats& GetStats() const
+			{
+				return stats;
+			}
+
+			void Skip()
+			{
+				stats.frames = 0;
+				stats.time = 0;
+				stats.overhead = 0;
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,212 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+// Copyright (C) 2003-2008 Martin Freij
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#include "NstMachine.hpp"
+#include "api/NstApiSound.hpp"
+#include "NstTrackerTurbo.hpp"
+
+namespace Nes
+{
+	namespace Core
+	{
+		// Keeps the skipped frames headless and catches their sound before it
+		// reaches the user's lock/unlock callbacks. The callbacks are swapped
+		// process-wide, the same way the rewinder does for its reversed sound,
+		// and put back on destruction, including when a frame throws.
+
+		class Tracker::Turbo::Capture
+		{
+			Machine& emulator;
+			const bool headless;
+			bool& streamed;
+			Sound::Output::LockCallback funcLock;
+			void* userLock;
+			Sound::Output::UnlockCallback funcUnlock;
+			void* userUnlock;
+
+			static bool NST_CALLBACK Lock(void* data,Sound::Output&)
+			{
+				*static_cast<bool*>(data) = true;
+				return true;
+			}
+
+		public:
+
+			Capture(Machine& e,bool& s)
+			: emulator(e), headless(e.IsHeadless()), streamed(s)
+			{
+				Sound::Output::lockCallback.Get( funcLock, userLock );
+				Sound::Output::unlockCallback.Get( funcUnlock, userUnlock );
+				Sound::Output::lockCallback.Set( &Lock, &streamed );
+				Sound::Output::unlockCallback.Set( NULL, NULL );
+
+				emulator.EnableHeadless( true );
+			}
+
+			void Show() const
+			{
+				emulator.EnableHeadless( headless );
+			}
+
+			~Capture()
+			{
+				emulator.EnableHeadless( headless );
+
+				Sound::Output::lockCallback.Set( funcLock, userLock );
+				Sound::Output::unlockCallback.Set( funcUnlock, userUnlock );
+			}
+		};
+
+		#ifdef NST_MSVC_OPTIMIZE
+		#pragma optimize("s", on)
+		#endif
+
+		Tracker::Turbo::Turbo(uint n)
+		: frames(n)
+		{
+			NST_ASSERT( n >= 2 && n <= MAX_FRAMES );
+		}
+
+		#ifdef NST_MSVC_OPTIMIZE
+		#pragma optimize("", on)
+		#endif
+
+		template<typename T,uint CHANNELS>
+		void Tracker::Turbo::Stretch(const T* src,const dword srcLength,Sound::Output& output)
+		{
+			// box filter decimation, each output sample is the average of the
+			// input samples that fall within its span
+
+			const dword dstLength = output.length[0] + output.length[1];
+
+			if (!dstLength || !srcLength)
+				return;
+
+			const dword step = srcLength / dstLength;
+			const dword remainder = srcLength % dstLength;
+			dword error = 0;
+
+			for (uint i=0; i < 2; ++i)
+			{
+				T* NST_RESTRICT dst = static_cast<T*>(output.samples[i]);
+
+				for (dword n=output.length[i]; n; --n)
+				{
+					dword count = step;
+
+					if ((error += remainder) >= dstLength)
+					{
+						error -= dstLength;
+						++count;
+					}
+
+					for (uint c=0; c < CHANNELS; ++c)
+					{
+						if (count)
+						{
+							long sum = 0;
+
+							for (dword j=0; j < count; ++j)
+								sum += src[j * CHANNELS + c];
+
+							*dst++ = T(sum / long(count));
+						}
+						else
+						{
+							*dst++ = src[c];
+						}
+					}
+
+					src += count * CHANNELS;
+				}
+			}
+		}
+
+		void Tracker::Turbo::Execute
+		(
+			Tracker& tracker,
+			Machine& emulator,
+			Video::Output* const video,
+			Sound::Output* const sound,
+			Input::Controllers* const input,
+			Sound::Input* const inputSound
+		)
+		{
+			const Apu& apu = emulator.cpu.GetApu();
+			const uint align = apu.GetSampleBlockAlign();
+			const dword length = sound ? sound->length[0] + sound->length[1] : 0;
+
+			if (length)
+				buffer.Resize( length * align * frames );
+
+			Sound::Output output;
+			bool streamed = false;
+
+			{
+				const Capture capture( emulator, streamed );
+
+				for (uint i=0; i < frames; ++i)
+				{
+					output.samples[0] = buffer.Begin() + length * align * i;
+					output.length[0] = length;
+
+					if (i == frames-1)
+						capture.Show();
+
+					tracker.ExecuteFrame
+					(
+						emulator,
+						i == frames-1 ? video : NULL,
+						length ? &output : NULL,
+						input,
+						inputSound
+					);
+				}
+			}
+
+			if (streamed && Sound::Output::lockCallback( *sound ))
+			{
+				const dword total = length * frames;
+
+				if (apu.GetSampleBits() == 16)
+				{
+					if (!apu.InStereo())
+						Stretch<iword,1>( reinterpret_cast<const iword*>(buffer.Begin()), total, *sound );
+					else
+						Stretch<iword,2>( reinterpret_cast<const iword*>(buffer.Begin()), total, *sound );
+				}
+				else
+				{
+					if (!apu.InStereo())
+						Stretch<byte,1>( buffer.Begin(), total, *sound );
+					else
+						Stretch<byte,2>( buffer.Begin(), total, *sound );
+				}
+
+				Sound::Output::unlockCallback( *sound );
+			}
+		}
+	}
+}
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+// Copyright (C) 2003-2008 Martin Freij
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef NST_TRACKER_TURBO_H
+#define NST_TRACKER_TURBO_H
+
+#ifndef NST_VECTOR_H
+#include "NstVector.hpp"
+#endif
+
+#ifdef NST_PRAGMA_ONCE
+#pragma once
+#endif
+
+namespace Nes
+{
+	namespace Core
+	{
+		// Fast-forward. Each call emulates a number of frames in a row, all but the
+		// last one headless, and squeezes their sound into the single frame's worth
+		// of samples the caller asked for so that the audio keeps playing smoothly.
+		// The sound is caught through the static Sound::Output callbacks, so only one
+		// instance may be executing at any time.
+		class Tracker::Turbo
+		{
+		public:
+
+			explicit Turbo(uint);
+
+			void Execute(Tracker&,Machine&,Video::Output*,Sound::Output*,Input::Controllers*,Sound::Input*);
+
+			enum
+			{
+				MAX_FRAMES = 16
+			};
+
+		private:
+
+			class Capture;
+
+			template<typename T,uint CHANNELS>
+			static void Stretch(const T*,dword,Sound::Output&);
+
+			uint frames;
+			Vector<byte> buffer;
+
+		public:
+
+			void SetFrames(uint count)
+			{
+				NST_ASSERT( count >= 2 && count <= MAX_FRAMES );
+				frames = count;
+			}
+
+			uint NumFrames() const
+			{
+				return frames;
+			}
+		};
+	}
+}
+
+#endif
@@ -76,20 +76,21 @@ namespace Nes
 			}
 
 			template<typename T>
-			void Renderer::Filter2xSaI::BlitType(const Input& input,const Output& output) const
+			void Renderer::Filter2xSaI::BlitType(const Input& input,const Output& output,const uint first,const uint last) const
 			{
-				const word* NST_RESTRICT src = input.pixels;
+				const word* NST_RESTRICT src = input.pixels + first * WIDTH;
 				const long pitch = output.pitch;
+				byte* const dst0 = static_cast<byte*>(output.pixels) + pitch * long(first * 2);
 
 				T* NST_RESTRICT dst[2] =
 				{
-					static_cast<T*>(output.pixels),
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + pitch)
+					reinterpret_cast<T*>(dst0),
+					reinterpret_cast<T*>(dst0 + pitch)
 				};
 
 				dword a,b,c,d,e=0,f=0,g,h,i=0,j=0,k,l,m,n,o;
 
-				for (uint y=0; y < HEIGHT; ++y)
+				for (uint y=first; y < last; ++y)
 				{
 					for (uint x=0; x < WIDTH; ++x, ++src, dst[0] += 2, dst[1] += 2)
 					{
@@ -253,14 +254,29 @@ namespace Nes
 			}
 
 			void Renderer::Filter2xSaI::Blit(const Input& input,const Output& output,uint)
+			{
+				BlitRows( input, output, 0, 0, HEIGHT );
+			}
+
+			void Renderer::Filter2xSaI::BlitRows(const Input& input,const Output& output,uint,uint first,uint last)
 			{
 				switch (format.bpp)
 				{
-					case 32: BlitType< dword >( input, output ); break;
-					case 16: BlitType< word  >( input, output ); break;
+					case 32: BlitType< dword >( input, output, first, last ); break;
+					case 16: BlitType< word  >( input, output, first, last ); break;
 					default: NST_UNREACHABLE();
 				}
 			}
+
+			bool Renderer::Filter2xSaI::CanBlitRows(const Input&) const
+			{
+				return true;
+			}
+
+			uint Renderer::Filter2xSaI::GetRowContext() const
+			{
+				return 2;
+			}
 		}
 	}
 }
@@ -46,9 +46,12 @@ namespace Nes
 			private:
 
 				void Blit(const Input&,const Output&,uint);
+				void BlitRows(const Input&,const Output&,uint,uint,uint);
+				bool CanBlitRows(const Input&) const;
+				uint GetRowContext() const;
 
 				template<typename T>
-				void BlitType(const Input&,const Output&) const;
+				void BlitType(const Input&,const Output&,uint,uint) const;
 
 				inline dword Blend(dword,dword) const;
 				inline dword Blend(dword,dword,dword,dword) const;
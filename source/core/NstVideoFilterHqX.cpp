@@ -39,7 +39,22 @@ namespace Nes
 		{
 			void Renderer::FilterHqX::Blit(const Input& input,const Output& output,uint)
 			{
-				(*this.*path)( input, output );
+				(*this.*path)( input, output, 0, HEIGHT );
+			}
+
+			void Renderer::FilterHqX::BlitRows(const Input& input,const Output& output,uint,uint first,uint last)
+			{
+				(*this.*path)( input, output, first, last );
+			}
+
+			bool Renderer::FilterHqX::CanBlitRows(const Input&) const
+			{
+				return true;
+			}
+
+			uint Renderer::FilterHqX::GetRowContext() const
+			{
+				return 1;
 			}
 
 			template<dword R,dword G,dword B>
@@ -153,18 +168,19 @@ namespace Nes
 			};
 
 			template<typename T,dword R,dword G,dword B>
-			void Renderer::FilterHqX::Blit2x(const Input& input,const Output& output) const
+			void Renderer::FilterHqX::Blit2x(const Input& input,const Output& output,const uint first,const uint last) const
 			{
-				const byte* NST_RESTRICT src = reinterpret_cast<const byte*>(input.pixels);
+				const byte* NST_RESTRICT src = reinterpret_cast<const byte*>(input.pixels + first * WIDTH);
 				const long pitch = output.pitch + output.pitch - (WIDTH*2 * sizeof(T));
+				byte* const dst0 = static_cast<byte*>(output.pixels) + output.pitch * long(first * 2);
 
 				T* NST_RESTRICT dst[2] =
 				{
-					static_cast<T*>(output.pixels) - 2,
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch) - 2
+					reinterpret_cast<T*>(dst0) - 2,
+					reinterpret_cast<T*>(dst0 + output.pitch) - 2
 				};
 
-				for (uint y=HEIGHT; y; --y)
+				for (uint y=HEIGHT-first; y > HEIGHT-last; --y)
 				{
 					const uint lines[2] =
 					{
@@ -211,19 +227,20 @@ namespace Nes
 			}
 
 			template<typename T,dword R,dword G,dword B>
-			void Renderer::FilterHqX::Blit3x(const Input& input,const Output& output) const
+			void Renderer::FilterHqX::Blit3x(const Input& input,const Output& output,const uint first,const uint last) const
 			{
-				const byte* NST_RESTRICT src = reinterpret_cast<const byte*>(input.pixels);
+				const byte* NST_RESTRICT src = reinterpret_cast<const byte*>(input.pixels + first * WIDTH);
 				const long pitch = (output.pitch * 2) + output.pitch - (WIDTH*3 * sizeof(T));
+				byte* const dst0 = static_cast<byte*>(output.pixels) + output.pitch * long(first * 3);
 
 				T* NST_RESTRICT dst[3] =
 				{
-					static_cast<T*>(output.pixels) - 3,
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch) - 3,
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch * 2) - 3
+					reinterpret_cast<T*>(dst0) - 3,
+					reinterpret_cast<T*>(dst0 + output.pitch) - 3,
+					reinterpret_cast<T*>(dst0 + output.pitch * 2) - 3
 				};
 
-				for (uint y=HEIGHT; y; --y)
+				for (uint y=HEIGHT-first; y > HEIGHT-last; --y)
 				{
 					const uint lines[2] =
 					{
@@ -272,20 +289,21 @@ namespace Nes
 			}
 
 			template<typename T,dword R,dword G,dword B>
-			void Renderer::FilterHqX::Blit4x(const Input& input,const Output& output) const
+			void Renderer::FilterHqX::Blit4x(const Input& input,const Output& output,const uint first,const uint last) const
 			{
-				const byte* NST_RESTRICT src = reinterpret_cast<const byte*>(input.pixels);
+				const byte* NST_RESTRICT src = reinterpret_cast<const byte*>(input.pixels + first * WIDTH);
 				const long pitch = (output.pitch * 3) + output.pitch - (WIDTH*4 * sizeof(T));
+				byte* const dst0 = static_cast<byte*>(output.pixels) + output.pitch * long(first * 4);
 
 				T* NST_RESTRICT dst[4] =
 				{
-					static_cast<T*>(output.pixels) - 4,
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch) - 4,
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch * 2) - 4,
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch * 3) - 4
+					reinterpret_cast<T*>(dst0) - 4,
+					reinterpret_cast<T*>(dst0 + output.pitch) - 4,
+					reinterpret_cast<T*>(dst0 + output.pitch * 2) - 4,
+					reinterpret_cast<T*>(dst0 + output.pitch * 3) - 4
 				};
 
-				for (uint y=HEIGHT; y; --y)
+				for (uint y=HEIGHT-first; y > HEIGHT-last; --y)
 				{
 					const uint lines[2] =
 					{
@@ -48,11 +48,14 @@ namespace Nes
 
 				~FilterHqX() {}
 
-				typedef void (FilterHqX::*Path)(const Input&,const Output&) const;
+				typedef void (FilterHqX::*Path)(const Input&,const Output&,uint,uint) const;
 
 				static Path GetPath(const RenderState&);
 
 				void Blit(const Input&,const Output&,uint);
+				void BlitRows(const Input&,const Output&,uint,uint,uint);
+				bool CanBlitRows(const Input&) const;
+				uint GetRowContext() const;
 				void Transform(const byte (&)[PALETTE][3],Input::Palette&) const;
 
 				template<dword R,dword G,dword B> static dword Interpolate1(dword,dword);
@@ -69,13 +72,13 @@ namespace Nes
 				inline dword Diff(uint,uint) const;
 
 				template<typename T,dword R,dword G,dword B>
-				void Blit2x(const Input&,const Output&) const;
+				void Blit2x(const Input&,const Output&,uint,uint) const;
 
 				template<typename T,dword R,dword G,dword B>
-				void Blit3x(const Input&,const Output&) const;
+				void Blit3x(const Input&,const Output&,uint,uint) const;
 
 				template<typename T,dword R,dword G,dword B>
-				void Blit4x(const Input&,const Output&) const;
+				void Blit4x(const Input&,const Output&,uint,uint) const;
 
 				template<typename T>
 				struct Buffer;
@@ -211,6 +211,38 @@ namespace Nes
 				}
 			}
 
+			template<typename T>
+			void Renderer::FilterNone::BlitLines(const Input& input,const Output& output,const uint first,const uint last)
+			{
+				const Input::Pixel* NST_RESTRICT src = input.pixels + first * WIDTH;
+				T* NST_RESTRICT dst = reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch * long(first));
+
+				const long pad = output.pitch - WIDTH * sizeof(T);
+
+				for (uint y=last-first; y; --y)
+				{
+					for (uint x=WIDTH; x; --x)
+						*dst++ = input.palette[*src++];
+
+					dst = reinterpret_cast<T*>(reinterpret_cast<byte*>(dst) + pad);
+				}
+			}
+
+			void Renderer::FilterNone::BlitRows(const Input& input,const Output& output,uint,uint first,uint last)
+			{
+				if (format.bpp == 32)
+					BlitLines<dword>( input, output, first, last );
+				else
+					BlitLines<word>( input, output, first, last );
+			}
+
+			bool Renderer::FilterNone::CanBlitRows(const Input& input) const
+			{
+				// the downsampled frames flagged in the padding are drawn whole
+
+				return !input.pixels[PIXELS];
+			}
+
 			#ifdef NST_MSVC_OPTIMIZE
 			#pragma optimize("s", on)
 			#endif
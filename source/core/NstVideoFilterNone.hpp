@@ -48,12 +48,17 @@ namespace Nes
 				~FilterNone() {}
 
 				void Blit(const Input&,const Output&,uint);
+				void BlitRows(const Input&,const Output&,uint,uint,uint);
+				bool CanBlitRows(const Input&) const;
 
 				template<typename T>
 				static void BlitAligned(const Input&,const Output&);
 
 				template<typename T>
 				static void BlitUnaligned(const Input&,const Output&);
+
+				template<typename T>
+				static void BlitLines(const Input&,const Output&,uint,uint);
 			};
 		}
 	}
@@ -27,6 +27,24 @@
 #include "NstVideoFilterNtsc.hpp"
 #include "NstFpuPrecision.hpp"
 
+#if defined(NST_NTSC_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(NST_NTSC_AVX2)
+#include <immintrin.h>
+#if NST_MSVC
+#include <intrin.h>
+#define NST_NTSC_TARGET_AVX2
+#else
+#define NST_NTSC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#if defined(NST_NTSC_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace Nes
 {
 	namespace Core
@@ -35,22 +53,34 @@ namespace Nes
 		{
 			void Renderer::FilterNtsc::Blit(const Input& input,const Output& output,uint phase)
 			{
-				(*this.*path)( input, output, phase );
+				(*this.*path)( input, output, phase, 0, HEIGHT );
+			}
+
+			void Renderer::FilterNtsc::BlitRows(const Input& input,const Output& output,uint phase,uint first,uint last)
+			{
+				(*this.*path)( input, output, phase, first, last );
+			}
+
+			bool Renderer::FilterNtsc::CanBlitRows(const Input&) const
+			{
+				return true;
 			}
 
 			template<typename Pixel,uint BITS>
-			void Renderer::FilterNtsc::BlitType(const Input& input,const Output& output,uint phase) const
+			void Renderer::FilterNtsc::BlitType(const Input& input,const Output& output,uint phase,const uint first,const uint last) const
 			{
 				NST_ASSERT( phase < 3 );
 				
 				const uint bgcolor = this->bgColor;
-				const Input::Pixel* NST_RESTRICT src = input.pixels;
-				Pixel* NST_RESTRICT dst = static_cast<Pixel*>(output.pixels);
+				const Input::Pixel* NST_RESTRICT src = input.pixels + first * WIDTH;
+				Pixel* NST_RESTRICT dst = reinterpret_cast<Pixel*>(static_cast<byte*>(output.pixels) + output.pitch * long(first));
 				const long pad = output.pitch - (NTSC_WIDTH-7) * sizeof(Pixel);
 
-				phase &= lut.noFieldMerging;
+				// the burst phase steps once per line
 
-				for (uint y=HEIGHT; y; --y)
+				phase = ((phase & lut.noFieldMerging) + first) % 3;
+
+				for (uint y=last-first; y; --y)
 				{
 					NES_NTSC_BEGIN_ROW( &lut, phase, bgcolor, bgcolor, *src++ );
 
@@ -89,10 +119,335 @@ namespace Nes
 				}
 			}
 
+			#ifdef NST_NTSC_SSE2
+
+			struct Renderer::FilterNtsc::Sse2
+			{
+				struct Vector
+				{
+					__m128i lo, hi;
+
+					Vector() {}
+
+					Vector(__m128i l,__m128i h)
+					: lo(l), hi(h) {}
+				};
+
+				static NST_FORCE_INLINE Vector Load(const dword* p)
+				{
+					return Vector( _mm_loadu_si128( reinterpret_cast<const __m128i*>(p) ), _mm_loadu_si128( reinterpret_cast<const __m128i*>(p+4) ) );
+				}
+
+				static NST_FORCE_INLINE Vector Set(dword v)
+				{
+					return Vector( _mm_set1_epi32( int(v) ), _mm_set1_epi32( int(v) ) );
+				}
+
+				static NST_FORCE_INLINE Vector Add(const Vector& a,const Vector& b)
+				{
+					return Vector( _mm_add_epi32( a.lo, b.lo ), _mm_add_epi32( a.hi, b.hi ) );
+				}
+
+				static NST_FORCE_INLINE Vector Sub(const Vector& a,const Vector& b)
+				{
+					return Vector( _mm_sub_epi32( a.lo, b.lo ), _mm_sub_epi32( a.hi, b.hi ) );
+				}
+
+				static NST_FORCE_INLINE Vector And(const Vector& a,const Vector& b)
+				{
+					return Vector( _mm_and_si128( a.lo, b.lo ), _mm_and_si128( a.hi, b.hi ) );
+				}
+
+				static NST_FORCE_INLINE Vector Or(const Vector& a,const Vector& b)
+				{
+					return Vector( _mm_or_si128( a.lo, b.lo ), _mm_or_si128( a.hi, b.hi ) );
+				}
+
+				template<int N>
+				static NST_FORCE_INLINE Vector Shr(const Vector& a)
+				{
+					return Vector( _mm_srli_epi32( a.lo, N ), _mm_srli_epi32( a.hi, N ) );
+				}
+
+				static NST_FORCE_INLINE void Store(dword* p,const Vector& v)
+				{
+					_mm_storeu_si128( reinterpret_cast<__m128i*>(p+0), v.lo );
+					_mm_storeu_si128( reinterpret_cast<__m128i*>(p+4), v.hi );
+				}
+
+				static NST_FORCE_INLINE void Store(word* p,const Vector& v)
+				{
+					// biased so the signed saturation of the pack leaves 16 bit values intact
+
+					const __m128i bias( _mm_set1_epi32( 0x8000 ) );
+
+					_mm_storeu_si128
+					(
+						reinterpret_cast<__m128i*>(p),
+						_mm_add_epi16( _mm_packs_epi32( _mm_sub_epi32( v.lo, bias ), _mm_sub_epi32( v.hi, bias ) ), _mm_set1_epi16( -0x8000 ) )
+					);
+				}
+			};
+
+			template<typename Pixel,uint BITS>
+			void Renderer::FilterNtsc::BlitSse2(const Input& input,const Output& output,uint phase,const uint first,const uint last) const
+			{
+				typedef Sse2 Lanes;
+
+				#include "NstVideoFilterNtsc.inl"
+			}
+
+			#endif
+
+			#ifdef NST_NTSC_AVX2
+
+			struct Renderer::FilterNtsc::Avx2
+			{
+				typedef __m256i Vector;
+
+				static NST_NTSC_TARGET_AVX2 NST_FORCE_INLINE Vector Load(const dword* p)
+				{
+					return _mm256_loadu_si256( reinterpret_cast<const __m256i*>(p) );
+				}
+
+				static NST_NTSC_TARGET_AVX2 NST_FORCE_INLINE Vector Set(dword v)
+				{
+					return _mm256_set1_epi32( int(v) );
+				}
+
+				static NST_NTSC_TARGET_AVX2 NST_FORCE_INLINE Vector Add(const Vector& a,const Vector& b)
+				{
+					return _mm256_add_epi32( a, b );
+				}
+
+				static NST_NTSC_TARGET_AVX2 NST_FORCE_INLINE Vector Sub(const Vector& a,const Vector& b)
+				{
+					return _mm256_sub_epi32( a, b );
+				}
+
+				static NST_NTSC_TARGET_AVX2 NST_FORCE_INLINE Vector And(const Vector& a,const Vector& b)
+				{
+					return _mm256_and_si256( a, b );
+				}
+
+				static NST_NTSC_TARGET_AVX2 NST_FORCE_INLINE Vector Or(const Vector& a,const Vector& b)
+				{
+					return _mm256_or_si256( a, b );
+				}
+
+				template<int N>
+				static NST_NTSC_TARGET_AVX2 NST_FORCE_INLINE Vector Shr(const Vector& a)
+				{
+					return _mm256_srli_epi32( a, N );
+				}
+
+				static NST_NTSC_TARGET_AVX2 NST_FORCE_INLINE void Store(dword* p,const Vector& v)
+				{
+					_mm256_storeu_si256( reinterpret_cast<__m256i*>(p), v );
+				}
+
+				static NST_NTSC_TARGET_AVX2 NST_FORCE_INLINE void Store(word* p,const Vector& v)
+				{
+					_mm_storeu_si128( reinterpret_cast<__m128i*>(p), _mm_packus_epi32( _mm256_castsi256_si128( v ), _mm256_extracti128_si256( v, 1 ) ) );
+				}
+			};
+
+			template<typename Pixel,uint BITS>
+			NST_NTSC_TARGET_AVX2 void Renderer::FilterNtsc::BlitAvx2(const Input& input,const Output& output,uint phase,const uint first,const uint last) const
+			{
+				typedef Avx2 Lanes;
+
+				#include "NstVideoFilterNtsc.inl"
+			}
+
+			#endif
+
+			#ifdef NST_NTSC_NEON
+
+			struct Renderer::FilterNtsc::Neon
+			{
+				struct Vector
+				{
+					uint32x4_t lo, hi;
+
+					Vector() {}
+
+					Vector(uint32x4_t l,uint32x4_t h)
+					: lo(l), hi(h) {}
+				};
+
+				static NST_FORCE_INLINE Vector Load(const dword* p)
+				{
+					return Vector( vld1q_u32( reinterpret_cast<const uint32_t*>(p) ), vld1q_u32( reinterpret_cast<const uint32_t*>(p+4) ) );
+				}
+
+				static NST_FORCE_INLINE Vector Set(dword v)
+				{
+					return Vector( vdupq_n_u32( v ), vdupq_n_u32( v ) );
+				}
+
+				static NST_FORCE_INLINE Vector Add(const Vector& a,const Vector& b)
+				{
+					return Vector( vaddq_u32( a.lo, b.lo ), vaddq_u32( a.hi, b.hi ) );
+				}
+
+				static NST_FORCE_INLINE Vector Sub(const Vector& a,const Vector& b)
+				{
+					return Vector( vsubq_u32( a.lo, b.lo ), vsubq_u32( a.hi, b.hi ) );
+				}
+
+				static NST_FORCE_INLINE Vector And(const Vector& a,const Vector& b)
+				{
+					return Vector( vandq_u32( a.lo, b.lo ), vandq_u32( a.hi, b.hi ) );
+				}
+
+				static NST_FORCE_INLINE Vector Or(const Vector& a,const Vector& b)
+				{
+					return Vector( vorrq_u32( a.lo, b.lo ), vorrq_u32( a.hi, b.hi ) );
+				}
+
+				template<int N>
+				static NST_FORCE_INLINE Vector Shr(const Vector& a)
+				{
+					return Vector( vshrq_n_u32( a.lo, N ), vshrq_n_u32( a.hi, N ) );
+				}
+
+				static NST_FORCE_INLINE void Store(dword* p,const Vector& v)
+				{
+					vst1q_u32( reinterpret_cast<uint32_t*>(p+0), v.lo );
+					vst1q_u32( reinterpret_cast<uint32_t*>(p+4), v.hi );
+				}
+
+				static NST_FORCE_INLINE void Store(word* p,const Vector& v)
+				{
+					vst1q_u16( reinterpret_cast<uint16_t*>(p), vcombine_u16( vmovn_u32( v.lo ), vmovn_u32( v.hi ) ) );
+				}
+			};
+
+			template<typename Pixel,uint BITS>
+			void Renderer::FilterNtsc::BlitNeon(const Input& input,const Output& output,uint phase,const uint first,const uint last) const
+			{
+				typedef Neon Lanes;
+
+				#include "NstVideoFilterNtsc.inl"
+			}
+
+			#endif
+
 			#ifdef NST_MSVC_OPTIMIZE
 			#pragma optimize("s", on)
 			#endif
 
+			#ifdef NST_NTSC_AVX2
+
+			bool Renderer::FilterNtsc::HasAvx2()
+			{
+			#if NST_MSVC
+				int info[4];
+
+				__cpuid( info, 0 );
+
+				if (info[0] < 7)
+					return false;
+
+				// AVX and OSXSAVE, then the OS must be saving the YMM registers
+
+				__cpuid( info, 1 );
+
+				if ((info[2] & 0x18000000) != 0x18000000 || (_xgetbv( 0 ) & 0x6) != 0x6)
+					return false;
+
+				__cpuidex( info, 7, 0 );
+
+				return (info[1] & 0x20) != 0;
+			#else
+				__builtin_cpu_init();
+
+				return __builtin_cpu_supports( "avx2" );
+			#endif
+			}
+
+			#endif
+
+			bool Renderer::FilterNtsc::HasPath(const uint path)
+			{
+				switch (path)
+				{
+					case Api::Video::NTSC_PATH_DEFAULT:
+					case Api::Video::NTSC_PATH_SCALAR:
+
+						return true;
+
+				#ifdef NST_NTSC_SSE2
+					case Api::Video::NTSC_PATH_SSE2:
+
+						return true;
+				#endif
+
+				#ifdef NST_NTSC_AVX2
+					case Api::Video::NTSC_PATH_AVX2:
+
+						return HasAvx2();
+				#endif
+
+				#ifdef NST_NTSC_NEON
+					case Api::Video::NTSC_PATH_NEON:
+
+						return true;
+				#endif
+				}
+
+				return false;
+			}
+
+			Renderer::NtscPath Renderer::FilterNtsc::SelectPath(const uint path)
+			{
+				if (path != Api::Video::NTSC_PATH_DEFAULT && HasPath( path ))
+					return static_cast<NtscPath>(path);
+
+			#if defined(NST_NTSC_AVX2)
+				if (HasAvx2())
+					return Api::Video::NTSC_PATH_AVX2;
+			#endif
+
+			#if defined(NST_NTSC_SSE2)
+				return Api::Video::NTSC_PATH_SSE2;
+			#elif defined(NST_NTSC_NEON)
+				return Api::Video::NTSC_PATH_NEON;
+			#else
+				return Api::Video::NTSC_PATH_SCALAR;
+			#endif
+			}
+
+			template<typename Pixel,uint BITS>
+			Renderer::FilterNtsc::Path Renderer::FilterNtsc::GetPath(const uint path)
+			{
+				switch (SelectPath( path ))
+				{
+				#ifdef NST_NTSC_AVX2
+					case Api::Video::NTSC_PATH_AVX2:
+
+						return &FilterNtsc::BlitAvx2<Pixel,BITS>;
+				#endif
+
+				#ifdef NST_NTSC_SSE2
+					case Api::Video::NTSC_PATH_SSE2:
+
+						return &FilterNtsc::BlitSse2<Pixel,BITS>;
+				#endif
+
+				#ifdef NST_NTSC_NEON
+					case Api::Video::NTSC_PATH_NEON:
+
+						return &FilterNtsc::BlitNeon<Pixel,BITS>;
+				#endif
+
+					default:
+
+						return &FilterNtsc::BlitType<Pixel,BITS>;
+				}
+			}
+
 			bool Renderer::FilterNtsc::Check(const RenderState& state)
 			{
 				return (state.width == NTSC_WIDTH && state.height == HEIGHT) &&
@@ -102,19 +457,19 @@ namespace Nes
 				);
 			}
 
-			Renderer::FilterNtsc::Path Renderer::FilterNtsc::GetPath(const RenderState& state,const Lut& lut)
+			Renderer::FilterNtsc::Path Renderer::FilterNtsc::GetPath(const RenderState& state,const uint path)
 			{
 				if (state.bits.count == 32)
 				{
-					return &FilterNtsc::BlitType<dword,32>;
+					return GetPath<dword,32>( path );
 				}
 				else if (state.bits.mask.g == 0x07E0)
 				{
-					return &FilterNtsc::BlitType<word,16>;
+					return GetPath<word,16>( path );
 				}
 				else
 				{
-					return &FilterNtsc::BlitType<word,15>;
+					return GetPath<word,15>( path );
 				}
 			}
 
@@ -171,6 +526,22 @@ namespace Nes
 				setup.base_palette = NULL;
 
 				::nes_ntsc_init( this, &setup );
+
+			#ifdef NST_NTSC_LANES
+				for (uint burst=0; burst < nes_ntsc_burst_count; ++burst)
+				{
+					for (uint color=0; color < PALETTE; ++color)
+					{
+						uint i = 0;
+
+						for (; i < nes_ntsc_burst_size; ++i)
+							lanes[burst][color][i] = dword(table[color][burst * nes_ntsc_burst_size + i]);
+
+						for (; i < LANE_ENTRIES; ++i)
+							lanes[burst][color][i] = 0;
+					}
+				}
+			#endif
 			}
 
 			Renderer::FilterNtsc::FilterNtsc
@@ -182,11 +553,12 @@ namespace Nes
 				schar bleed,
 				schar artifacts,
 				schar fringing,
-				bool fieldMerging
+				bool fieldMerging,
+				uint ntscPath
 			)
 			:
 			Filter (state),
-			path   (GetPath(state,lut)),
+			path   (GetPath(state,ntscPath)),
 			lut    (palette,sharpness,resolution,bleed,artifacts,fringing,fieldMerging)
 			{
 			}
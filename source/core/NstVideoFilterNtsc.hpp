@@ -31,6 +31,19 @@
 #pragma once
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define NST_NTSC_SSE2
+ #if NST_MSVC >= 1800 || NST_GCC >= 409 || defined(__clang__)
+ #define NST_NTSC_AVX2
+ #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #define NST_NTSC_NEON
+#endif
+
+				#if defined(NST_NTSC_SSE2) || defined(NST_NTSC_NEON)
+#define NST_NTSC_LANES
+#endif
+
 namespace Nes
 {
 	namespace Core
@@ -41,9 +54,11 @@ namespace Nes
 			{
 			public:
 
-				FilterNtsc(const RenderState&,const byte (&)[PALETTE][3],schar,schar,schar,schar,schar,bool);
+				FilterNtsc(const RenderState&,const byte (&)[PALETTE][3],schar,schar,schar,schar,schar,bool,uint);
 
 				static bool Check(const RenderState&);
+				static bool HasPath(uint);
+				static NtscPath SelectPath(uint);
 
 			private:
 
@@ -54,12 +69,39 @@ namespace Nes
 					NTSC_WIDTH = 602
 				};
 
-				typedef void (FilterNtsc::*Path)(const Input&,const Output&,uint) const;
+				typedef void (FilterNtsc::*Path)(const Input&,const Output&,uint,uint,uint) const;
 
 				void Blit(const Input&,const Output&,uint);
+				void BlitRows(const Input&,const Output&,uint,uint,uint);
+				bool CanBlitRows(const Input&) const;
 
 				template<typename T,uint BITS>
-				void BlitType(const Input&,const Output&,uint) const;
+				void BlitType(const Input&,const Output&,uint,uint,uint) const;
+
+				// vector versions of BlitType, computing seven output pixels per step
+
+				#ifdef NST_NTSC_SSE2
+				struct Sse2;
+
+				template<typename T,uint BITS>
+				void BlitSse2(const Input&,const Output&,uint,uint,uint) const;
+				#endif
+
+				#ifdef NST_NTSC_AVX2
+				struct Avx2;
+
+				template<typename T,uint BITS>
+				void BlitAvx2(const Input&,const Output&,uint,uint,uint) const;
+
+				static bool HasAvx2();
+				#endif
+
+				#ifdef NST_NTSC_NEON
+				struct Neon;
+
+				template<typename T,uint BITS>
+				void BlitNeon(const Input&,const Output&,uint,uint,uint) const;
+				#endif
 
 				class Lut : public nes_ntsc_t
 				{
@@ -76,9 +118,26 @@ namespace Nes
 
 					const uint noFieldMerging;
 					const uint black;
+
+					#ifdef NST_NTSC_LANES
+
+					enum
+					{
+						LANE_ENTRIES = 48
+					};
+
+					// low 32 bits of each burst's kernel entries, padded so
+					// that eight lanes can be loaded from any of them
+
+					dword lanes[nes_ntsc_burst_count][PALETTE][LANE_ENTRIES];
+
+					#endif
 				};
 
-				static Path GetPath(const RenderState&,const Lut&);
+				template<typename T,uint BITS>
+				static Path GetPath(uint);
+
+				static Path GetPath(const RenderState&,uint);
 
 				const Path path;
 				const Lut lut;
@@ -0,0 +1,164 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2003-2008 Martin Freij
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+// Body of the vector blitters, included once per instruction set with Lanes
+// naming the set. Output pixel x of a step sums entries of the kernels of
+// the last three triplets of input pixels, offset so that one eight lane
+// load per kernel lines them up with x (the eighth lane is scrap).
+
+NST_ASSERT( phase < 3 );
+
+static const dword masks[4][8] =
+{
+	{   0U,   0U, ~0U, ~0U, ~0U, ~0U, ~0U, 0U },
+	{  ~0U,  ~0U,  0U,  0U,  0U,  0U,  0U, 0U },
+	{   0U,   0U,  0U,  0U, ~0U, ~0U, ~0U, 0U },
+	{  ~0U,  ~0U, ~0U, ~0U,  0U,  0U,  0U, 0U }
+};
+
+const Lanes::Vector mask1( Lanes::Load( masks[0] ) );
+const Lanes::Vector mask1x( Lanes::Load( masks[1] ) );
+const Lanes::Vector mask2( Lanes::Load( masks[2] ) );
+const Lanes::Vector mask2x( Lanes::Load( masks[3] ) );
+const Lanes::Vector clampMask( Lanes::Set( nes_ntsc_clamp_mask ) );
+const Lanes::Vector clampAdd( Lanes::Set( nes_ntsc_clamp_add ) );
+
+const uint bgcolor = this->bgColor;
+const Input::Pixel* NST_RESTRICT src = input.pixels + first * WIDTH;
+Pixel* NST_RESTRICT dst = reinterpret_cast<Pixel*>(static_cast<byte*>(output.pixels) + output.pitch * long(first));
+const long pad = output.pitch - (NTSC_WIDTH-7) * sizeof(Pixel);
+
+phase = ((phase & lut.noFieldMerging) + first) % 3;
+
+for (uint y=last-first; y; --y)
+{
+	const dword (*const NST_RESTRICT kernels)[Lut::LANE_ENTRIES] = lut.lanes[phase];
+
+	const dword* kernelx0 = kernels[bgcolor];
+	const dword* kernelx1 = kernels[bgcolor];
+	const dword* kernelx2 = kernels[*src++];
+	const dword* kernelxx1 = kernels[bgcolor];
+	const dword* kernelxx2 = kernels[bgcolor];
+
+	// the last step of a line is fed with the background color
+
+	for (uint x=NTSC_WIDTH/7; x; --x)
+	{
+		const dword* kernel0;
+		const dword* kernel1;
+		const dword* kernel2;
+
+		if (x != 1)
+		{
+			kernel0 = kernels[src[0]];
+			kernel1 = kernels[src[1]];
+			kernel2 = kernels[src[2]];
+			src += 3;
+		}
+		else
+		{
+			kernel0 = kernel1 = kernel2 = kernels[bgcolor];
+		}
+
+		Lanes::Vector raw
+		(
+			Lanes::Add
+			(
+				Lanes::Add
+				(
+					Lanes::Add( Lanes::Load( kernel0 + 0 ), Lanes::Load( kernelx0 + 7 ) ),
+					Lanes::Add( Lanes::Load( kernelx1 + 19 ), Lanes::Load( kernelx2 + 31 ) )
+				),
+				Lanes::Add
+				(
+					Lanes::Add( Lanes::And( Lanes::Load( kernel1 + 12 ), mask1 ), Lanes::And( Lanes::Load( kernelxx1 + 26 ), mask1x ) ),
+					Lanes::Add( Lanes::And( Lanes::Load( kernel2 + 24 ), mask2 ), Lanes::And( Lanes::Load( kernelxx2 + 38 ), mask2x ) )
+				)
+			)
+		);
+
+		kernelxx1 = kernelx1;
+		kernelxx2 = kernelx2;
+		kernelx0 = kernel0;
+		kernelx1 = kernel1;
+		kernelx2 = kernel2;
+
+		{
+			const Lanes::Vector sub( Lanes::And( Lanes::Shr<9>( raw ), clampMask ) );
+			Lanes::Vector clamp( Lanes::Sub( clampAdd, sub ) );
+
+			raw = Lanes::Or( raw, clamp );
+			clamp = Lanes::Sub( clamp, sub );
+			raw = Lanes::And( raw, clamp );
+		}
+
+		Lanes::Vector rgb;
+
+		if (BITS == 32)
+		{
+			rgb = Lanes::Or
+			(
+				Lanes::Or( Lanes::And( Lanes::Shr<5>( raw ), Lanes::Set( 0xFF0000 ) ), Lanes::And( Lanes::Shr<3>( raw ), Lanes::Set( 0x00FF00 ) ) ),
+				Lanes::And( Lanes::Shr<1>( raw ), Lanes::Set( 0x0000FF ) )
+			);
+		}
+		else if (BITS == 16)
+		{
+			rgb = Lanes::Or
+			(
+				Lanes::Or( Lanes::And( Lanes::Shr<13>( raw ), Lanes::Set( 0xF800 ) ), Lanes::And( Lanes::Shr<8>( raw ), Lanes::Set( 0x07E0 ) ) ),
+				Lanes::And( Lanes::Shr<4>( raw ), Lanes::Set( 0x001F ) )
+			);
+		}
+		else
+		{
+			rgb = Lanes::Or
+			(
+				Lanes::Or( Lanes::And( Lanes::Shr<14>( raw ), Lanes::Set( 0x7C00 ) ), Lanes::And( Lanes::Shr<9>( raw ), Lanes::Set( 0x03E0 ) ) ),
+				Lanes::And( Lanes::Shr<4>( raw ), Lanes::Set( 0x001F ) )
+			);
+		}
+
+		// all eight lanes can be stored except at the end of the line,
+		// the scrap one lands where the next step writes
+
+		if (x != 1)
+		{
+			Lanes::Store( dst, rgb );
+			dst += 7;
+		}
+		else
+		{
+			Pixel tail[8];
+			Lanes::Store( tail, rgb );
+
+			for (uint i=0; i < 7; ++i)
+				dst[i] = tail[i];
+		}
+	}
+
+	dst = reinterpret_cast<Pixel*>(reinterpret_cast<byte*>(dst) + pad);
+
+	phase = (phase + 1) % 3;
+}
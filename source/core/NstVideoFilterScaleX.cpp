@@ -38,7 +38,22 @@ namespace Nes
 		{
 			void Renderer::FilterScaleX::Blit(const Input& input,const Output& output,uint)
 			{
-				path( input, output );
+				path( input, output, 0, HEIGHT );
+			}
+
+			void Renderer::FilterScaleX::BlitRows(const Input& input,const Output& output,uint,uint first,uint last)
+			{
+				path( input, output, first, last );
+			}
+
+			bool Renderer::FilterScaleX::CanBlitRows(const Input&) const
+			{
+				return true;
+			}
+
+			uint Renderer::FilterScaleX::GetRowContext() const
+			{
+				return 1;
 			}
 
 			template<typename T,int PREV,int NEXT>
@@ -196,33 +211,39 @@ namespace Nes
 			}
 
 			template<typename T>
-			void Renderer::FilterScaleX::Blit2x(const Input& input,const Output& output)
+			void Renderer::FilterScaleX::Blit2x(const Input& input,const Output& output,const uint first,const uint last)
 			{
-				const Input::Pixel* src = input.pixels;
-				T* dst = static_cast<T*>(output.pixels);
+				const Input::Pixel* src = input.pixels + first * WIDTH;
+				T* dst = reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch * long(first * 2));
 				const long pad = output.pitch - long(sizeof(T) * WIDTH*2);
 
-				dst = Blit2xLine<T,0,WIDTH>( dst, src, input.palette, pad );
-
-				for (uint y=HEIGHT-2; y; --y)
-					dst = Blit2xLine<T,-WIDTH,WIDTH>( dst, src += WIDTH, input.palette, pad );
-
-				Blit2xLine<T,-WIDTH,0>( dst, src + WIDTH, input.palette, pad );
+				for (uint y=first; y < last; ++y, src += WIDTH)
+				{
+					if (!y)
+						dst = Blit2xLine<T,0,WIDTH>( dst, src, input.palette, pad );
+					else if (y < HEIGHT-1)
+						dst = Blit2xLine<T,-WIDTH,WIDTH>( dst, src, input.palette, pad );
+					else
+						dst = Blit2xLine<T,-WIDTH,0>( dst, src, input.palette, pad );
+				}
 			}
 
 			template<typename T>
-			void Renderer::FilterScaleX::Blit3x(const Input& input,const Output& output)
+			void Renderer::FilterScaleX::Blit3x(const Input& input,const Output& output,const uint first,const uint last)
 			{
-				const Input::Pixel* src = input.pixels;
-				T* dst = static_cast<T*>(output.pixels);
+				const Input::Pixel* src = input.pixels + first * WIDTH;
+				T* dst = reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch * long(first * 3));
 				const long pad = output.pitch - long(sizeof(T) * WIDTH*3);
 
-				dst = Blit3xLine<T,0,WIDTH>( dst, src, input.palette, pad );
-
-				for (uint y=HEIGHT-2; y; --y)
-					dst = Blit3xLine<T,-WIDTH,WIDTH>( dst, src += WIDTH, input.palette, pad );
-
-				Blit3xLine<T,-WIDTH,0>( dst, src + WIDTH, input.palette, pad );
+				for (uint y=first; y < last; ++y, src += WIDTH)
+				{
+					if (!y)
+						dst = Blit3xLine<T,0,WIDTH>( dst, src, input.palette, pad );
+					else if (y < HEIGHT-1)
+						dst = Blit3xLine<T,-WIDTH,WIDTH>( dst, src, input.palette, pad );
+					else
+						dst = Blit3xLine<T,-WIDTH,0>( dst, src, input.palette, pad );
+				}
 			}
 
 			#ifdef NST_MSVC_OPTIMIZE
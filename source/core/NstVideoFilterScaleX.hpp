@@ -48,11 +48,14 @@ namespace Nes
 
 				~FilterScaleX() {}
 
-				typedef void (*Path)(const Input&,const Output&);
+				typedef void (*Path)(const Input&,const Output&,uint,uint);
 
 				static Path GetPath(const RenderState&);
 
 				void Blit(const Input&,const Output&,uint);
+				void BlitRows(const Input&,const Output&,uint,uint,uint);
+				bool CanBlitRows(const Input&) const;
+				uint GetRowContext() const;
 
 				template<typename T,int PREV,int NEXT>
 				static NST_FORCE_INLINE T* Blit2xBorder(T* NST_RESTRICT,const Input::Pixel* NST_RESTRICT,const Input::Palette&);
@@ -70,10 +73,10 @@ namespace Nes
 				static NST_FORCE_INLINE T* Blit3xLine(T*,const Input::Pixel*,const Input::Palette&,long);
 
 				template<typename T>
-				static void Blit2x(const Input&,const Output&);
+				static void Blit2x(const Input&,const Output&,uint,uint);
 
 				template<typename T>
-				static void Blit3x(const Input&,const Output&);
+				static void Blit3x(const Input&,const Output&,uint,uint);
 
 				const Path path;
 			};
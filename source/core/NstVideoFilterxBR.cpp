@@ -252,7 +252,7 @@ namespace Nes
 			 * 4x filtering, with blend support
 			 */
 			template<typename T, dword R_MASK, dword R_SHIFT, dword G_MASK, dword G_SHIFT, dword B_MASK, dword B_SHIFT, bool BLEND, bool ALL, bool SOME, bool NONE>
-			void Renderer::FilterxBR::Xbr4X(const Input& input,const Output& output)
+			void Renderer::FilterxBR::Xbr4X(const Input& input,const Output& output,const uint first,const uint last)
 			{
 				#pragma region Sets up pointers to source pixels
 
@@ -263,15 +263,18 @@ namespace Nes
 				//Size of a raster line in output
 				const long pitch = (output.pitch * 3) + output.pitch - (WIDTH*4 * sizeof(T));
 
+				//First output line of the band of source lines to filter
+				byte* const dst0 = static_cast<byte*>(output.pixels) + output.pitch * long(first * 4);
+
 				//Creates a non-aliased array with four enteries. First is the destination pixels
 				//cast into the type of pointer this function has been templated to use, the others
 				//points at the start of the next three lines. 
 				T* NST_RESTRICT dst[4] =
 				{
-					static_cast<T*>(output.pixels),
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch),
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch * 2),
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch * 3)
+					reinterpret_cast<T*>(dst0),
+					reinterpret_cast<T*>(dst0 + output.pitch),
+					reinterpret_cast<T*>(dst0 + output.pitch * 2),
+					reinterpret_cast<T*>(dst0 + output.pitch * 3)
 				};
 
 				//const long pad = output.pitch - long(sizeof(dword) * WIDTH);
@@ -279,7 +282,7 @@ namespace Nes
 
 				#pragma endregion
 
-				for (int y=0; y < MAX_PIXELS; y += WIDTH)
+				for (int y=first*WIDTH; y < int(last*WIDTH); y += WIDTH)
 				{
 					#pragma region Clamps y coords
 
@@ -390,7 +393,7 @@ namespace Nes
 			 * 3x filtering, with blend support
 			 */
 			template<typename T, dword R_MASK, dword R_SHIFT, dword G_MASK, dword G_SHIFT, dword B_MASK, dword B_SHIFT, bool BLEND, bool ALL, bool SOME, bool NONE>
-			void Renderer::FilterxBR::Xbr3X(const Input& input,const Output& output)
+			void Renderer::FilterxBR::Xbr3X(const Input& input,const Output& output,const uint first,const uint last)
 			{
 				#pragma region Sets up pointers to source pixels
 
@@ -401,14 +404,17 @@ namespace Nes
 				//Size of a raster line in output
 				const long pitch = (output.pitch * 2) + output.pitch - (WIDTH*3 * sizeof(T));
 
+				//First output line of the band of source lines to filter
+				byte* const dst0 = static_cast<byte*>(output.pixels) + output.pitch * long(first * 3);
+
 				//Creates a non-aliased array with three enteries. First is the destination pixels
 				//cast into the type of pointer this function has been templated to use, the others
 				//points at the start of the next two lines.
 				T* NST_RESTRICT dst[3] =
 				{
-					static_cast<T*>(output.pixels),
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch),
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + output.pitch * 2)
+					reinterpret_cast<T*>(dst0),
+					reinterpret_cast<T*>(dst0 + output.pitch),
+					reinterpret_cast<T*>(dst0 + output.pitch * 2)
 				};
 
 				//const long pad = output.pitch - long(sizeof(dword) * WIDTH);
@@ -416,7 +422,7 @@ namespace Nes
 
 				#pragma endregion
 
-				for (int y=0; y < MAX_PIXELS; y += WIDTH)
+				for (int y=first*WIDTH; y < int(last*WIDTH); y += WIDTH)
 				{
 					#pragma region Clamps y coords
 
@@ -522,7 +528,7 @@ namespace Nes
 			 * Implements 2xBR
 			 */
 			template<typename T, dword R_MASK, dword R_SHIFT, dword G_MASK, dword G_SHIFT, dword B_MASK, dword B_SHIFT, bool BLEND, bool ALL, bool SOME, bool NONE>
-			void Renderer::FilterxBR::Xbr2X(const Input& input,const Output& output)
+			void Renderer::FilterxBR::Xbr2X(const Input& input,const Output& output,const uint first,const uint last)
 			{
 				#pragma region Sets up pointers to source pixels
 
@@ -533,20 +539,23 @@ namespace Nes
 				//Size of a raster line in output
 				const long pitch = output.pitch;
 
+				//First output line of the band of source lines to filter
+				byte* const dst0 = static_cast<byte*>(output.pixels) + output.pitch * long(first * 2);
+
 				//Creates a non-aliased array with two enteries. First is the destination pixels
 				//cast into the type of pointer this function has been templated to use, the other
 				//points at the start of the next line.
 				T* NST_RESTRICT dst[2] =
 				{
-					static_cast<T*>(output.pixels),
-					reinterpret_cast<T*>(static_cast<byte*>(output.pixels) + pitch)
+					reinterpret_cast<T*>(dst0),
+					reinterpret_cast<T*>(dst0 + pitch)
 				};
 				//const long pad = output.pitch - long(sizeof(dword) * WIDTH);
 				const uint MAX_PIXELS = WIDTH * HEIGHT;
 
 				#pragma endregion
 
-				for (int y=0; y < MAX_PIXELS; y += WIDTH)
+				for (int y=first*WIDTH; y < int(last*WIDTH); y += WIDTH)
 				{
 					#pragma region Clamps y coords
 
@@ -641,7 +650,22 @@ namespace Nes
 
 			void Renderer::FilterxBR::Blit(const Input& input,const Output& output,uint)
 			{
-				(*this.*path)( input, output );
+				(*this.*path)( input, output, 0, HEIGHT );
+			}
+
+			void Renderer::FilterxBR::BlitRows(const Input& input,const Output& output,uint,uint first,uint last)
+			{
+				(*this.*path)( input, output, first, last );
+			}
+
+			bool Renderer::FilterxBR::CanBlitRows(const Input&) const
+			{
+				return true;
+			}
+
+			uint Renderer::FilterxBR::GetRowContext() const
+			{
+				return 2;
 			}
 
 			#pragma region Kernels
@@ -50,20 +50,23 @@ namespace Nes
 				void freeCache() const;
 				void initCache() const;
 
-				typedef void (FilterxBR::*Path)(const Input&,const Output&);
+				typedef void (FilterxBR::*Path)(const Input&,const Output&,uint,uint);
 				static Path GetPath(const RenderState&, const bool blend, const schar corner_rounding);
 
 				void Blit(const Input&,const Output&,uint);
+				void BlitRows(const Input&,const Output&,uint,uint,uint);
+				bool CanBlitRows(const Input&) const;
+				uint GetRowContext() const;
 				void Transform(const byte (&)[PALETTE][3],Input::Palette&) const;
 
 				template<typename T, dword R_MASK, dword R_SHIFT, dword G_MASK, dword G_SHIFT, dword B_MASK, dword B_SHIFT, bool BLEND, bool ALL, bool SOME, bool NONE>
-					void Xbr4X(const Input&,const Output&);
+					void Xbr4X(const Input&,const Output&,uint,uint);
 
 				template<typename T, dword R_MASK, dword R_SHIFT, dword G_MASK, dword G_SHIFT, dword B_MASK, dword B_SHIFT, bool BLEND, bool ALL, bool SOME, bool NONE>
-					void Xbr3X(const Input&,const Output&);
+					void Xbr3X(const Input&,const Output&,uint,uint);
 
 				template<typename T, dword R_MASK, dword R_SHIFT, dword G_MASK, dword G_SHIFT, dword B_MASK, dword B_SHIFT, bool BLEND, bool ALL, bool SOME, bool NONE> 
-					void Xbr2X(const Input&,const Output&);
+					void Xbr2X(const Input&,const Output&,uint,uint);
 
 				template<dword R_MASK, dword R_SHIFT, dword G_MASK, dword G_SHIFT, dword B_MASK, dword B_SHIFT, bool BLEND, bool ALL, bool SOME, bool NONE>
 				inline void Kernel2X(YUVPixel pe, YUVPixel pi, YUVPixel ph, YUVPixel pf, YUVPixel pg, 
@@ -33,12 +33,16 @@
 #include <cstring>
 #include <cmath>
 #include <new>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "NstCore.hpp"
 #include "NstAssert.hpp"
 #include "NstFpuPrecision.hpp"
 #include "api/NstApiVideo.hpp"
 #include "NstVideoRenderer.hpp"
 #include "NstVideoFilterNone.hpp"
+#include "NstWorkerPool.hpp"
 
 #ifndef NO_NTSC
 #include "NstVideoFilterNtsc.hpp"
@@ -525,6 +529,220 @@ namespace Nes
 				}
 			}
 
+			bool Renderer::Filter::CanBlitRows(const Input&) const
+			{
+				return false;
+			}
+
+			void Renderer::Filter::BlitRows(const Input&,const Output&,uint,uint,uint)
+			{
+				NST_UNREACHABLE();
+			}
+
+			uint Renderer::Filter::GetRowContext() const
+			{
+				return 0;
+			}
+
+			class Renderer::Blitter
+			{
+			public:
+
+				explicit Blitter(Renderer&);
+				~Blitter();
+
+				void Start(const Output&,const Input&,uint,uint);
+				void Wait();
+
+			private:
+
+				void Run();
+
+				Renderer& renderer;
+				std::mutex mutex;
+				std::condition_variable signal;
+				bool busy;
+				bool quit;
+				Output output;
+				uint phase;
+				uint bgColor;
+				Input screen;
+				std::thread thread;
+			};
+
+			Renderer::Blitter::Blitter(Renderer& r)
+			:
+			renderer (r),
+			busy     (false),
+			quit     (false),
+			phase    (0),
+			bgColor  (0),
+			thread   (&Blitter::Run,this)
+			{
+			}
+
+			Renderer::Blitter::~Blitter()
+			{
+				{
+					std::lock_guard<std::mutex> lock( mutex );
+					quit = true;
+				}
+
+				signal.notify_all();
+				thread.join();
+			}
+
+			void Renderer::Blitter::Start(const Output& o,const Input& input,const uint p,const uint c)
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+
+				NST_ASSERT( !busy );
+
+				// the frame is copied out so the core can go on with the next one
+
+				std::memcpy( screen.pixels, input.pixels, sizeof(screen.pixels) );
+				std::memcpy( screen.palette, input.palette, sizeof(screen.palette) );
+
+				output = o;
+				phase = p;
+				bgColor = c;
+				busy = true;
+
+				signal.notify_all();
+			}
+
+			void Renderer::Blitter::Wait()
+			{
+				std::unique_lock<std::mutex> lock( mutex );
+
+				while (busy)
+					signal.wait( lock );
+			}
+
+			void Renderer::Blitter::Run()
+			{
+				std::unique_lock<std::mutex> lock( mutex );
+
+				for (;;)
+				{
+					while (!busy && !quit)
+						signal.wait( lock );
+
+					if (!busy)
+						break;
+
+					lock.unlock();
+
+					if (renderer.indexed)
+						renderer.RenderIndexed( output, screen );
+					else
+						renderer.Render( output, screen, phase, bgColor );
+
+					lock.lock();
+
+					busy = false;
+					signal.notify_all();
+				}
+			}
+
+			class Renderer::DirtyRows
+			{
+			public:
+
+				DirtyRows();
+
+				uint Update(const Input&,const Output&,uint,uint,uint,bool);
+				bool Next(uint&,uint&) const;
+
+				void Invalidate()
+				{
+					valid = false;
+				}
+
+			private:
+
+				bool valid;
+				const void* pixels;
+				long pitch;
+				uint phase;
+				uint bgColor;
+				byte rows[HEIGHT];
+				Input::Palette palette;
+				Input::Pixel screen[PIXELS];
+			};
+
+			Renderer::DirtyRows::DirtyRows()
+			:
+			valid   (false),
+			pixels  (NULL),
+			pitch   (0),
+			phase   (0),
+			bgColor (0)
+			{
+				std::memset( rows, 1, sizeof(rows) );
+			}
+
+			uint Renderer::DirtyRows::Update(const Input& input,const Output& output,const uint p,const uint c,const uint context,const bool whole)
+			{
+				// anything but the lines themselves changing means the whole
+				// surface gets redrawn, a frame that can't be blitted in lines
+				// leaves nothing to compare the next one against
+
+				if
+				(
+					whole || !valid ||
+					pixels != output.pixels || pitch != output.pitch ||
+					phase != p || bgColor != c ||
+					std::memcmp( palette, input.palette, sizeof(palette) )
+				)
+				{
+					valid = !whole;
+					pixels = output.pixels;
+					pitch = output.pitch;
+					phase = p;
+					bgColor = c;
+
+					std::memcpy( palette, input.palette, sizeof(palette) );
+					std::memcpy( screen, input.pixels, sizeof(screen) );
+					std::memset( rows, 1, sizeof(rows) );
+
+					return HEIGHT;
+				}
+
+				std::memset( rows, 0, sizeof(rows) );
+
+				for (uint y=0; y < HEIGHT; ++y)
+				{
+					const Input::Pixel* const src = input.pixels + y * WIDTH;
+					Input::Pixel* const dst = screen + y * WIDTH;
+
+					if (std::memcmp( dst, src, WIDTH * sizeof(Input::Pixel) ))
+					{
+						std::memcpy( dst, src, WIDTH * sizeof(Input::Pixel) );
+
+						for (uint i=(y > context ? y - context : 0), n=NST_MIN(y + context + 1,uint(HEIGHT)); i < n; ++i)
+							rows[i] = 1;
+					}
+				}
+
+				uint count = 0;
+
+				for (uint y=0; y < HEIGHT; ++y)
+					count += rows[y];
+
+				return count;
+			}
+
+			bool Renderer::DirtyRows::Next(uint& first,uint& count) const
+			{
+				while (first < HEIGHT && !rows[first])
+					++first;
+
+				for (count=0; first + count < HEIGHT && rows[first + count]; ++count);
+
+				return count;
+			}
+
 			Renderer::State::State()
 			:
 			width        (0),
@@ -532,6 +750,7 @@ namespace Nes
 			filter       (RenderState::FILTER_NONE),
 			update       (UPDATE_PALETTE),
 			fieldMerging (0),
+			ntscPath     (Api::Video::NTSC_PATH_DEFAULT),
 			brightness   (0),
 			saturation   (0),
 			hue          (0),
@@ -551,6 +770,12 @@ namespace Nes
 
 			Renderer::Renderer()
 			:	filter(NULL),
+				pool(NULL),
+				bands(1),
+				blitter(NULL),
+				dirtyRows(NULL),
+				indexed(false),
+				paletteVersion(0),
 				enableCacheRenderedFrame(false),
 				cachedRenderedFrameFilter(NULL)
 			{
@@ -562,6 +787,9 @@ namespace Nes
 
 			Renderer::~Renderer()
 			{
+				delete blitter;
+				delete dirtyRows;
+				delete pool;
 				delete filter;
 				delete[] (byte*)cachedRenderedFrame.pixels;
 				delete cachedRenderedFrameFilter;
@@ -579,6 +807,8 @@ namespace Nes
 			}
 
 			Result Renderer::ResetState() {
+				Sync();
+
 				RenderState curState;
 				GetState(curState);
 
@@ -590,6 +820,10 @@ namespace Nes
 
 			Result Renderer::SetState(const RenderState& renderState)
 			{
+				// the pipelined blit may still be using the filter
+
+				Sync();
+
 				if (filter)
 				{
 					if
@@ -666,7 +900,8 @@ namespace Nes
 									state.bleed,
 									state.artifacts,
 									state.fringing,
-									state.fieldMerging
+									state.fieldMerging,
+									state.ntscPath
 								);
 							}
 							break;
@@ -708,6 +943,9 @@ namespace Nes
 					else
 						state.update |= uint(State::UPDATE_FILTER);
 
+					if (dirtyRows)
+						dirtyRows->Invalidate();
+
 					return RESULT_OK;
 				}
 				else
@@ -756,6 +994,33 @@ namespace Nes
 					state.update |= uint(State::UPDATE_NTSC);
 			}
 
+			Result Renderer::SetNtscPath(NtscPath path)
+			{
+			#ifndef NO_NTSC
+				if (!FilterNtsc::HasPath( path ))
+					return RESULT_ERR_UNSUPPORTED;
+
+				if (state.ntscPath == path)
+					return RESULT_NOP;
+
+				state.ntscPath = path;
+				state.update |= uint(State::UPDATE_NTSC);
+
+				return RESULT_OK;
+			#else
+				return RESULT_ERR_UNSUPPORTED;
+			#endif
+			}
+
+			Renderer::NtscPath Renderer::GetNtscPath() const
+			{
+			#ifndef NO_NTSC
+				return FilterNtsc::SelectPath( state.ntscPath );
+			#else
+				return Api::Video::NTSC_PATH_SCALAR;
+			#endif
+			}
+
 			Result Renderer::SetHue(int hue)
 			{
 				if (hue < -45 || hue > 45)
@@ -794,6 +1059,110 @@ namespace Nes
 				return result;
 			}
 
+			Result Renderer::SetBlitThreads(const uint count)
+			{
+				if (!count || count > MAX_BLIT_THREADS)
+					return RESULT_ERR_INVALID_PARAM;
+
+				if (count == bands)
+					return RESULT_NOP;
+
+				Sync();
+
+				delete pool;
+				pool = NULL;
+				bands = 1;
+
+				// one band per thread, the pool itself won't go past
+				// the number of cores and runs the rest in turn
+
+				if (count > 1)
+					pool = new WorkerPool( count - 1 );
+
+				bands = count;
+
+				return RESULT_OK;
+			}
+
+			uint Renderer::GetBlitThreads() const
+			{
+				return bands;
+			}
+
+			Result Renderer::EnablePipelining(const bool enable)
+			{
+				if (enable == bool(blitter))
+					return RESULT_NOP;
+
+				if (enable)
+				{
+					blitter = new Blitter( *this );
+				}
+				else
+				{
+					Sync();
+
+					delete blitter;
+					blitter = NULL;
+				}
+
+				return RESULT_OK;
+			}
+
+			Result Renderer::EnableDirtyRows(const bool enable)
+			{
+				if (enable == bool(dirtyRows))
+					return RESULT_NOP;
+
+				Sync();
+
+				if (enable)
+				{
+					dirtyRows = new DirtyRows;
+				}
+				else
+				{
+					delete dirtyRows;
+					dirtyRows = NULL;
+				}
+
+				return RESULT_OK;
+			}
+
+			bool Renderer::GetDirtyRows(uint& first,uint& count) const
+			{
+				if (dirtyRows)
+					return dirtyRows->Next( first, count );
+
+				// without tracking every blit draws all of them
+
+				count = first < HEIGHT ? HEIGHT - first : 0;
+
+				return count;
+			}
+
+			Result Renderer::EnableIndexedOutput(const bool enable)
+			{
+				if (enable == indexed)
+					return RESULT_NOP;
+
+				Sync();
+
+				indexed = enable;
+
+				if (dirtyRows)
+					dirtyRows->Invalidate();
+
+				return RESULT_OK;
+			}
+
+			dword Renderer::GetPaletteVersion()
+			{
+				GetPalette();
+
+				return paletteVersion;
+			}
+
 			Result Renderer::SetPaletteType(PaletteType type)
 			{
 				const Result result = palette.SetType( type );
@@ -826,6 +1195,7 @@ namespace Nes
 				{
 					state.update &= ~uint(State::UPDATE_PALETTE);
 					palette.Update( state.brightness, state.saturation, state.contrast, state.hue );
+					++paletteVersion;
 				}
 
 				return palette.Get();
@@ -850,6 +1220,9 @@ namespace Nes
 					filter->Transform( GetPalette(), input.palette );
 				}
 
+				if (dirtyRows)
+					dirtyRows->Invalidate();
+
 				state.update = 0;
 			}
 
@@ -857,24 +1230,113 @@ namespace Nes
 			#pragma optimize("", on)
 			#endif
 
-			void Renderer::Blit(Output& output,Input& input,uint burstPhase)
+			void Renderer::Render(Output& output,const Input& input,const uint burstPhase,const uint background)
 			{
-				if (filter)
+				if (Output::lockCallback( output ))
 				{
-					if (state.update)
-						UpdateFilter( input );
+					NST_VERIFY( std::labs(output.pitch) >= dword(state.width) << (filter->format.bpp / 16) );
 
-					if (Output::lockCallback( output ))
-					{
-						NST_VERIFY( std::labs(output.pitch) >= dword(state.width) << (filter->format.bpp / 16) );
-						
-						filter->bgColor = bgColor;
+					filter->bgColor = background;
 
-						if (std::labs(output.pitch) >= dword(state.width) << (filter->format.bpp / 16))
+					if (std::labs(output.pitch) >= dword(state.width) << (filter->format.bpp / 16))
+					{
+						// the burst phase only shows in NTSC output with unmerged fields
+
+						const uint rows = dirtyRows ? dirtyRows->Update
+						(
+							input,
+							output,
+							state.filter == RenderState::FILTER_NTSC && !state.fieldMerging ? burstPhase : 0,
+							background,
+							filter->GetRowContext(),
+							!filter->CanBlitRows( input )
+						) : HEIGHT;
+
+						if (rows < HEIGHT)
+						{
+							for (uint first=0, count; dirtyRows->Next( first, count ); first += count)
+								filter->BlitRows( input, output, burstPhase, first, first + count );
+						}
+						else if (pool && filter->CanBlitRows( input ))
+						{
+							pool->Run( bands, [&](uint band)
+							{
+								filter->BlitRows( input, output, burstPhase, HEIGHT * band / bands, HEIGHT * (band+1) / bands );
+							});
+						}
+						else
+						{
 							filter->Blit( input, output, burstPhase );
+						}
+					}
+
+					Output::unlockCallback( output );
+				}
+			}
 
-						Output::unlockCallback( output );
+			void Renderer::RenderIndexed(Output& output,const Input& input)
+			{
+				// a surface left out gets the screen itself, sparing the copy
+
+				const bool lent = !output.pixels;
+
+				if (lent)
+				{
+					output.pixels = const_cast<Input::Pixel*>(input.pixels);
+					output.pitch = WIDTH * sizeof(Input::Pixel);
+				}
+
+				if (Output::lockCallback( output ))
+				{
+					if (dirtyRows)
+						dirtyRows->Update( input, output, 0, 0, 0, false );
+
+					if (output.pixels != input.pixels && std::labs(output.pitch) >= long(WIDTH * sizeof(Input::Pixel)))
+					{
+						for (uint first=0, count; GetDirtyRows( first, count ); first += count)
+						{
+							for (uint y=first; y < first + count; ++y)
+								std::memcpy( static_cast<byte*>(output.pixels) + output.pitch * long(y), input.pixels + y * WIDTH, WIDTH * sizeof(Input::Pixel) );
+						}
 					}
+
+					Output::unlockCallback( output );
+				}
+
+				if (lent)
+				{
+					output.pixels = NULL;
+					output.pitch = 0;
+				}
+			}
+
+			bool Renderer::Prepare(Input& input)
+			{
+				if (indexed)
+				{
+					// brings the palette and its version up to date for the callbacks
+
+					GetPalette();
+
+					return true;
+				}
+
+				if (filter && state.update)
+					UpdateFilter( input );
+
+				return filter;
+			}
+
+			void Renderer::Blit(Output& output,Input& input,uint burstPhase)
+			{
+				Sync();
+
+				if (Prepare( input ))
+				{
+					if (indexed)
+						RenderIndexed( output, input );
+					else
+						Render( output, input, burstPhase, bgColor );
 				}
 
 				// LHQ: cache rendered frame (no filtering), useful for sending frame to remote client
@@ -884,6 +1346,25 @@ namespace Nes
 					this->cachedRenderedFrameFilter->Blit(input, this->cachedRenderedFrame, burstPhase);
 				}
 			}
+
+			void Renderer::BlitAsync(const Output& output,Input& input,uint burstPhase)
+			{
+				NST_ASSERT( blitter );
+
+				blitter->Wait();
+
+				// palette and filter changes go into the screen of the
+				// caller so they stick once the pipeline is switched off
+
+				if (Prepare( input ))
+					blitter->Start( output, input, burstPhase, bgColor );
+			}
+
+			void Renderer::Sync()
+			{
+				if (blitter)
+					blitter->Wait();
+			}
 		}
 	}
 }
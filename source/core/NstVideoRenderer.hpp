@@ -38,12 +38,15 @@ namespace Nes
 {
 	namespace Core
 	{
+		class WorkerPool;
+
 		namespace Video
 		{
 			class Renderer
 			{
 				typedef Api::Video::RenderState RenderState;
 				typedef Api::Video::Decoder Decoder;
+				typedef Api::Video::NtscPath NtscPath;
 				typedef Screen Input;
 
 			public:
@@ -76,6 +79,8 @@ namespace Nes
 				Result GetState(RenderState&) const;
 				Result SetHue(int);
 				void Blit(Output&,Input&,uint);
+				void BlitAsync(const Output&,Input&,uint);
+				void Sync();
 
 				// LHQ: get cached result of Blit() method. Valid if EnableRenderedFrameCaching(true) was called
 				// The cached result is unfiltered rendered. And each pixel is RGB 32 bits.
@@ -83,6 +88,13 @@ namespace Nes
 				uint GetCachedRenderedFrameSize() const;
 
 				Result SetDecoder(const Decoder&);
+				Result SetBlitThreads(uint);
+				uint   GetBlitThreads() const;
+				Result EnablePipelining(bool);
+				Result EnableDirtyRows(bool);
+				bool   GetDirtyRows(uint&,uint&) const;
+				Result EnableIndexedOutput(bool);
+				dword  GetPaletteVersion();
 
 				Result SetPaletteType(PaletteType);
 				Result LoadCustomPalette(const byte (*)[3],bool);
@@ -91,13 +103,19 @@ namespace Nes
 				void EnableFieldMerging(bool);
 				void EnableForcedFieldMerging(bool);
 
+				Result   SetNtscPath(NtscPath);
+				NtscPath GetNtscPath() const;
+
 				typedef byte PaletteEntries[PALETTE][3];
 
 				const PaletteEntries& GetPalette();
 
 			private:
 
+				bool Prepare(Input&);
 				void UpdateFilter(Input&);
+				void Render(Output&,const Input&,uint,uint);
+				void RenderIndexed(Output&,const Input&);
 
 				class Palette
 				{
@@ -167,6 +185,8 @@ namespace Nes
 					}
 				};
 
+				class Blitter;
+				class DirtyRows;
 				class FilterNone;
 				class FilterNtsc;
 
@@ -208,6 +228,16 @@ namespace Nes
 					virtual void Blit(const Input&,const Output&,uint) = 0;
 					virtual void Transform(const byte (&)[PALETTE][3],Input::Palette&) const;
 
+					// filters whose lines only depend on the input can render
+					// a band of them at a time, letting a pool split a frame
+
+					virtual bool CanBlitRows(const Input&) const;
+					virtual void BlitRows(const Input&,const Output&,uint,uint,uint);
+
+					// lines of input on either side of a line that also go into its output
+
+					virtual uint GetRowContext() const;
+
 					const Format format;
 					
 					uint bgColor;
@@ -232,6 +262,7 @@ namespace Nes
 					byte filter;
 					byte update;
 					byte fieldMerging;
+					byte ntscPath;
 					schar brightness;
 					schar saturation;
 					schar hue;
@@ -248,7 +279,18 @@ namespace Nes
 
 				Result SetLevel(schar&,int,uint=State::UPDATE_PALETTE|State::UPDATE_FILTER);
 
+				enum
+				{
+					MAX_BLIT_THREADS = 16
+				};
+
 				Filter* filter;
+				WorkerPool* pool;
+				uint bands;
+				Blitter* blitter;
+				DirtyRows* dirtyRows;
+				bool indexed;
+				dword paletteVersion;
 				State state;
 				Palette palette;
 
@@ -406,6 +448,21 @@ namespace Nes
 				{
 					return filter;
 				}
+
+				bool IsPipelined() const
+				{
+					return blitter;
+				}
+
+				bool IsTrackingDirtyRows() const
+				{
+					return dirtyRows;
+				}
+
+				bool IsIndexed() const
+				{
+					return indexed;
+				}
 			};
 		}
 	}
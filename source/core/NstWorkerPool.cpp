@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#include "NstWorkerPool.hpp"
+
+namespace Nes {
+	namespace Core {
+		WorkerPool::WorkerPool(uint maxThreads)
+			: m_job(NULL), m_numJobs(0), m_nextJob(0), m_unfinishedJobs(0), m_quit(false)
+		{
+			uint hardwareThreads = std::thread::hardware_concurrency();
+			uint numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+			if (numThreads > maxThreads)
+				numThreads = maxThreads;
+
+			//reserve first so that a started thread is never dropped by a failed push_back
+			m_threads.reserve(numThreads);
+
+			try {
+				for (uint i = 0; i < numThreads; ++i)
+					m_threads.emplace_back(&WorkerPool::WorkerLoop, this);
+			}
+			catch (...) {
+				//std::thread throws std::system_error if it cannot start one, stop the ones already running
+				Stop();
+				throw;
+			}
+		}
+
+		WorkerPool::~WorkerPool()
+		{
+			Stop();
+		}
+
+		void WorkerPool::Stop()
+		{
+			{
+				std::lock_guard<std::mutex> lg(m_lock);
+				m_quit = true;
+				m_jobCv.notify_all();
+			}
+
+			for (auto& thread : m_threads)
+				thread.join();
+		}
+
+		void WorkerPool::Run(uint numJobs, const std::function<void(uint)>& job)
+		{
+			if (m_threads.empty() || numJobs < 2)
+			{
+				for (uint i = 0; i < numJobs; ++i)
+					job(i);
+				return;
+			}
+
+			std::lock_guard<std::mutex> rg(m_runLock);
+			std::unique_lock<std::mutex> lk(m_lock);
+
+			m_job = &job;
+			m_numJobs = numJobs;
+			m_nextJob = 0;
+			m_unfinishedJobs = numJobs;
+
+			m_jobCv.notify_all();
+
+			//help the workers
+			while (RunNextJob(lk)) {
+			}
+
+			m_doneCv.wait(lk, [this] { return m_unfinishedJobs == 0; });
+
+			m_job = NULL;
+		}
+
+		bool WorkerPool::RunNextJob(std::unique_lock<std::mutex>& lk)
+		{
+			if (m_job == NULL || m_nextJob >= m_numJobs)
+				return false;
+
+			auto job = m_job;
+			uint idx = m_nextJob++;
+
+			lk.unlock();
+			(*job)(idx);
+			lk.lock();
+
+			if (--m_unfinishedJobs == 0)
+				m_doneCv.notify_all();
+
+			return true;
+		}
+
+		void WorkerPool::WorkerLoop()
+		{
+			std::unique_lock<std::mutex> lk(m_lock);
+			while (!m_quit) {
+				if (!RunNextJob(lk))
+					m_jobCv.wait(lk);
+			}
+		}
+	}
+}
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "NstBase.hpp"
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+namespace Nes {
+	namespace Core {
+		//Small pool of threads running batches of independent jobs in parallel
+		class WorkerPool {
+		public:
+			//uses at most <maxThreads> threads, but not more than the number of hardware threads minus one
+			explicit WorkerPool(uint maxThreads);
+			~WorkerPool();
+
+			uint NumThreads() const { return (uint)m_threads.size(); }
+
+			//run job(0) ... job(numJobs - 1) and return after all of them are done. Calling thread also runs the jobs.
+			//Jobs must not throw. Calls from different threads are serialized.
+			void Run(uint numJobs, const std::function<void(uint)>& job);
+		private:
+			void Stop();
+			void WorkerLoop();
+			bool RunNextJob(std::unique_lock<std::mutex>& lk);
+
+			std::vector<std::thread> m_threads;
+
+			std::mutex m_runLock;
+			std::mutex m_lock;
+			std::condition_variable m_jobCv;
+			std::condition_variable m_doneCv;
+
+			const std::function<void(uint)>* m_job;
+			uint m_numJobs;
+			uint m_nextJob;
+			uint m_unfinishedJobs;
+			bool m_quit;
+		};
+	}
+}
@@ -23,7 +23,10 @@
 //
 ////////////////////////////////////////////////////////////////////////////////////////
 
+#include <new>
 #include "../NstMachine.hpp"
+#include "../NstTrackerRunAhead.hpp"
+#include "../NstTrackerTurbo.hpp"
 #include "NstApiEmulator.hpp"
 
 namespace Nes
@@ -63,5 +66,58 @@ namespace Nes
 		{
 			return machine.tracker.Frame();
 		}
+
+		Result Emulator::SetRunAhead(uint frames) throw()
+		{
+			NST_COMPILE_ASSERT( uint(MAX_RUN_AHEAD) == uint(Core::Tracker::RunAhead::MAX_FRAMES) );
+
+			try
+			{
+				return machine.tracker.SetRunAhead( &machine, frames );
+			}
+			catch (const std::bad_alloc&)
+			{
+				return RESULT_ERR_OUT_OF_MEMORY;
+			}
+		}
+
+		uint Emulator::GetRunAhead() const throw()
+		{
+			const Core::Tracker::RunAhead* const runAhead = machine.tracker.GetRunAhead();
+			return runAhead ? runAhead->NumFrames() : 0;
+		}
+
+		Result Emulator::GetRunAheadStats(RunAheadStats& stats) const throw()
+		{
+			const Core::Tracker::RunAhead* const runAhead = machine.tracker.GetRunAhead();
+
+			if (!runAhead)
+				return RESULT_ERR_NOT_READY;
+
+			stats.frames = runAhead->GetStats().frames;
+			stats.time = runAhead->GetStats().time;
+			stats.overhead = runAhead->GetStats().overhead;
+
+			return RESULT_OK;
+		}
+
+		Result Emulator::SetTurbo(uint frames) throw()
+		{
+			NST_COMPILE_ASSERT( uint(MAX_TURBO) == uint(Core::Tracker::Turbo::MAX_FRAMES) );
+
+			try
+			{
+				return machine.tracker.SetTurbo( frames );
+			}
+			catch (const std::bad_alloc&)
+			{
+				return RESULT_ERR_OUT_OF_MEMORY;
+			}
+		}
+
+		uint Emulator::GetTurbo() const throw()
+		{
+			return machine.tracker.GetTurbo();
+		}
 	}
 }
@@ -98,6 +98,95 @@ namespace Nes
 			*/
 			ulong Frame() const throw();
 
+			enum
+			{
+				/**
+				* Maximum number of frames to run ahead.
+				*/
+				MAX_RUN_AHEAD = 8,
+				/**
+				* Maximum number of frames emulated per Execute() in turbo mode.
+				*/
+				MAX_TURBO = 16
+			};
+
+			/**
+			* Sets up run-ahead to hide the game's own input lag.
+			*
+			* Every Execute() then emulates the frame for real with sound only, saves the
+			* state, emulates the given number of frames ahead with the same input, shows
+			* the last of them and restores the saved state. Skipped for frames without
+			* video output, while rewinding or playing/recording a movie, and in network play.
+			* An enabled rewinder that isn't rewinding keeps recording the real frames.
+			* Parallel sound rendering is suspended while run-ahead is on, since the state
+			* is saved and restored around every frame (see Sound::EnableParallelRendering()).
+			*
+			* @param frames number of frames, 0 to disable, default is 0
+			* @return result code
+			*/
+			Result SetRunAhead(uint frames) throw();
+
+			/**
+			* Returns the number of frames to run ahead.
+			*
+			* @return number, 0 if disabled
+			*/
+			uint GetRunAhead() const throw();
+
+			/**
+			* Run-ahead figures for the last executed frame.
+			*/
+			struct RunAheadStats
+			{
+				/**
+				* Frames of input lag removed, 0 if the frame wasn't run ahead.
+				* The other figures are 0 too when it was skipped altogether.
+				*/
+				uint frames;
+
+				/**
+				* Time spent in Execute(), in microseconds.
+				*/
+				ulong time;
+
+				/**
+				* Part of time spent on the speculative frames, saving and restoring, in microseconds.
+				*/
+				ulong overhead;
+			};
+
+			/**
+			* Returns run-ahead figures for the last executed frame.
+			*
+			* @param stats object to be filled
+			* @return result code, RESULT_ERR_NOT_READY if run-ahead is disabled
+			*/
+			Result GetRunAheadStats(RunAheadStats& stats) const throw();
+
+			/**
+			* Sets up turbo mode for fast-forwarding.
+			*
+			* Every Execute() then emulates the given number of frames in a row. Only the
+			* last of them is rendered to the video output, and the sound of all of them is
+			* averaged down to the number of samples the sound output asks for, so the audio
+			* plays on without gaps at a higher pitch. Skipped in network play.
+			*
+			* The sound of the skipped frames is caught by swapping the Sound::Output lock
+			* and unlock callbacks for the duration of Execute(). Those are shared by every
+			* Emulator object, so turbo mode supports only one instance executing at a time.
+			*
+			* @param frames number of frames per Execute(), 0 or 1 to disable, default is 1
+			* @return result code
+			*/
+			Result SetTurbo(uint frames) throw();
+
+			/**
+			* Returns the number of frames emulated per Execute().
+			*
+			* @return number, 1 if turbo mode is disabled
+			*/
+			uint GetTurbo() const throw();
+
 		private:
 
 			Core::Machine& machine;
@@ -175,6 +175,34 @@ namespace Nes
 			emulator.EnableLowResRemoteControl(enable);
 		}
 
+		void Machine::SetRemoteFrameCompressor(RemoteFrameCompressor compressor) {
+			emulator.SetRemoteFrameCompressor(compressor);
+		}
+
+		void Machine::SetRemoteFrameDictionary(const void* data, ulong size) {
+			emulator.SetRemoteFrameDictionary(data, size);
+		}
+
+		Result Machine::TrainRemoteFrameDictionary(std::vector<unsigned char>& dictionary) {
+			return emulator.TrainRemoteFrameDictionary(dictionary);
+		}
+
+		void Machine::EnableRemoteLockstep(bool enable, uint inputDelay, uint maxRollbackFrames) {
+			emulator.EnableRemoteLockstep(enable, inputDelay, maxRollbackFrames);
+		}
+
+		Result Machine::LoadRemoteLockstep(std::shared_ptr<HQRemote::IConnectionHandler> connHandler, const char* clientInfo) throw() {
+			return emulator.LoadRemoteLockstep(connHandler, clientInfo);
+		}
+
+		Result Machine::LoadRemoteLockstep(const std::string& remoteIp, int remotePort, const char* clientInfo) throw() {
+			return emulator.LoadRemoteLockstep(remoteIp, remotePort, clientInfo);
+		}
+
+		bool Machine::IsRemoteLockstepRunning() const {
+			return emulator.IsRemoteLockstepRunning();
+		}
+
 		Result Machine::SendMessageToRemote(uint64_t id, const char* message)
 		{
 			return emulator.SendMessageToRemote(id, message);
@@ -324,6 +352,80 @@ namespace Nes
 			return RESULT_OK;
 		}
 
+		ulong Machine::GetSnapshotSize() const throw()
+		{
+			if (!Is(GAME,ON))
+				return 0;
+
+			try
+			{
+				Core::State::Saver saver( static_cast<byte*>(NULL), 0, false );
+				emulator.SaveState( saver );
+
+				return saver.MemorySize();
+			}
+			catch (...)
+			{
+				return 0;
+			}
+		}
+
+		Result Machine::SnapshotTo(void* buffer,ulong capacity,ulong* size) const throw()
+		{
+			if (!Is(GAME,ON))
+				return RESULT_ERR_NOT_READY;
+
+			if (!buffer)
+				return RESULT_ERR_INVALID_PARAM;
+
+			try
+			{
+				Core::State::Saver saver( static_cast<byte*>(buffer), capacity < 0xFFFFFFFF ? capacity : 0xFFFFFFFF, false );
+				emulator.SaveState( saver );
+
+				if (size)
+					*size = saver.MemorySize();
+			}
+			catch (Result result)
+			{
+				return result == RESULT_ERR_BUFFER_TOO_SMALL ? RESULT_ERR_OUT_OF_MEMORY : result;
+			}
+			catch (...)
+			{
+				return RESULT_ERR_GENERIC;
+			}
+
+			return RESULT_OK;
+		}
+
+		Result Machine::RestoreFrom(const void* buffer,ulong size) throw()
+		{
+			if (!Is(GAME,ON) || IsLocked())
+				return RESULT_ERR_NOT_READY;
+
+			if (!buffer || !size)
+				return RESULT_ERR_INVALID_PARAM;
+
+			try
+			{
+				emulator.tracker.Resync();
+				Core::State::Loader loader( static_cast<const byte*>(buffer), size < 0xFFFFFFFF ? size : 0xFFFFFFFF, false );
+
+				if (emulator.LoadState( loader, true ))
+					return RESULT_OK;
+				else
+					return RESULT_ERR_INVALID_CRC;
+			}
+			catch (Result result)
+			{
+				return result;
+			}
+			catch (...)
+			{
+				return RESULT_ERR_GENERIC;
+			}
+		}
+
 		#ifdef NST_MSVC_OPTIMIZE
 		#pragma optimize("", on)
 		#endif
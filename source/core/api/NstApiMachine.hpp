@@ -31,6 +31,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #ifdef NST_PRAGMA_ONCE
 #pragma once
@@ -271,6 +272,38 @@ namespace Nes
 
 			void EnableLowResRemoteControl(bool enable);
 
+			//entropy coding of remote frames. LZ4 is the cheapest, zstd gives the smallest frames.
+			//Values match Core::FrameCompressorType
+			enum RemoteFrameCompressor
+			{
+				REMOTE_FRAME_COMPRESSOR_ZLIB = 0,
+				REMOTE_FRAME_COMPRESSOR_LZ4 = 2,
+				REMOTE_FRAME_COMPRESSOR_ZSTD = 3
+			};
+
+			//host's preferred frame compressor, zlib is used instead if client cannot decode it
+			void SetRemoteFrameCompressor(RemoteFrameCompressor compressor);
+			//zstd compressor's dictionary, it must be identical on host & client and be set before connecting
+			void SetRemoteFrameDictionary(const void* data, ulong size);
+			//train a zstd dictionary from the frames sent since the previous call. Host must be using zstd compressor.
+			//Frames are only collected once requested: the first call starts collecting them and returns RESULT_ERR_NOT_READY,
+			//the next one trains the dictionary from the most recent frames and stops collecting.
+			Result TrainRemoteFrameDictionary(std::vector<unsigned char>& dictionary);
+
+			//input-only lockstep netplay: both sides run the same image and exchange only their pads' input instead of
+			//streaming video & audio. Host controls pad 1, client controls the remote controller's pad.
+			//host side: accept clients' lockstep requests (default). <inputDelay> is the number of frames local input is
+			//delayed to hide network latency, higher values tolerate slower connections.
+			//<maxRollbackFrames> > 0 (max 8) enables rollback: remote input is predicted, so the emulation doesn't wait for it,
+			//and the frames executed with mispredicted input are re-simulated silently once the real input arrives.
+			//A small input delay (e.g. 1) plus rollback hides latency without making local input feel sluggish.
+			void EnableRemoteLockstep(bool enable, uint inputDelay = 2, uint maxRollbackFrames = 0);
+			//client side: the same image as host's must be loaded & powered on. Host's state will be loaded when it accepts,
+			//EVENT_REMOTE_LOCKSTEP is invoked with the result.
+			Result LoadRemoteLockstep(std::shared_ptr<HQRemote::IConnectionHandler> connHandler, const char* clientName = NULL) throw();
+			Result LoadRemoteLockstep(const std::string& remoteIp, int remotePort, const char* clientName = NULL) throw();
+			bool IsRemoteLockstepRunning() const;
+
 			//<id> is used for ACK message later to acknowledge that the message is received by remote side.
 			//<message> must not have more than MAX_REMOTE_MESSAGE_SIZE bytes (excluding NULL character). Otherwise RESULT_ERR_BUFFER_TOO_BIG is retuned.
 			//If there is no remote connection, RESULT_ERR_NOT_READY is returned
@@ -351,6 +384,37 @@ namespace Nes
 			*/
 			Result SaveState(std::ostream& stream,Compression compression=USE_COMPRESSION) const throw();
 
+			/**
+			* Returns the size of a snapshot of the current state.
+			*
+			* The size only changes when the loaded image, the region or the connected input devices change.
+			*
+			* @return size in bytes, 0 if no game is running
+			*/
+			ulong GetSnapshotSize() const throw();
+
+			/**
+			* Saves the current state into a caller-owned buffer.
+			*
+			* Same layout as an uncompressed SaveState() but written directly to memory, no stream
+			* or compression is involved and no memory is allocated.
+			*
+			* @param buffer buffer which the state will be written to
+			* @param capacity size of buffer, at least GetSnapshotSize()
+			* @param size if not NULL, receives the number of bytes written
+			* @return result code, RESULT_ERR_OUT_OF_MEMORY if the buffer is too small
+			*/
+			Result SnapshotTo(void* buffer,ulong capacity,ulong* size=NULL) const throw();
+
+			/**
+			* Restores a state saved by SnapshotTo().
+			*
+			* @param buffer buffer containing the state
+			* @param size number of bytes in buffer
+			* @return result code
+			*/
+			Result RestoreFrom(const void* buffer,ulong size) throw();
+
 			/**
 			* Returns a machine state.
 			*
@@ -444,6 +508,14 @@ namespace Nes
 				* Sent message received by remote side. result value is pointer to id of message
 				*/
 				EVENT_REMOTE_MESSAGE_ACK,
+				/*
+				* Lockstep netplay started if result value is RESULT_OK. Otherwise it's refused or stopped, result value is the reason.
+				*/
+				EVENT_REMOTE_LOCKSTEP,
+				/*
+				* Lockstep netplay's states of both sides are different. result value is the frame where it's detected
+				*/
+				EVENT_REMOTE_DESYNC,
 				/**
 				* An image has been unloaded from the system.
 				*/
@@ -72,6 +72,44 @@ namespace Nes
 			emulator.tracker.EnableRewinderSound( enable );
 		}
 
+		Result Rewinder::SetMemoryBudget(uint megabytes) throw()
+		{
+			if (megabytes > MAX_MEMORY_BUDGET)
+				return RESULT_ERR_INVALID_PARAM;
+
+			if (emulator.tracker.IsRewinding())
+				return RESULT_ERR_NOT_READY;
+
+			if (emulator.tracker.GetRewinderBudget() == megabytes * Core::SIZE_1K * Core::SIZE_1K)
+				return RESULT_NOP;
+
+			try
+			{
+				emulator.tracker.SetRewinderBudget( megabytes * Core::SIZE_1K * Core::SIZE_1K );
+				return RESULT_OK;
+			}
+			catch (const std::bad_alloc&)
+			{
+				emulator.tracker.SetRewinderBudget( 0 );
+				return RESULT_ERR_OUT_OF_MEMORY;
+			}
+			catch (...)
+			{
+				emulator.tracker.SetRewinderBudget( 0 );
+				return RESULT_ERR_GENERIC;
+			}
+		}
+
+		uint Rewinder::GetMemoryBudget() const throw()
+		{
+			return emulator.tracker.GetRewinderBudget() / (Core::SIZE_1K * Core::SIZE_1K);
+		}
+
+		ulong Rewinder::GetMemoryUsage() const throw()
+		{
+			return emulator.tracker.GetRewinderMemoryUsage();
+		}
+
 		Rewinder::Direction Rewinder::GetDirection() const throw()
 		{
 			return emulator.tracker.IsRewinding() ? BACKWARD : FORWARD;
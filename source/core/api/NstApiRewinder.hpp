@@ -110,6 +110,41 @@ namespace Nes
 			*/
 			bool IsSoundEnabled() const throw();
 
+			/**
+			* Maximum memory budget.
+			*/
+			enum
+			{
+				MAX_MEMORY_BUDGET = 1024
+			};
+
+			/**
+			* Sets the memory budget.
+			*
+			* With a non-zero budget every frame's state is kept as a compressed delta from the previous
+			* frame's state, rewinding then steps back one frame at a time without re-emulating frames and
+			* the oldest frames are dropped once the budget is used up. With zero (default), states are kept
+			* every 60 frames for the last 60 seconds and the frames in-between are re-emulated.
+			*
+			* @param megabytes memory budget in MB, 0 to MAX_MEMORY_BUDGET
+			* @return result code
+			*/
+			Result SetMemoryBudget(uint megabytes) throw();
+
+			/**
+			* Returns the memory budget.
+			*
+			* @return memory budget in MB
+			*/
+			uint GetMemoryBudget() const throw();
+
+			/**
+			* Returns the memory currently used by the delta states.
+			*
+			* @return size in bytes, 0 if no memory budget is set
+			*/
+			ulong GetMemoryUsage() const throw();
+
 			/**
 			* Sets direction.
 			*
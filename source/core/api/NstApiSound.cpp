@@ -23,6 +23,7 @@
 //
 ////////////////////////////////////////////////////////////////////////////////////////
 
+#include <new>
 #include "../NstMachine.hpp"
 #include "NstApiSound.hpp"
 
@@ -151,6 +152,37 @@ namespace Nes
 		{
 			emulator.cpu.GetApu().ClearBuffers();
 		}
+
+		void Sound::SetBandLimited(bool state) throw()
+		{
+			emulator.cpu.GetApu().SetBandLimited( state );
+		}
+
+		bool Sound::IsBandLimited() const throw()
+		{
+			return emulator.cpu.GetApu().IsBandLimited();
+		}
+
+		Result Sound::EnableParallelRendering(bool state) throw()
+		{
+			try
+			{
+				return emulator.cpu.GetApu().EnableParallel( state );
+			}
+			catch (const std::bad_alloc&)
+			{
+				return RESULT_ERR_OUT_OF_MEMORY;
+			}
+			catch (...)
+			{
+				return RESULT_ERR_GENERIC;
+			}
+		}
+
+		bool Sound::IsParallelRenderingEnabled() const throw()
+		{
+			return emulator.cpu.GetApu().IsParallel();
+		}
 	}
 
 	#ifdef NST_MSVC_OPTIMIZE
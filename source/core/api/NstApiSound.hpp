@@ -429,6 +429,42 @@ namespace Nes
 			*/
 			void EmptyBuffer() throw();
 
+			/**
+			* Synthesizes the square, triangle and noise channels from band-limited
+			* steps placed at their exact transitions instead of averaging them once
+			* per output sample. Reduces aliasing at common sample rates at a lower
+			* cost. Not used for games with expansion sound chips.
+			*
+			* @param state true to enable
+			*/
+			void SetBandLimited(bool state) throw();
+
+			/**
+			* Checks if band-limited synthesis is enabled.
+			*
+			* @return true if enabled
+			*/
+			bool IsBandLimited() const throw();
+
+			/**
+			* Renders the sound on a separate thread while the next frame is emulated.
+			* Delays the sound output by one frame. Games using expansion sound chips
+			* with readable registers (FDS, MMC5, Namcot 163) or NSF files are still
+			* rendered on the calling thread, as is all sound while run-ahead is on
+			* (see Emulator::SetRunAhead()).
+			*
+			* @param state true to enable
+			* @return result code
+			*/
+			Result EnableParallelRendering(bool state) throw();
+
+			/**
+			* Checks if parallel rendering is enabled.
+			*
+			* @return true if enabled
+			*/
+			bool IsParallelRenderingEnabled() const throw();
+
 			/**
 			* Sound output context.
 			*/
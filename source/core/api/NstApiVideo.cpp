@@ -23,6 +23,7 @@
 //
 ////////////////////////////////////////////////////////////////////////////////////////
 
+#include <new>
 #include "../NstMachine.hpp"
 #include "../NstVideoRenderer.hpp"
 #include "NstApiVideo.hpp"
@@ -68,6 +69,116 @@ namespace Nes
 			return !emulator.ppu.HasSpriteLimit();
 		}
 
+		Result Video::EnableLineRenderer(bool state) throw()
+		{
+			if (emulator.ppu.HasLineRenderer() != state)
+			{
+				emulator.ppu.EnableLineRenderer( state );
+				return RESULT_OK;
+			}
+
+			return RESULT_NOP;
+		}
+
+		bool Video::IsLineRendererEnabled() const throw()
+		{
+			return emulator.ppu.HasLineRenderer();
+		}
+
+		Result Video::EnableHeadless(bool state) throw()
+		{
+			if (emulator.IsHeadless() != state)
+			{
+				emulator.EnableHeadless( state );
+				return RESULT_OK;
+			}
+
+			return RESULT_NOP;
+		}
+
+		bool Video::IsHeadlessEnabled() const throw()
+		{
+			return emulator.IsHeadless();
+		}
+
+		Result Video::SetBlitThreads(uint count) throw()
+		{
+			try
+			{
+				return emulator.renderer.SetBlitThreads( count );
+			}
+			catch (const std::bad_alloc&)
+			{
+				return RESULT_ERR_OUT_OF_MEMORY;
+			}
+			catch (...)
+			{
+				return RESULT_ERR_GENERIC;
+			}
+		}
+
+		uint Video::GetBlitThreads() const throw()
+		{
+			return emulator.renderer.GetBlitThreads();
+		}
+
+		Result Video::EnablePipelinedBlit(bool state) throw()
+		{
+			try
+			{
+				return emulator.renderer.EnablePipelining( state );
+			}
+			catch (const std::bad_alloc&)
+			{
+				return RESULT_ERR_OUT_OF_MEMORY;
+			}
+			catch (...)
+			{
+				return RESULT_ERR_GENERIC;
+			}
+		}
+
+		bool Video::IsPipelinedBlitEnabled() const throw()
+		{
+			return emulator.renderer.IsPipelined();
+		}
+
+		Result Video::EnableDirtyRowBlit(bool state) throw()
+		{
+			try
+			{
+				return emulator.renderer.EnableDirtyRows( state );
+			}
+			catch (const std::bad_alloc&)
+			{
+				return RESULT_ERR_OUT_OF_MEMORY;
+			}
+			catch (...)
+			{
+				return RESULT_ERR_GENERIC;
+			}
+		}
+
+		bool Video::IsDirtyRowBlitEnabled() const throw()
+		{
+			return emulator.renderer.IsTrackingDirtyRows();
+		}
+
+		bool Video::GetDirtyRows(uint& first,uint& count) const throw()
+		{
+			return emulator.renderer.GetDirtyRows( first, count );
+		}
+
+		Result Video::EnableIndexedOutput(bool state) throw()
+		{
+			return emulator.renderer.EnableIndexedOutput( state );
+		}
+
+		bool Video::IsIndexedOutputEnabled() const throw()
+		{
+			return emulator.renderer.IsIndexed();
+		}
+
 		int Video::GetBrightness() const throw()
 		{
 			return emulator.renderer.GetBrightness();
@@ -193,6 +304,16 @@ namespace Nes
 			return emulator.renderer.IsFieldMergingEnabled();
 		}
 
+		Result Video::SetNtscPath(NtscPath path) throw()
+		{
+			return emulator.renderer.SetNtscPath( path );
+		}
+
+		Video::NtscPath Video::GetNtscPath() const throw()
+		{
+			return emulator.renderer.GetNtscPath();
+		}
+
 		Result Video::SetRenderState(const RenderState& state) throw()
 		{
 			const Result result = emulator.renderer.SetState( state );
@@ -355,6 +476,11 @@ namespace Nes
 			return emulator.renderer.GetPalette();
 		}
 
+		ulong Video::Palette::GetVersion() const throw()
+		{
+			return emulator.renderer.GetPaletteVersion();
+		}
+
 		#ifdef NST_MSVC_OPTIMIZE
 		#pragma optimize("", on)
 		#endif
@@ -222,6 +222,139 @@ namespace Nes
 			*/
 			bool AreUnlimSpritesEnabled() const throw();
 
+			/**
+			* Lets the PPU render whole scanlines at once whenever nothing changes its
+			* state mid-line, falling back on per-dot rendering otherwise. The output
+			* is meant to be identical either way, and the nsttest_linerenderer test
+			* compares the two, but the scanline renderer hasn't been validated over
+			* a broad set of games yet, so it is opt-in.
+			*
+			* @param state true to enable it, default is false
+			* @return result code
+			*/
+			Result EnableLineRenderer(bool state) throw();
+
+			/**
+			* Checks if the PPU scanline renderer is enabled.
+			*
+			* @return true if enabled
+			*/
+			bool IsLineRendererEnabled() const throw();
+
+			/**
+			* Lets frames executed without a video output skip rendering their pixels.
+			* Emulation is unaffected, the PPU still does its fetches and sprite
+			* evaluation. The screen is left as it was, so Blit() afterwards shows
+			* the last frame that had an output. Ignored while a light gun is connected.
+			*
+			* @param state true to enable it, default is false
+			* @return result code
+			*/
+			Result EnableHeadless(bool state) throw();
+
+			/**
+			* Checks if headless frames are enabled.
+			*
+			* @return true if enabled
+			*/
+			bool IsHeadlessEnabled() const throw();
+
+			/**
+			* Sets the number of threads the filters are run on. Each frame is split
+			* into bands of lines, one per thread, with the calling thread taking part.
+			* No more threads are started than there are cores, bands in excess are
+			* run in turn. Applies to the NTSC, ScaleX, hqX, 2xSaI and xBR filters,
+			* the others always run on the calling thread.
+			*
+			* @param count number of threads in the range 1 to 16, default is 1
+			* @return result code
+			*/
+			Result SetBlitThreads(uint count) throw();
+
+			/**
+			* Returns the number of threads the filters are run on.
+			*
+			* @return number of threads
+			*/
+			uint GetBlitThreads() const throw();
+
+			/**
+			* Moves the blit to a thread of its own so that filtering a frame overlaps
+			* with emulating the next one. Execute() then hands the frame finished by
+			* the previous call to that thread and emulates the next while it's being
+			* blitted. The frame is in the output and the lock and unlock callbacks,
+			* invoked from the blitting thread, have returned by the time Execute()
+			* returns. Output is one frame behind as a result. Ignored while the
+			* machine is networked.
+			*
+			* @param state true to enable it, default is false
+			* @return result code
+			*/
+			Result EnablePipelinedBlit(bool state) throw();
+
+			/**
+			* Checks if pipelined blitting is enabled.
+			*
+			* @return true if enabled
+			*/
+			bool IsPipelinedBlitEnabled() const throw();
+
+			/**
+			* Makes blits redraw only the lines of the NES screen that changed since the
+			* previous one, together with the lines next to them that the filter blends in.
+			* The surface must keep its contents between blits. A different surface
+			* address or pitch, a palette or filter change, or a filter that can't draw
+			* part of a frame redraws all of it.
+			*
+			* @param state true to enable it, default is false
+			* @return result code
+			*/
+			Result EnableDirtyRowBlit(bool state) throw();
+
+			/**
+			* Checks if dirty row blitting is enabled.
+			*
+			* @return true if enabled
+			*/
+			bool IsDirtyRowBlitEnabled() const throw();
+
+			/**
+			* Returns the next run of lines redrawn by the last blit, for limiting
+			* texture uploads and such. Lines are those of the NES screen, line n
+			* covering surface lines n * height / 240 up to (n+1) * height / 240.
+			* Without dirty row blitting every line is redrawn. Starting from line 0
+			* and advancing by the returned count each call walks all the runs.
+			*
+			* @param first line to search from, set to the first line of the run
+			* @param count set to the number of lines in the run
+			* @return false if there are no more runs
+			*/
+			bool GetDirtyRows(uint& first,uint& count) const throw();
+
+			/**
+			* Hands out the NES screen as palette indices instead of RGB pixels, leaving
+			* the color lookup to the frontend. Each pixel is 16 bits wide, holding one
+			* of the 512 entries of Palette::GetColors() with the color in the low 6 bits
+			* and the emphasis in the next 3. The render state and filter are ignored.
+			* Blits still go through the lock and unlock callbacks. An output whose
+			* pixels are NULL is given the emulator's own buffer for the duration of the
+			* callbacks, with no copying. Otherwise the indices are copied to the
+			* surface, limited to the changed lines when dirty row blitting is enabled.
+			* Only the frontend's output is affected, remote hosting captures its frames
+			* the same way whether this is enabled or not.
+			*
+			* @param state true to enable it, default is false
+			* @return result code
+			*/
+			Result EnableIndexedOutput(bool state) throw();
+
+			/**
+			* Checks if indexed output is enabled.
+			*
+			* @return true if enabled
+			*/
+			bool IsIndexedOutputEnabled() const throw();
+
 			/**
 			* Returns the current brightness.
 			*
@@ -396,6 +529,49 @@ namespace Nes
 			*/
 			bool IsFieldMergingEnabled() const throw();
 
+			/**
+			* NTSC filter blitters.
+			*/
+			enum NtscPath
+			{
+				/**
+				* Fastest one the build and CPU support (default)
+				*/
+				NTSC_PATH_DEFAULT,
+				/**
+				* Plain C++
+				*/
+				NTSC_PATH_SCALAR,
+				/**
+				* SSE2
+				*/
+				NTSC_PATH_SSE2,
+				/**
+				* AVX2
+				*/
+				NTSC_PATH_AVX2,
+				/**
+				* NEON
+				*/
+				NTSC_PATH_NEON
+			};
+
+			/**
+			* Forces the NTSC filter onto one of its blitters, for benchmarking and
+			* testing. All of them produce the same output.
+			*
+			* @param path blitter, default is NTSC_PATH_DEFAULT
+			* @return result code, RESULT_ERR_UNSUPPORTED if the blitter isn't built in or the CPU lacks it
+			*/
+			Result SetNtscPath(NtscPath path) throw();
+
+			/**
+			* Returns the blitter the NTSC filter uses, never NTSC_PATH_DEFAULT.
+			*
+			* @return blitter
+			*/
+			NtscPath GetNtscPath() const throw();
+
 			/**
 			* Performs a manual blit to the video output object.
 			*
@@ -597,6 +773,14 @@ namespace Nes
 				*/
 				Colors GetColors() const throw();
 
+				/**
+				* Returns a number that changes each time the palette colors do,
+				* so that a copy of them only needs refreshing when it changes.
+				*
+				* @return palette version
+				*/
+				ulong GetVersion() const throw();
+
 				/**
 				* Sets the palette mode.
 				*
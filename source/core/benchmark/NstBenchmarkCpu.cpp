@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+// Measures raw instruction throughput of the CPU core. The program runs a fixed
+// instruction stream synthesized in memory as an NROM image, with NMI and rendering
+// off, so the result depends only on the dispatch mode the core was built with
+// (see NST_CPU_DISPATCH in NstCpu.hpp).
+//
+// usage: nstbench_cpu [frames]
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include "../api/NstApiEmulator.hpp"
+#include "../api/NstApiMachine.hpp"
+#include "../api/NstApiCheats.hpp"
+#include "../api/NstApiMemoryStream.hpp"
+
+#ifndef NST_CPU_DISPATCH
+#define NST_CPU_DISPATCH_NAME "platform default"
+#elif NST_CPU_DISPATCH == 0
+#define NST_CPU_DISPATCH_NAME "table"
+#elif NST_CPU_DISPATCH == 1
+#define NST_CPU_DISPATCH_NAME "switch"
+#else
+#define NST_CPU_DISPATCH_NAME "goto"
+#endif
+
+namespace
+{
+	enum
+	{
+		PRG_SIZE = 0x4000,
+		CHR_SIZE = 0x2000,
+		PRG_BASE = 0xC000,
+		// instructions in one pass of the loop below, and the extra ones
+		// executed each time a byte of the pass counter wraps around
+		LOOP_INSTRUCTIONS = 11,
+		CARRY_INSTRUCTIONS = 2
+	};
+
+	const unsigned char program[] =
+	{
+		// reset
+		0x78,             // SEI
+		0xD8,             // CLD
+		0xA2, 0xFF,       // LDX #$FF
+		0x9A,             // TXS
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x00, 0x20, // STA $2000
+		0x8D, 0x01, 0x20, // STA $2001
+		0x85, 0x00,       // STA $00
+		0x85, 0x01,       // STA $01
+		0x85, 0x02,       // STA $02
+		0x85, 0x03,       // STA $03
+		// loop, at $C015
+		0xA5, 0x10,       // LDA $10
+		0x69, 0x03,       // ADC #$03
+		0x85, 0x10,       // STA $10
+		0xAA,             // TAX
+		0xBD, 0x00, 0x03, // LDA $0300,X
+		0x0A,             // ASL A
+		0x9D, 0x00, 0x03, // STA $0300,X
+		0x66, 0x11,       // ROR $11
+		0xC8,             // INY
+		0xE6, 0x00,       // INC $00
+		0xD0, 0xEB,       // BNE loop
+		0xE6, 0x01,       // INC $01
+		0xD0, 0xE7,       // BNE loop
+		0xE6, 0x02,       // INC $02
+		0xD0, 0xE3,       // BNE loop
+		0xE6, 0x03,       // INC $03
+		0x4C, 0x15, 0xC0, // JMP loop
+		// nmi, irq
+		0x40              // RTI
+	};
+
+	void BuildImage(std::vector<char>& image)
+	{
+		static const char header[16] = { 'N','E','S',0x1A, PRG_SIZE / 0x4000, CHR_SIZE / 0x2000 };
+
+		image.assign( sizeof(header) + PRG_SIZE + CHR_SIZE, 0 );
+		std::memcpy( &image[0], header, sizeof(header) );
+
+		char* const prg = &image[sizeof(header)];
+		std::memcpy( prg, program, sizeof(program) );
+
+		const unsigned int rti = PRG_BASE + sizeof(program) - 1;
+		const unsigned int vectors[3] = { rti, PRG_BASE, rti };
+
+		for (int i = 0; i < 3; ++i)
+		{
+			prg[PRG_SIZE - 6 + i * 2 + 0] = char(vectors[i] & 0xFF);
+			prg[PRG_SIZE - 6 + i * 2 + 1] = char(vectors[i] >> 8);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace Nes::Api;
+
+	const int frames = argc > 1 ? std::atoi( argv[1] ) : 3000;
+
+	if (frames <= 0)
+	{
+		std::fprintf( stderr, "usage: %s [frames]\n", argv[0] );
+		return 1;
+	}
+
+	std::vector<char> image;
+	BuildImage( image );
+
+	Emulator emulator;
+	Machine machine( emulator );
+
+	// the const overload copies the image, the other one takes ownership of it
+	MemInputStream stream( static_cast<const char*>(&image[0]), image.size() );
+
+	if (NES_FAILED(machine.Load( stream, Machine::FAVORED_NES_NTSC )) || NES_FAILED(machine.Power( true )))
+	{
+		std::fprintf( stderr, "failed to load the benchmark image\n" );
+		return 1;
+	}
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < frames; ++i)
+		emulator.Execute( NULL, NULL, NULL );
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	const Cheats::Ram ram = Cheats(emulator).GetRam();
+	const unsigned long passes = ram[0] | (unsigned long)ram[1] << 8 | (unsigned long)ram[2] << 16 | (unsigned long)ram[3] << 24;
+	const double instructions = double(passes) * LOOP_INSTRUCTIONS + double((passes >> 8) + (passes >> 16) + (passes >> 24)) * CARRY_INSTRUCTIONS;
+
+	std::printf
+	(
+		"dispatch: %s\nframes: %d\ninstructions: %.0f\ntime: %.3f s\n%.2f M instructions/sec\n",
+		NST_CPU_DISPATCH_NAME,
+		frames,
+		instructions,
+		seconds,
+		instructions / seconds / 1000000.0
+	);
+
+	return 0;
+}
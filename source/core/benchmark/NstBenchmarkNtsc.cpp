@@ -0,0 +1,252 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+// Measures the NTSC filter blitters, the way source/nes_ntsc/benchmark.c measures
+// nes_ntsc_blit. A program synthesized as an NROM image fills the screen with all 256
+// tiles of a pseudo random pattern table in every palette, then each blitter built in
+// and supported by the CPU is timed at each output depth. The outputs must match those
+// of the scalar blitter, the program fails otherwise.
+//
+// usage: nstbench_ntsc [frames]
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include "../api/NstApiEmulator.hpp"
+#include "../api/NstApiMachine.hpp"
+#include "../api/NstApiVideo.hpp"
+#include "../api/NstApiMemoryStream.hpp"
+
+namespace
+{
+	using namespace Nes::Api;
+
+	enum
+	{
+		PRG_SIZE = 0x4000,
+		CHR_SIZE = 0x2000,
+		PRG_BASE = 0xC000,
+		PALETTE_OFFSET = 0x59,
+		RTI_OFFSET = 0x58,
+		OUT_WIDTH = Video::Output::NTSC_WIDTH,
+		OUT_HEIGHT = Video::Output::HEIGHT
+	};
+
+	const unsigned char program[] =
+	{
+		0x78,             // SEI
+		0xD8,             // CLD
+		0xA2, 0xFF,       // LDX #$FF
+		0x9A,             // TXS
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x00, 0x20, // STA $2000
+		0x8D, 0x01, 0x20, // STA $2001
+		0x2C, 0x02, 0x20, // BIT $2002
+		0x10, 0xFB,       // BPL *-3
+		0x2C, 0x02, 0x20, // BIT $2002
+		0x10, 0xFB,       // BPL *-3
+		// palette
+		0xA9, 0x3F,       // LDA #$3F
+		0x8D, 0x06, 0x20, // STA $2006
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x06, 0x20, // STA $2006
+		0xA2, 0x00,       // LDX #$00
+		0xBD, PRG_BASE + PALETTE_OFFSET & 0xFF, PRG_BASE + PALETTE_OFFSET >> 8, // LDA palette,X
+		0x8D, 0x07, 0x20, // STA $2007
+		0xE8,             // INX
+		0xE0, 0x20,       // CPX #$20
+		0xD0, 0xF5,       // BNE *-9
+		// name and attribute table
+		0xA9, 0x20,       // LDA #$20
+		0x8D, 0x06, 0x20, // STA $2006
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x06, 0x20, // STA $2006
+		0xA0, 0x04,       // LDY #$04
+		0xA2, 0x00,       // LDX #$00
+		0x8E, 0x07, 0x20, // STX $2007
+		0xE8,             // INX
+		0xD0, 0xFA,       // BNE *-4
+		0x88,             // DEY
+		0xD0, 0xF7,       // BNE *-7
+		// background on, NMI off
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x05, 0x20, // STA $2005
+		0x8D, 0x05, 0x20, // STA $2005
+		0x8D, 0x00, 0x20, // STA $2000
+		0xA9, 0x0A,       // LDA #$0A
+		0x8D, 0x01, 0x20, // STA $2001
+		0x4C, 0x55, 0xC0, // JMP *
+		// nmi, irq
+		0x40,             // RTI
+		// palette
+		0x0F, 0x16, 0x27, 0x38, 0x0F, 0x1A, 0x2B, 0x3C,
+		0x0F, 0x12, 0x23, 0x34, 0x0F, 0x05, 0x19, 0x2D,
+		0x0F, 0x06, 0x17, 0x28, 0x0F, 0x09, 0x1B, 0x2C,
+		0x0F, 0x01, 0x11, 0x21, 0x0F, 0x08, 0x18, 0x30
+	};
+
+	void BuildImage(std::vector<char>& image)
+	{
+		static const char header[16] = { 'N','E','S',0x1A, PRG_SIZE / 0x4000, CHR_SIZE / 0x2000 };
+
+		image.assign( sizeof(header) + PRG_SIZE + CHR_SIZE, 0 );
+		std::memcpy( &image[0], header, sizeof(header) );
+
+		char* const prg = &image[sizeof(header)];
+		std::memcpy( prg, program, sizeof(program) );
+
+		const unsigned int rti = PRG_BASE + RTI_OFFSET;
+		const unsigned int vectors[3] = { rti, PRG_BASE, rti };
+
+		for (int i = 0; i < 3; ++i)
+		{
+			prg[PRG_SIZE - 6 + i * 2 + 0] = char(vectors[i] & 0xFF);
+			prg[PRG_SIZE - 6 + i * 2 + 1] = char(vectors[i] >> 8);
+		}
+
+		char* const chr = prg + PRG_SIZE;
+		unsigned int seed = 1;
+
+		for (int i = 0; i < CHR_SIZE; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			chr[i] = char(seed >> 16);
+		}
+	}
+
+	struct Depth
+	{
+		uint bits;
+		unsigned long r, g, b;
+	};
+
+	const char* const pathNames[] =
+	{
+		"default",
+		"scalar",
+		"sse2",
+		"avx2",
+		"neon"
+	};
+}
+
+int main(int argc, char** argv)
+{
+	const int frames = argc > 1 ? std::atoi( argv[1] ) : 1000;
+
+	if (frames <= 0)
+	{
+		std::fprintf( stderr, "usage: %s [frames]\n", argv[0] );
+		return 1;
+	}
+
+	static_assert( PALETTE_OFFSET + 32 == sizeof(program), "palette must end the program" );
+
+	std::vector<char> image;
+	BuildImage( image );
+
+	Emulator emulator;
+	Machine machine( emulator );
+	Video video( emulator );
+
+	// the const overload copies the image, the other one takes ownership of it
+	MemInputStream stream( static_cast<const char*>(&image[0]), image.size() );
+
+	if (NES_FAILED(machine.Load( stream, Machine::FAVORED_NES_NTSC )) || NES_FAILED(machine.Power( true )))
+	{
+		std::fprintf( stderr, "failed to load the benchmark image\n" );
+		return 1;
+	}
+
+	for (int i = 0; i < 10; ++i)
+		emulator.Execute( NULL, NULL, NULL );
+
+	static const Depth depths[] =
+	{
+		{ 32, 0xFF0000, 0x00FF00, 0x0000FF },
+		{ 16, 0xF800, 0x07E0, 0x001F },
+		{ 15, 0x7C00, 0x03E0, 0x001F }
+	};
+
+	std::vector<unsigned int> pixels( OUT_WIDTH * OUT_HEIGHT ), reference( OUT_WIDTH * OUT_HEIGHT );
+	Video::Output output( &pixels[0], OUT_WIDTH * sizeof(pixels[0]) );
+
+	std::printf( "%-8s %5s %12s %8s\n", "path", "bits", "frames/sec", "cpu %" );
+
+	for (uint d = 0; d < sizeof(depths) / sizeof(depths[0]); ++d)
+	{
+		for (uint p = Video::NTSC_PATH_SCALAR; p <= Video::NTSC_PATH_NEON; ++p)
+		{
+			if (NES_FAILED(video.SetNtscPath( static_cast<Video::NtscPath>(p) )))
+				continue;
+
+			Video::RenderState renderState;
+
+			renderState.filter = Video::RenderState::FILTER_NTSC;
+			renderState.width = OUT_WIDTH;
+			renderState.height = OUT_HEIGHT;
+			renderState.bits.count = depths[d].bits == 32 ? 32 : 16;
+			renderState.bits.mask.r = depths[d].r;
+			renderState.bits.mask.g = depths[d].g;
+			renderState.bits.mask.b = depths[d].b;
+
+			if (NES_FAILED(video.SetRenderState( renderState )))
+			{
+				std::fprintf( stderr, "failed to set up the NTSC filter\n" );
+				return 1;
+			}
+
+			// first blit builds the filter
+			std::fill( pixels.begin(), pixels.end(), 0 );
+			video.Blit( output );
+
+			if (p == Video::NTSC_PATH_SCALAR)
+			{
+				reference = pixels;
+			}
+			else if (pixels != reference)
+			{
+				std::fprintf( stderr, "%s: output at %u bits differs from the scalar blitter\n", pathNames[p], depths[d].bits );
+				return 1;
+			}
+
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (int i = 0; i < frames; ++i)
+				video.Blit( output );
+
+			const double rate = frames / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			std::printf( "%-8s %5u %12.0f %7.1f%%\n", pathNames[p], depths[d].bits, rate, 60 * 100 / rate );
+		}
+	}
+
+	video.SetNtscPath( Video::NTSC_PATH_DEFAULT );
+	std::printf( "default: %s\n", pathNames[video.GetNtscPath()] );
+
+	return 0;
+}
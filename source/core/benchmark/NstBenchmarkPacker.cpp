@@ -0,0 +1,195 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+// Compares the bulk row packers of NstFrameCompressorPacker against the per pixel
+// ULEB128Ex/SLEB128Ex loop they replaced, on synthetic frames with few colors (every
+// index fits one half byte), many colors (mostly multi half byte codes) and deltas from
+// a keyframe. The outputs must be byte-identical, the program fails otherwise.
+//
+// usage: nstbench_packer [iterations]
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include "../NstFrameCompressorPacker.hpp"
+
+namespace
+{
+	using namespace Nes;
+	using namespace Nes::Core;
+
+	typedef Video::Screen::Pixel Pixel;
+
+	enum
+	{
+		WIDTH = Video::Screen::WIDTH,
+		HEIGHT = Video::Screen::HEIGHT,
+		PIXELS = WIDTH * HEIGHT,
+		// a SLEB128Ex code of a 9 bit delta takes at most 4 half bytes
+		PACKED_SIZE = PIXELS * 2 + 16
+	};
+
+	struct Frame
+	{
+		const char* name;
+		std::vector<Pixel> pixels;
+		std::vector<Pixel> keyframe;
+	};
+
+	// the loops the bulk packers replaced in NstFrameCompressorZlib.cpp
+	void PackColorFramePerPixel(const Frame& frame, const uint16_t* remapTbl, Pixel* keyframePixels, unsigned char* packedPixels)
+	{
+		unsigned int packedPixelsBitOffset = 0;
+
+		for (uint i = 0; i < PIXELS; ++i)
+		{
+			const uint32_t newColorIdx = remapTbl[frame.pixels[i]];
+
+			FramePacker::encodeULEB128Ex(newColorIdx, packedPixels, packedPixelsBitOffset, &packedPixels, &packedPixelsBitOffset);
+
+			keyframePixels[i] = newColorIdx;
+		}
+	}
+
+	void PackDeltaFramePerPixel(const Frame& frame, const uint16_t* remapTbl, Pixel*, unsigned char* packedPixels)
+	{
+		unsigned int packedPixelsBitOffset = 0;
+
+		for (uint i = 0; i < PIXELS; ++i)
+		{
+			const int32_t deltaColor = int32_t(remapTbl[frame.pixels[i]]) - int32_t(frame.keyframe[i]);
+
+			FramePacker::encodeSLEB128Ex(deltaColor, packedPixels, packedPixelsBitOffset, &packedPixels, &packedPixelsBitOffset);
+		}
+	}
+
+	void PackColorFrame(const Frame& frame, const uint16_t* remapTbl, Pixel* keyframePixels, unsigned char* packedPixels)
+	{
+		unsigned int packedPixelsBitOffset = 0;
+
+		for (uint i = 0; i < PIXELS; i += WIDTH)
+			FramePacker::PackColorRow(&frame.pixels[i], remapTbl, keyframePixels + i, WIDTH, packedPixels, packedPixelsBitOffset);
+	}
+
+	void PackDeltaFrame(const Frame& frame, const uint16_t* remapTbl, Pixel*, unsigned char* packedPixels)
+	{
+		unsigned int packedPixelsBitOffset = 0;
+
+		for (uint i = 0; i < PIXELS; i += WIDTH)
+			FramePacker::PackDeltaRow(&frame.pixels[i], remapTbl, &frame.keyframe[i], WIDTH, packedPixels, packedPixelsBitOffset);
+	}
+
+	typedef void (*PackFrame)(const Frame&, const uint16_t*, Pixel*, unsigned char*);
+
+	double Time(PackFrame pack, const Frame& frame, const uint16_t* remapTbl, Pixel* keyframePixels, unsigned char* packedPixels, int iterations)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < iterations; ++i)
+			pack( frame, remapTbl, keyframePixels, packedPixels );
+
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+	}
+
+	// background tiles of <numColors> colors with a few sprites of other colors on top
+	void Draw(std::vector<Pixel>& pixels, uint numColors, uint spriteOffset)
+	{
+		pixels.resize( PIXELS );
+
+		for (uint y = 0; y < HEIGHT; ++y)
+		{
+			for (uint x = 0; x < WIDTH; ++x)
+				pixels[y * WIDTH + x] = ((x / 8 + y / 8) * 5 + (x ^ y) % 3) % numColors;
+		}
+
+		for (uint s = 0; s < 16; ++s)
+		{
+			const uint sx = (s * 37 + spriteOffset) % (WIDTH - 8);
+			const uint sy = (s * 53 + spriteOffset) % (HEIGHT - 8);
+
+			for (uint y = 0; y < 8; ++y)
+			{
+				for (uint x = 0; x < 8; ++x)
+					pixels[(sy + y) * WIDTH + sx + x] = (numColors + s % 3) % 64;
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int iterations = argc > 1 ? std::atoi( argv[1] ) : 500;
+
+	if (iterations <= 0)
+	{
+		std::fprintf( stderr, "usage: %s [iterations]\n", argv[0] );
+		return 1;
+	}
+
+	// frames are drawn with palette entries below 64 which the table maps to themselves,
+	// so the color index of a pixel is its palette entry
+	static uint16_t remapTbl[Video::Screen::PALETTE];
+
+	for (uint i = 0; i < Video::Screen::PALETTE; ++i)
+		remapTbl[i] = i % 64;
+
+	Frame frames[3];
+
+	frames[0].name = "few colors";
+	Draw( frames[0].pixels, 5, 0 );
+
+	frames[1].name = "many colors";
+	Draw( frames[1].pixels, 48, 0 );
+
+	frames[2].name = "delta";
+	Draw( frames[2].pixels, 5, 3 );
+	Draw( frames[2].keyframe, 5, 0 );
+
+	std::vector<Pixel> keyframePixels[2] = { std::vector<Pixel>(PIXELS), std::vector<Pixel>(PIXELS) };
+	std::vector<unsigned char> packed[2] = { std::vector<unsigned char>(PACKED_SIZE), std::vector<unsigned char>(PACKED_SIZE) };
+
+	std::printf( "%-12s %14s %14s %8s\n", "frame", "per pixel us", "bulk us", "speedup" );
+
+	for (uint i = 0; i < 3; ++i)
+	{
+		const bool delta = !frames[i].keyframe.empty();
+		const PackFrame reference = delta ? PackDeltaFramePerPixel : PackColorFramePerPixel;
+		const PackFrame bulk = delta ? PackDeltaFrame : PackColorFrame;
+
+		const double referenceTime = Time( reference, frames[i], remapTbl, &keyframePixels[0][0], &packed[0][0], iterations );
+		const double bulkTime = Time( bulk, frames[i], remapTbl, &keyframePixels[1][0], &packed[1][0], iterations );
+
+		if (packed[0] != packed[1] || keyframePixels[0] != keyframePixels[1])
+		{
+			std::fprintf( stderr, "%s: bulk packer output differs from the per pixel encoder\n", frames[i].name );
+			return 1;
+		}
+
+		std::printf( "%-12s %14.2f %14.2f %7.2fx\n", frames[i].name, referenceTime, bulkTime, referenceTime / bulkTime );
+	}
+
+	return 0;
+}
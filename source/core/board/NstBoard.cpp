@@ -390,6 +390,11 @@ namespace Nes
 				cpu.Map( 0xC000, 0xDFFF ).Set( this, &Board::Peek_Prg_C, &Board::Poke_Nop );
 				cpu.Map( 0xE000, 0xFFFF ).Set( this, &Board::Peek_Prg_E, &Board::Poke_Nop );
 
+				cpu.MapDirect( 0x8000, 0x9FFF, prg.Slot(0), SIZE_8K-1 );
+				cpu.MapDirect( 0xA000, 0xBFFF, prg.Slot(1), SIZE_8K-1 );
+				cpu.MapDirect( 0xC000, 0xDFFF, prg.Slot(2), SIZE_8K-1 );
+				cpu.MapDirect( 0xE000, 0xFFFF, prg.Slot(3), SIZE_8K-1 );
+
 				if (hard)
 				{
 					wrk.Source().SetSecurity( true, board.GetWram() > 0 );
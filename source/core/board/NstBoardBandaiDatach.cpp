@@ -65,7 +65,7 @@ namespace Nes
 					Lz93d50Ex::SubReset( hard );
 
 					barcodeReader.Reset();
-					p6000 = cpu.Map( 0x6000 );
+					p6000 = cpu.GetPort( 0x6000 );
 
 					for (uint i=0x6000; i < 0x8000; i += 0x100)
 						Map( i, &Datach::Peek_6000 );
@@ -106,7 +106,7 @@ namespace Nes
 					std::memset( data, END, MAX_DATA_LENGTH );
 
 					if (initHook)
-						cpu.AddHook( Hook(this,&Reader::Hook_Fetcher) );
+						cpu.Schedule( Hook(this,&Reader::Hook_Fetcher), cycles );
 				}
 
 				bool Datach::Reader::IsTransferring() const
@@ -161,6 +161,8 @@ namespace Nes
 						cycles = Cpu::CYCLE_MAX;
 						output = 0x00;
 					}
+
+					cpu.Schedule( Hook(this,&Reader::Hook_Fetcher), cycles );
 				}
 
 				void Datach::Reader::SaveState(State::Saver& state,const dword baseChunk) const
@@ -319,6 +321,7 @@ namespace Nes
 						*output++ = 8;
 
 					cycles = cpu.GetCycles() + cpu.GetClock() * CC_INTERVAL;
+					cpu.Schedule( Hook(this,&Reader::Hook_Fetcher), cycles );
 
 					return true;
 				}
@@ -345,6 +348,8 @@ namespace Nes
 							break;
 						}
 					}
+
+					cpu.Schedule( Hook(this,&Reader::Hook_Fetcher), cycles );
 				}
 
 				inline uint Datach::Reader::GetOutput() const
@@ -365,6 +370,8 @@ namespace Nes
 							cycles -= cpu.GetFrameCycles();
 						else
 							cycles = 0;
+
+						cpu.Schedule( Hook(this,&Reader::Hook_Fetcher), cycles );
 					}
 				}
 
@@ -184,6 +184,11 @@ namespace Nes
 					return volume;
 				}
 
+				bool Vrc6::Sound::CanRenderAsync() const
+				{
+					return true;
+				}
+
 				void Vrc6::SubLoad(State::Loader& state,const dword baseChunk)
 				{
 					NST_VERIFY( baseChunk == (AsciiId<'K','V','6'>::V) );
@@ -384,37 +389,61 @@ namespace Nes
 
 				void Vrc6::Sound::WriteSquareReg0(uint i,uint data)
 				{
-					Update();
-					square[i].WriteReg0( data );
+					Write( &Sound::SetSquareReg0, i, data );
 				}
 
 				void Vrc6::Sound::WriteSquareReg1(uint i,uint data)
 				{
-					Update();
-					square[i].WriteReg1( data, fixed );
+					Write( &Sound::SetSquareReg1, i, data );
 				}
 
 				void Vrc6::Sound::WriteSquareReg2(uint i,uint data)
 				{
-					Update();
-					square[i].WriteReg2( data, fixed );
+					Write( &Sound::SetSquareReg2, i, data );
 				}
 
 				void Vrc6::Sound::WriteSawReg0(uint data)
 				{
-					Update();
-					saw.WriteReg0( data );
+					Write( &Sound::SetSawReg0, 0, data );
 				}
 
 				void Vrc6::Sound::WriteSawReg1(uint data)
 				{
-					Update();
-					saw.WriteReg1( data, fixed );
+					Write( &Sound::SetSawReg1, 0, data );
 				}
 
 				void Vrc6::Sound::WriteSawReg2(uint data)
 				{
-					Update();
+					Write( &Sound::SetSawReg2, 0, data );
+				}
+
+				void Vrc6::Sound::SetSquareReg0(uint i,uint data)
+				{
+					square[i].WriteReg0( data );
+				}
+
+				void Vrc6::Sound::SetSquareReg1(uint i,uint data)
+				{
+					square[i].WriteReg1( data, fixed );
+				}
+
+				void Vrc6::Sound::SetSquareReg2(uint i,uint data)
+				{
+					square[i].WriteReg2( data, fixed );
+				}
+
+				void Vrc6::Sound::SetSawReg0(uint,uint data)
+				{
+					saw.WriteReg0( data );
+				}
+
+				void Vrc6::Sound::SetSawReg1(uint,uint data)
+				{
+					saw.WriteReg1( data, fixed );
+				}
+
+				void Vrc6::Sound::SetSawReg2(uint,uint data)
+				{
 					saw.WriteReg2( data, fixed );
 				}
 
@@ -63,10 +63,18 @@ namespace Nes
 
 						void Reset();
 						bool UpdateSettings();
+						bool CanRenderAsync() const;
 						Sample GetSample();
 
 					private:
 
+						void SetSquareReg0 (uint,uint);
+						void SetSquareReg1 (uint,uint);
+						void SetSquareReg2 (uint,uint);
+						void SetSawReg0    (uint,uint);
+						void SetSawReg1    (uint,uint);
+						void SetSawReg2    (uint,uint);
+
 						class BaseChannel
 						{
 						protected:
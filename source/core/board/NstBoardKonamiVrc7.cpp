@@ -336,6 +336,11 @@ namespace Nes
 					return volume;
 				}
 
+				bool Vrc7::Sound::CanRenderAsync() const
+				{
+					return true;
+				}
+
 				void Vrc7::SubLoad(State::Loader& state,const dword baseChunk)
 				{
 					NST_VERIFY( baseChunk == (AsciiId<'K','V','7'>::V) );
@@ -782,9 +787,12 @@ namespace Nes
 
 				void Vrc7::Sound::WriteReg(const uint data)
 				{
-					Update();
+					Write( &Sound::SetReg, regSelect, data );
+				}
 
-					switch (regSelect & 0x3F)
+				void Vrc7::Sound::SetReg(const uint reg,const uint data)
+				{
+					switch (reg & 0x3F)
 					{
 						case 0x00:
 
@@ -849,7 +857,7 @@ namespace Nes
 						case 0x14:
 						case 0x15:
 
-							channels[regSelect - 0x10].WriteReg8( data, tables );
+							channels[reg - 0x10].WriteReg8( data, tables );
 							break;
 
 						case 0x20:
@@ -859,7 +867,7 @@ namespace Nes
 						case 0x24:
 						case 0x25:
 
-							channels[regSelect - 0x20].WriteReg9( data, tables );
+							channels[reg - 0x20].WriteReg9( data, tables );
 							break;
 
 						case 0x30:
@@ -869,7 +877,7 @@ namespace Nes
 						case 0x34:
 						case 0x35:
 
-							channels[regSelect - 0x30].WriteRegA( data, tables );
+							channels[reg - 0x30].WriteRegA( data, tables );
 							break;
 					}
 				}
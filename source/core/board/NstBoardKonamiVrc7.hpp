@@ -58,10 +58,12 @@ namespace Nes
 
 						void Reset();
 						bool UpdateSettings();
+						bool CanRenderAsync() const;
 						Sample GetSample();
 
 					private:
 
+						void SetReg(uint,uint);
 						void ResetClock();
 						void Refresh();
 
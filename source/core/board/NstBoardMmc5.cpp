@@ -177,7 +177,6 @@ namespace Nes
 
 			void Mmc5::SubReset(const bool hard)
 			{
-				cpu.AddHook( Hook(this,&Mmc5::Hook_Cpu) );
 				ppu.SetHActiveHook( Hook(this,&Mmc5::Hook_HActive) );
 				ppu.SetHBlankHook( Hook(this,&Mmc5::Hook_HBlank) );
 
@@ -216,7 +215,7 @@ namespace Nes
 				Map( 0xA000U, 0xBFFFU, &Mmc5::Peek_A000, &Mmc5::Poke_A000 );
 				Map( 0xC000U, 0xDFFFU, &Mmc5::Peek_C000, &Mmc5::Poke_C000 );
 
-				p2001 = cpu.Map( 0x2001 );
+				p2001 = cpu.GetPort( 0x2001 );
 
 				for (uint i=0x2001; i < 0x4000; i += 0x8)
 					cpu.Map( i ).Set( this, &Mmc5::Peek_2001, &Mmc5::Poke_2001 );
@@ -226,6 +225,7 @@ namespace Nes
 
 				exRam.Reset( hard );
 				flow.Reset();
+				cpu.Schedule( Hook(this,&Mmc5::Hook_Cpu), flow.cycles );
 				banks.Reset();
 				regs.Reset();
 				irq.Reset();
@@ -632,7 +632,10 @@ namespace Nes
 			inline void Mmc5::Update()
 			{
 				if (flow.cycles <= cpu.GetCycles())
+				{
 					(*this.*flow.phase)();
+					cpu.Schedule( Hook(this,&Mmc5::Hook_Cpu), flow.cycles );
+				}
 			}
 
 			void Mmc5::Sync(Event event,Input::Controllers* controllers)
@@ -643,6 +646,8 @@ namespace Nes
 
 					flow.cycles = 0;
 					flow.phase = &Mmc5::VBlank;
+
+					cpu.Schedule( Hook(this,&Mmc5::Hook_Cpu), flow.cycles );
 				}
 
 				Board::Sync( event, controllers );
@@ -154,6 +154,11 @@ namespace Nes
 					return volume;
 				}
 
+				bool S5b::Sound::CanRenderAsync() const
+				{
+					return true;
+				}
+
 				void S5b::SubLoad(State::Loader& state,const dword baseChunk)
 				{
 					if (baseChunk == AsciiId<'S','5','B'>::V)
@@ -428,23 +433,27 @@ namespace Nes
 
 				void S5b::Sound::WriteReg(const uint data)
 				{
-					Update();
+					Write( &Sound::SetReg, regSelect, data );
+				}
+
+				void S5b::Sound::SetReg(const uint reg,const uint data)
+				{
 					active = true;
 
-					switch (regSelect & 0xF)
+					switch (reg & 0xF)
 					{
 						case 0x0:
 						case 0x2:
 						case 0x4:
 
-							squares[regSelect >> 1].WriteReg0( data, fixed );
+							squares[reg >> 1].WriteReg0( data, fixed );
 							break;
 
 						case 0x1:
 						case 0x3:
 						case 0x5:
 
-							squares[regSelect >> 1].WriteReg1( data, fixed );
+							squares[reg >> 1].WriteReg1( data, fixed );
 							break;
 
 						case 0x6:
@@ -463,7 +472,7 @@ namespace Nes
 						case 0x9:
 						case 0xA:
 
-							squares[regSelect - 0x8].WriteReg3( data );
+							squares[reg - 0x8].WriteReg3( data );
 							break;
 
 						case 0xB:
@@ -58,10 +58,13 @@ namespace Nes
 
 						void Reset();
 						bool UpdateSettings();
+						bool CanRenderAsync() const;
 						Sample GetSample();
 
 					private:
 
+						void SetReg(uint,uint);
+
 						enum
 						{
 							NUM_SQUARES = 3
@@ -37,7 +37,7 @@ namespace Nes
 
 			void VsSystem::SubReset(const bool hard)
 			{
-				p4016 = cpu.Map( 0x4016 );
+				p4016 = cpu.GetPort( 0x4016 );
 				cpu.Map( 0x4016 ).Set( this, &VsSystem::Peek_4016, &VsSystem::Poke_4016 );
 
 				if (hard)
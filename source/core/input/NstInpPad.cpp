@@ -100,6 +100,14 @@ namespace Nes
 					Controllers::Pad& pad = input->pad[type - Api::Input::PAD1];
 					input = NULL;
 
+					//LHQ: lockstep netplay, both peers must see the same buttons so local device is ignored
+					uint lockstepButtons;
+					if (cpu.GetLockstepPadState(lockstepButtons, type - Api::Input::PAD1))
+					{
+						state = lockstepButtons;
+						return;
+					}
+
 					if (Controllers::Pad::callback( pad, type - Api::Input::PAD1 ))
 					{
 						uint cpuModifiers = 0;
@@ -0,0 +1,246 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+// Checks that the delta rewinder steps back through frames whose deltas wrap
+// around its arena. The program synthesized in memory writes one to four pages
+// of RAM per frame, picked by a pseudo random sequence, so the deltas vary in size
+// and the arena wraps at a different offset each lap. Every state rewound to must
+// be the one recorded going forward.
+//
+// usage: nsttest_deltarewinder [frames of the longest run]
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include "../api/NstApiEmulator.hpp"
+#include "../api/NstApiMachine.hpp"
+#include "../api/NstApiRewinder.hpp"
+#include "../api/NstApiMemoryStream.hpp"
+
+namespace
+{
+	enum
+	{
+		PRG_SIZE = 0x4000,
+		CHR_SIZE = 0x2000,
+		PRG_BASE = 0xC000,
+		NMI = 0xC052,
+		IRQ = 0xC055,
+		// frames the rewinder must be able to step back at least
+		MIN_REWOUND = 500,
+		// difference in length between two runs
+		RUN_INTERVAL = 400
+	};
+
+	const unsigned char program[] =
+	{
+		// reset
+		0x78,             // SEI
+		0xD8,             // CLD
+		0xA2, 0xFF,       // LDX #$FF
+		0x9A,             // TXS
+		0xA9, 0x40,       // LDA #$40
+		0x8D, 0x17, 0x40, // STA $4017
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x00, 0x20, // STA $2000
+		0x8D, 0x01, 0x20, // STA $2001
+		0x2C, 0x02, 0x20, // BIT $2002
+		0x10, 0xFB,       // BPL *-3
+		0x2C, 0x02, 0x20, // BIT $2002
+		0x10, 0xFB,       // BPL *-3
+		0xA9, 0x80,       // LDA #$80
+		0x8D, 0x00, 0x20, // STA $2000
+		// loop, at $C021, waits for the next NMI
+		0xA5, 0x10,       // LDA $10
+		0xC5, 0x10,       // CMP $10
+		0xF0, 0xFC,       // BEQ *-2
+		// $12 = $12 * 5 + 1
+		0xA5, 0x12,       // LDA $12
+		0x0A,             // ASL A
+		0x0A,             // ASL A
+		0x18,             // CLC
+		0x65, 0x12,       // ADC $12
+		0x18,             // CLC
+		0x69, 0x01,       // ADC #$01
+		0x85, 0x12,       // STA $12
+		// fills 1 + (its two upper bits) pages from $0300 with the frame counter
+		0x2A,             // ROL A
+		0x2A,             // ROL A
+		0x2A,             // ROL A
+		0x29, 0x03,       // AND #$03
+		0xAA,             // TAX
+		0xE8,             // INX
+		0xA9, 0x03,       // LDA #$03
+		0x85, 0x01,       // STA $01
+		0xA9, 0x00,       // LDA #$00
+		0x85, 0x00,       // STA $00
+		0xA8,             // TAY
+		0xA5, 0x10,       // LDA $10
+		0x91, 0x00,       // STA ($00),Y
+		0xC8,             // INY
+		0xD0, 0xFB,       // BNE *-3
+		0xE6, 0x01,       // INC $01
+		0xCA,             // DEX
+		0xD0, 0xF4,       // BNE *-10
+		0x4C, 0x21, 0xC0, // JMP loop
+		// nmi, at $C052
+		0xE6, 0x10,       // INC $10
+		0x40,             // RTI
+		// irq, at $C055
+		0x40              // RTI
+	};
+
+	void BuildImage(std::vector<char>& image)
+	{
+		static const char header[16] = { 'N','E','S',0x1A, PRG_SIZE / 0x4000, CHR_SIZE / 0x2000 };
+
+		image.assign( sizeof(header) + PRG_SIZE + CHR_SIZE, 0 );
+		std::memcpy( &image[0], header, sizeof(header) );
+
+		char* const prg = &image[sizeof(header)];
+		std::memcpy( prg, program, sizeof(program) );
+
+		const unsigned int vectors[3] = { NMI, PRG_BASE, IRQ };
+
+		for (int i = 0; i < 3; ++i)
+		{
+			prg[PRG_SIZE - 6 + i * 2 + 0] = char(vectors[i] & 0xFF);
+			prg[PRG_SIZE - 6 + i * 2 + 1] = char(vectors[i] >> 8);
+		}
+	}
+
+	unsigned long long HashState(const Nes::Api::Machine& machine,std::vector<unsigned char>& buffer)
+	{
+		unsigned long size = 0;
+		buffer.resize( machine.GetSnapshotSize() );
+
+		if (buffer.empty() || NES_FAILED(machine.SnapshotTo( &buffer[0], buffer.size(), &size )))
+			return 0;
+
+		unsigned long long hash = 14695981039346656037ULL;
+
+		for (unsigned long i = 0; i < size; ++i)
+			hash = (hash ^ buffer[i]) * 1099511628211ULL;
+
+		return hash;
+	}
+
+	// runs <frames> frames forward then rewinds as far back as possible, false on failure
+	bool Run(const std::vector<char>& image,const int frames)
+	{
+		using namespace Nes::Api;
+
+		Emulator emulator;
+		Machine machine( emulator );
+		Rewinder rewinder( emulator );
+
+		// the const overload copies the image, the other one takes ownership of it
+		MemInputStream stream( &image[0], image.size() );
+
+		if (NES_FAILED(machine.Load( stream, Machine::FAVORED_NES_NTSC )) || NES_FAILED(machine.Power( true )))
+		{
+			std::fprintf( stderr, "failed to load the test image\n" );
+			return false;
+		}
+
+		// the smallest budget, a lap of the arena takes some 1500 frames
+		if (NES_FAILED(rewinder.SetMemoryBudget( 1 )) || NES_FAILED(rewinder.Enable( true )))
+		{
+			std::fprintf( stderr, "failed to enable the rewinder\n" );
+			return false;
+		}
+
+		std::vector<unsigned char> buffer;
+		std::vector<unsigned long long> states;
+
+		for (int i = 0; i < frames; ++i)
+		{
+			states.push_back( HashState( machine, buffer ) );
+			emulator.Execute( NULL, NULL, NULL );
+		}
+
+		states.push_back( HashState( machine, buffer ) );
+
+		if (NES_FAILED(rewinder.SetDirection( Rewinder::BACKWARD )))
+		{
+			std::fprintf( stderr, "failed to start rewinding\n" );
+			return false;
+		}
+
+		// each step restores one frame further back until the oldest one kept,
+		// a delta that can't be unpacked fails the step and stops rewinding
+		int rewound = 0, mismatches = 0, errors = 0;
+
+		for (int i = frames; i >= 0 && rewinder.GetDirection() == Rewinder::BACKWARD; --i)
+		{
+			if (NES_FAILED(emulator.Execute( NULL, NULL, NULL )))
+				++errors;
+
+			if (rewinder.GetDirection() != Rewinder::BACKWARD)
+				break;
+
+			if (HashState( machine, buffer ) != states[i])
+				++mismatches;
+
+			++rewound;
+		}
+
+		std::printf( "frames: %d, rewound: %d, mismatches: %d, errors: %d\n", frames, rewound, mismatches, errors );
+
+		return !mismatches && !errors && rewound >= (frames <= MIN_REWOUND ? frames - 1 : int(MIN_REWOUND));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int frames = argc > 1 ? std::atoi( argv[1] ) : 4000;
+
+	if (frames < RUN_INTERVAL)
+	{
+		std::fprintf( stderr, "usage: %s [frames >= %d]\n", argv[0], int(RUN_INTERVAL) );
+		return 1;
+	}
+
+	std::vector<char> image;
+	BuildImage( image );
+
+	// older deltas go unused once they are overwritten, so a broken wrap only shows when
+	// rewinding soon after it, run with several lengths to rewind after each wrap
+	bool passed = true;
+
+	for (int length = RUN_INTERVAL; length <= frames; length += RUN_INTERVAL)
+	{
+		if (!Run( image, length ))
+			passed = false;
+	}
+
+	if (!passed)
+	{
+		std::fprintf( stderr, "FAILED\n" );
+		return 1;
+	}
+
+	return 0;
+}
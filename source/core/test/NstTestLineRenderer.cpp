@@ -0,0 +1,373 @@
+////////////////////////////////////////////////////////////////////////////////////////
+//
+// Nestopia - NES/Famicom emulator written in C++
+//
+// Copyright (C) 2016-2018 Le Hoang Quyen
+//
+// This file is part of Nestopia.
+//
+// Nestopia is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Nestopia is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Nestopia; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+// Checks that the scanline renderer draws the same frames as the per-dot one.
+// The program synthesized in memory covers what the scanline renderer composes
+// differently: sprites in front of and behind the background, more than eight on
+// a line, 8x16 ones, all four left column clipping modes and a sprite 0 hit that
+// splits the screen with scroll and mask writes mid-frame. Every frame and the
+// machine state after it must be the same with either renderer, and the state
+// too when the scanline renderer runs headless, only checking sprite 0 hits.
+//
+// usage: nsttest_linerenderer [frames]
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include "../api/NstApiEmulator.hpp"
+#include "../api/NstApiMachine.hpp"
+#include "../api/NstApiVideo.hpp"
+#include "../api/NstApiMemoryStream.hpp"
+
+namespace
+{
+	enum
+	{
+		PRG_SIZE = 0x4000,
+		CHR_SIZE = 0x2000,
+		PRG_BASE = 0xC000,
+		NMI = 0xC0B0,
+		IRQ = 0xC0F1,
+		WIDTH = Nes::Api::Video::Output::WIDTH,
+		HEIGHT = Nes::Api::Video::Output::HEIGHT
+	};
+
+	const unsigned char program[] =
+	{
+		// reset
+		0x78,             // SEI
+		0xD8,             // CLD
+		0xA2, 0xFF,       // LDX #$FF
+		0x9A,             // TXS
+		0xA9, 0x40,       // LDA #$40
+		0x8D, 0x17, 0x40, // STA $4017
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x00, 0x20, // STA $2000
+		0x8D, 0x01, 0x20, // STA $2001
+		0x2C, 0x02, 0x20, // BIT $2002
+		0x10, 0xFB,       // BPL *-3
+		0x2C, 0x02, 0x20, // BIT $2002
+		0x10, 0xFB,       // BPL *-3
+		// fills both nametables with 0-255 repeated, attributes included
+		0xA9, 0x20,       // LDA #$20
+		0x8D, 0x06, 0x20, // STA $2006
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x06, 0x20, // STA $2006
+		0xA0, 0x08,       // LDY #$08
+		0xA2, 0x00,       // LDX #$00
+		0x8E, 0x07, 0x20, // STX $2007
+		0xE8,             // INX
+		0xD0, 0xFA,       // BNE *-4
+		0x88,             // DEY
+		0xD0, 0xF7,       // BNE *-7
+		// palette entry i = (i * 2 ^ $15) & $3F
+		0xA9, 0x3F,       // LDA #$3F
+		0x8D, 0x06, 0x20, // STA $2006
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x06, 0x20, // STA $2006
+		0xA2, 0x00,       // LDX #$00
+		0x8A,             // TXA
+		0x0A,             // ASL A
+		0x49, 0x15,       // EOR #$15
+		0x29, 0x3F,       // AND #$3F
+		0x8D, 0x07, 0x20, // STA $2007
+		0xE8,             // INX
+		0xE0, 0x20,       // CPX #$20
+		0xD0, 0xF2,       // BNE *-12
+		// OAM buffer byte i = i * 7, up to sixteen sprites share a line and some are behind the background
+		0xA2, 0x00,       // LDX #$00
+		0x8A,             // TXA
+		0x85, 0x00,       // STA $00
+		0x0A,             // ASL A
+		0x0A,             // ASL A
+		0x0A,             // ASL A
+		0x38,             // SEC
+		0xE5, 0x00,       // SBC $00
+		0x9D, 0x00, 0x02, // STA $0200,X
+		0xE8,             // INX
+		0xD0, 0xF1,       // BNE *-13
+		// sprite 0 on the top lines for the hit
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x00, 0x02, // STA $0200
+		0xA9, 0x80,       // LDA #$80
+		0x8D, 0x00, 0x20, // STA $2000
+		0xA9, 0x1E,       // LDA #$1E
+		0x85, 0x11,       // STA $11
+		0x8D, 0x01, 0x20, // STA $2001
+		// loop, at $C06F, waits for the next NMI
+		0xA5, 0x10,       // LDA $10
+		0xC5, 0x10,       // CMP $10
+		0xF0, 0xFC,       // BEQ *-2
+		// two frames out of four split the screen at the sprite 0 hit
+		0xA5, 0x10,       // LDA $10
+		0x29, 0x02,       // AND #$02
+		0xD0, 0x19,       // BNE split
+		// the others read the sprite 0 hit flag once and keep it in $12, after a delay
+		// that moves the read over the top lines from one frame to the next
+		0xA0, 0x30,       // LDY #$30
+		0x88,             // DEY
+		0xD0, 0xFD,       // BNE *-1
+		0xA5, 0x10,       // LDA $10
+		0x0A,             // ASL A
+		0x0A,             // ASL A
+		0x0A,             // ASL A
+		0x38,             // SEC
+		0xE5, 0x10,       // SBC $10
+		0xA8,             // TAY
+		0x88,             // DEY
+		0xD0, 0xFD,       // BNE *-1
+		0xAD, 0x02, 0x20, // LDA $2002
+		0x85, 0x12,       // STA $12
+		0x4C, 0x6F, 0xC0, // JMP loop
+		// split, at $C094, waits for the hit
+		0x2C, 0x02, 0x20, // BIT $2002
+		0x70, 0xFB,       // BVS *-3
+		0x2C, 0x02, 0x20, // BIT $2002
+		0x50, 0xFB,       // BVC *-3
+		// scrolls the rest of the frame and flips its left column clipping
+		0xA5, 0x10,       // LDA $10
+		0x8D, 0x05, 0x20, // STA $2005
+		0x8D, 0x05, 0x20, // STA $2005
+		0xA5, 0x11,       // LDA $11
+		0x49, 0x06,       // EOR #$06
+		0x8D, 0x01, 0x20, // STA $2001
+		0x4C, 0x6F, 0xC0, // JMP loop
+		// nmi, at $C0B0
+		0x48,             // PHA
+		0x8A,             // TXA
+		0x48,             // PHA
+		0xE6, 0x10,       // INC $10
+		0xA9, 0x02,       // LDA #$02
+		0x8D, 0x14, 0x40, // STA $4014
+		// moves every sprite right by one
+		0xA2, 0x00,       // LDX #$00
+		0xFE, 0x03, 0x02, // INC $0203,X
+		0xE8,             // INX
+		0xE8,             // INX
+		0xE8,             // INX
+		0xE8,             // INX
+		0xD0, 0xF7,       // BNE *-7
+		// 8x16 sprites four frames out of eight
+		0xA5, 0x10,       // LDA $10
+		0x29, 0x04,       // AND #$04
+		0x0A,             // ASL A
+		0x0A,             // ASL A
+		0x0A,             // ASL A
+		0x09, 0x80,       // ORA #$80
+		0x8D, 0x00, 0x20, // STA $2000
+		// left column clipping, from the table below every eight frames
+		0xA5, 0x10,       // LDA $10
+		0x4A,             // LSR A
+		0x4A,             // LSR A
+		0x4A,             // LSR A
+		0x29, 0x03,       // AND #$03
+		0xAA,             // TAX
+		0xBD, 0xED, 0xC0, // LDA masks,X
+		0x85, 0x11,       // STA $11
+		0x8D, 0x01, 0x20, // STA $2001
+		0xA9, 0x00,       // LDA #$00
+		0x8D, 0x05, 0x20, // STA $2005
+		0x8D, 0x05, 0x20, // STA $2005
+		0x68,             // PLA
+		0xAA,             // TAX
+		0x68,             // PLA
+		0x40,             // RTI
+		// masks, at $C0ED: nothing, both, the sprites, the background clipped
+		0x1E, 0x18, 0x1A, 0x1C,
+		// irq, at $C0F1
+		0x40              // RTI
+	};
+
+	void BuildImage(std::vector<char>& image)
+	{
+		static const char header[16] = { 'N','E','S',0x1A, PRG_SIZE / 0x4000, CHR_SIZE / 0x2000 };
+
+		image.assign( sizeof(header) + PRG_SIZE + CHR_SIZE, 0 );
+		std::memcpy( &image[0], header, sizeof(header) );
+
+		char* const prg = &image[sizeof(header)];
+		std::memcpy( prg, program, sizeof(program) );
+
+		const unsigned int vectors[3] = { NMI, PRG_BASE, IRQ };
+
+		for (int i = 0; i < 3; ++i)
+		{
+			prg[PRG_SIZE - 6 + i * 2 + 0] = char(vectors[i] & 0xFF);
+			prg[PRG_SIZE - 6 + i * 2 + 1] = char(vectors[i] >> 8);
+		}
+
+		// tiles with both opaque and transparent pixels in every row
+		char* const chr = prg + PRG_SIZE;
+
+		for (int i = 0; i < CHR_SIZE; ++i)
+			chr[i] = char((i * 73) ^ (i >> 3));
+
+		// but sprite 0, tile 7 or tiles 6-7 in 8x16, has a single pixel per row so
+		// whether a row hits depends on the background pixel right under it
+		for (int table = 0; table < CHR_SIZE; table += 0x1000)
+		{
+			for (int i = 0; i < 32; ++i)
+				chr[table + 0x60 + i] = char((i & 8) ? 0x00 : 0x80 >> (i & 7));
+		}
+	}
+
+	unsigned long long Hash(const unsigned char* data,unsigned long size)
+	{
+		unsigned long long hash = 14695981039346656037ULL;
+
+		for (unsigned long i = 0; i < size; ++i)
+			hash = (hash ^ data[i]) * 1099511628211ULL;
+
+		return hash;
+	}
+
+	struct Frame
+	{
+		unsigned long long video;
+		unsigned long long state;
+	};
+
+	// runs <frames> frames with either renderer and hashes each of them, false on failure,
+	// headless frames have no video output so only their states get hashed
+	bool Run(const std::vector<char>& image,const int frames,const bool lineRenderer,const bool headless,std::vector<Frame>& hashes)
+	{
+		using namespace Nes::Api;
+
+		Emulator emulator;
+		Machine machine( emulator );
+		Video video( emulator );
+
+		// the const overload copies the image, the other one takes ownership of it
+		MemInputStream stream( &image[0], image.size() );
+
+		if (NES_FAILED(machine.Load( stream, Machine::FAVORED_NES_NTSC )))
+		{
+			std::fprintf( stderr, "failed to load the test image\n" );
+			return false;
+		}
+
+		Video::RenderState renderState;
+
+		renderState.filter = Video::RenderState::FILTER_NONE;
+		renderState.width = WIDTH;
+		renderState.height = HEIGHT;
+		renderState.bits.count = 32;
+		renderState.bits.mask.r = 0xFF0000;
+		renderState.bits.mask.g = 0x00FF00;
+		renderState.bits.mask.b = 0x0000FF;
+
+		if
+		(
+			NES_FAILED(video.SetRenderState( renderState )) ||
+			NES_FAILED(video.EnableLineRenderer( lineRenderer )) ||
+			NES_FAILED(video.EnableHeadless( headless )) ||
+			NES_FAILED(machine.Power( true ))
+		)
+		{
+			std::fprintf( stderr, "failed to set up the video output\n" );
+			return false;
+		}
+
+		std::vector<unsigned int> pixels( WIDTH * HEIGHT );
+		std::vector<unsigned char> buffer;
+		Video::Output output( &pixels[0], WIDTH * sizeof(pixels[0]) );
+
+		hashes.clear();
+
+		for (int i = 0; i < frames; ++i)
+		{
+			if (NES_FAILED(emulator.Execute( headless ? NULL : &output, NULL, NULL )))
+			{
+				std::fprintf( stderr, "frame %d failed to execute\n", i );
+				return false;
+			}
+
+			unsigned long size = 0;
+			buffer.resize( machine.GetSnapshotSize() );
+
+			if (buffer.empty() || NES_FAILED(machine.SnapshotTo( &buffer[0], buffer.size(), &size )))
+			{
+				std::fprintf( stderr, "failed to save the state after frame %d\n", i );
+				return false;
+			}
+
+			Frame frame;
+
+			frame.video = headless ? 0 : Hash( reinterpret_cast<const unsigned char*>(&pixels[0]), pixels.size() * sizeof(pixels[0]) );
+			frame.state = Hash( &buffer[0], size );
+
+			hashes.push_back( frame );
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	// the sprites cross the whole screen in 256 frames, with the 8x16 and clipping modes cycling meanwhile
+	const int frames = argc > 1 ? std::atoi( argv[1] ) : 600;
+
+	if (frames < 1)
+	{
+		std::fprintf( stderr, "usage: %s [frames >= 1]\n", argv[0] );
+		return 1;
+	}
+
+	std::vector<char> image;
+	BuildImage( image );
+
+	std::vector<Frame> dots, lines, headless;
+
+	if (!Run( image, frames, false, false, dots ) || !Run( image, frames, true, false, lines ) || !Run( image, frames, true, true, headless ))
+	{
+		std::fprintf( stderr, "FAILED\n" );
+		return 1;
+	}
+
+	int videoMismatches = 0, stateMismatches = 0, first = -1;
+
+	for (int i = 0; i < frames; ++i)
+	{
+		const bool video = dots[i].video != lines[i].video;
+		const bool state = dots[i].state != lines[i].state || dots[i].state != headless[i].state;
+
+		videoMismatches += video;
+		stateMismatches += state;
+
+		if ((video || state) && first < 0)
+			first = i;
+	}
+
+	std::printf( "frames: %d, video mismatches: %d, state mismatches: %d\n", frames, videoMismatches, stateMismatches );
+
+	if (first >= 0)
+	{
+		std::fprintf( stderr, "FAILED, first mismatch at frame %d\n", first );
+		return 1;
+	}
+
+	return 0;
+}
@@ -1423,8 +1423,8 @@ namespace Nes
 
 			coin = 0;
 
-			p4016 = cpu.Map( 0x4016 );
-			p4017 = cpu.Map( 0x4017 );
+			p4016 = cpu.GetPort( 0x4016 );
+			p4017 = cpu.GetPort( 0x4017 );
 
 			cpu.Map( 0x4016 ).Set( this, &VsSystem::Peek_4016, &VsSystem::Poke_4016 );
 			cpu.Map( 0x4017 ).Set( this, &VsSystem::Peek_4017, &VsSystem::Poke_4017 );
@@ -29,6 +29,7 @@
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 
 #include "../core/NstLog.hpp"
 #include "../core/api/NstApiUser.hpp"
@@ -613,11 +614,7 @@ namespace  Nes {
 		bool skipExecute = false;
 
 		if (!RemoteControlling()) {
-			if (m_speed > 1) {
-				for (int i = 0; i < m_speed - 1; ++i) {
-					m_emulator.Execute(NULL, NULL, m_input.get(), NULL);
-				}
-			} else if (m_speed < 0) {
+			if (m_speed < 0) {
 				if (m_delayUntilExecute) {
 					m_delayUntilExecute--;
 				}
@@ -661,6 +658,9 @@ namespace  Nes {
 	void NesSystemWrapper::SetSpeed(int speed) {
 		m_speed = speed;
 		m_delayUntilExecute = 0;
+
+		//speeding up is done by the core: it emulates several frames per Execute() but only renders the last one
+		m_emulator.SetTurbo(speed > 1 ? std::min<unsigned>(speed, Api::Emulator::MAX_TURBO) : 1);
 	}
 
 	void NesSystemWrapper::ClearCheats() {